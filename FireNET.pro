@@ -15,12 +15,25 @@ OBJECTS_DIR += $$PWD/build/obj/server
 
 SOURCES += src/server/workers/packets/clientquerys.cpp \
     src/server/main.cpp \
+    src/server/core/clientregistry.cpp \
     src/server/core/tcpconnection.cpp \
+    src/server/core/tcplistener.cpp \
     src/server/core/tcpserver.cpp \
     src/server/core/tcpthread.cpp \
+    src/server/workers/databases/redisclient.cpp \
     src/server/workers/databases/redisconnector.cpp \
     src/server/core/global.cpp \
+    src/server/core/ratelimiter.cpp \
+    src/server/core/chatservice.cpp \
+    src/server/core/mailbox.cpp \
+    src/server/core/presenceservice.cpp \
+    src/server/core/gameserverregistry.cpp \
+    src/server/core/sslcontext.cpp \
     src/server/workers/packets/helper.cpp \
+    src/server/workers/packets/querydispatcher.cpp \
+    src/server/workers/databases/dbtaskpool.cpp \
+    src/server/workers/databases/profilecache.cpp \
+    src/server/workers/databases/nicknameindex.cpp \
     src/server/workers/databases/dbworker.cpp \
     src/server/workers/databases/mysqlconnector.cpp \
     src/server/workers/packets/remoteclientquerys.cpp \
@@ -35,18 +48,32 @@ SOURCES += src/server/workers/packets/clientquerys.cpp \
 
 HEADERS += \
     src/server/workers/packets/clientquerys.h \
+    src/server/core/clientregistry.h \
     src/server/core/tcpconnection.h \
+    src/server/core/tcplistener.h \
     src/server/core/tcpserver.h \
     src/server/core/tcpthread.h \
+    src/server/workers/databases/redisclient.h \
     src/server/workers/databases/redisconnector.h \
     src/server/global.h \
+    src/server/core/ratelimiter.h \
+    src/server/core/chatservice.h \
+    src/server/core/mailbox.h \
+    src/server/core/presenceservice.h \
+    src/server/core/gameserverregistry.h \
+    src/server/core/sslcontext.h \
+    src/server/workers/databases/dbtaskpool.h \
+    src/server/workers/databases/profilecache.h \
+    src/server/workers/databases/nicknameindex.h \
     src/server/workers/databases/dbworker.h \
+    src/server/workers/packets/querydispatcher.h \
     src/server/workers/databases/mysqlconnector.h \
     src/server/workers/packets/remoteclientquerys.h \
     src/server/core/remoteserver.h \
     src/server/core/remoteconnection.h \
     src/server/tools/settings.h \
     src/server/core/tcppacket.h \
+    src/server/core/trafficcounters.h \
     src/server/tools/scripts.h \
     src/server/ui/mainwindow.h \
     src/server/ui/UILogger.h \
@@ -57,31 +84,25 @@ FORMS += \
 
 INCLUDEPATH += $$PWD/src/server/
 INCLUDEPATH += $$PWD/3rd/cutelogger/includes
-INCLUDEPATH += $$PWD/3rd/cpp_redis/includes
-INCLUDEPATH += $$PWD/3rd/tacopie/includes
 
 win32 {
 CONFIG(debug, debug|release) {
 	LIBS += -L$$PWD/3rd/cutelogger/lib/Debug -lLogger
-	LIBS += -L$$PWD/3rd/cpp_redis/lib/Debug -lcpp_redis
-	LIBS += -L$$PWD/3rd/tacopie/lib/Debug -ltacopie -lws2_32
+	LIBS += -lws2_32
 }
 CONFIG(release, debug|release) {
     LIBS += -L$$PWD/3rd/cutelogger/lib/Release -lLogger
-	LIBS += -L$$PWD/3rd/cpp_redis/lib/Release -lcpp_redis
-	LIBS += -L$$PWD/3rd/tacopie/lib/Release -ltacopie -lws2_32
+	LIBS += -lws2_32
 }
 }
 
 unix {
 CONFIG(debug, debug|release) {
     LIBS += -L$$PWD/3rd/cutelogger/lib/Debug -lLogger
-	LIBS += -L$$PWD/3rd/cpp_redis/lib/Debug -lcpp_redis
-	LIBS += -L$$PWD/3rd/tacopie/lib/Debug -ltacopie -lpthread
+	LIBS += -lpthread
 }
 CONFIG(release, debug|release) {
     LIBS += -L$$PWD/3rd/cutelogger/lib/Release -lLogger
-	LIBS += -L$$PWD/3rd/cpp_redis/lib/Release -lcpp_redis
-	LIBS += -L$$PWD/3rd/tacopie/lib/Release -ltacopie -lpthread
+	LIBS += -lpthread
 }
 }
@@ -64,6 +64,16 @@ struct IFireNetCore
 	//! Send chat message
 	virtual void SendChatMessage(EFireNetChatMsgType type, int uid = 0) = 0;
 
+	//! Join chat channel, for e.g. "clan:Wolves", "party:1024" or "match:7"
+	//! Clan, party and match channels can be joined only if game server added player to channel members
+	virtual void JoinChatChannel(const std::string &channel) = 0;
+
+	//! Leave chat channel
+	virtual void LeaveChatChannel(const std::string &channel) = 0;
+
+	//! Set status visible for friends. Offline status can't be set
+	virtual void SetStatus(EFireNetPlayerStatus status) = 0;
+
 	//! Send get game server request to master server
 	virtual void GetGameServer(const std::string &map, const std::string &gamerules) = 0;
 
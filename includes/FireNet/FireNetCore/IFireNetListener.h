@@ -73,6 +73,18 @@ enum EFireNetEvents
 	FIRENET_EVENT_GET_GAME_SERVER_COMPLETE,
 	//! Event when get game server failed
 	FIRENET_EVENT_GET_GAME_SERVER_FAILED,
+	//! Event when join chat channel complete
+	FIRENET_EVENT_JOIN_CHAT_CHANNEL_COMPLETE,
+	//! Event when join chat channel failed
+	FIRENET_EVENT_JOIN_CHAT_CHANNEL_FAILED,
+	//! Event when leave chat channel complete
+	FIRENET_EVENT_LEAVE_CHAT_CHANNEL_COMPLETE,
+	//! Event when leave chat channel failed
+	FIRENET_EVENT_LEAVE_CHAT_CHANNEL_FAILED,
+	//! Event when set status complete
+	FIRENET_EVENT_SET_STATUS_COMPLETE,
+	//! Event when set status failed
+	FIRENET_EVENT_SET_STATUS_FAILED,
 
 	// ~Special events
 
@@ -82,6 +94,12 @@ enum EFireNetEvents
 	FIRENET_EVENT_PRIVATE_CHAT_MSG_RECEIVED,
 	//! Event when client received clan chat message
 	FIRENET_EVENT_CLAN_CHAT_MSG_RECEIVED,
+	//! Event when client received party chat message
+	FIRENET_EVENT_PARTY_CHAT_MSG_RECEIVED,
+	//! Event when client received match chat message
+	FIRENET_EVENT_MATCH_CHAT_MSG_RECEIVED,
+	//! Event when status of friend changed. Sent for every friend with uid and EFireNetPlayerStatus
+	FIRENET_EVENT_FRIEND_STATUS_CHANGED,
 	//! Event when client received console command
 	FIRENET_EVENT_CONSOLE_COMMAND_RECEIVED,
 	//! Event when client received server message
@@ -0,0 +1,142 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+// Field cursor over packet text (TCP and UDP packets).
+// Reader keeps only offsets, packet data stays in packet owned buffer. When field readed separator
+// after it replaced by '\0', so string fields returned without any copy.
+class CFireNetPacketReader
+{
+public:
+	CFireNetPacketReader()
+		: m_Separator('|')
+		, m_Count(0)
+		, m_Index(0)
+		, m_Cursor(0)
+		, m_LastFieldOffset(0)
+	{}
+public:
+	// Count fields and move cursor to first field
+	std::size_t                        Init(const std::string &data, char separator)
+	{
+		m_Separator = separator;
+		m_Count = data.empty() ? 0 : 1;
+		m_Index = 0;
+		m_Cursor = 0;
+		m_LastFieldOffset = 0;
+
+		for (std::size_t i = 0; i < data.size(); ++i)
+		{
+			if (data[i] == separator || data[i] == '\0')
+			{
+				m_Count++;
+				m_LastFieldOffset = i + 1;
+			}
+		}
+
+		return m_Count;
+	}
+
+	std::size_t                        Count() const { return m_Count; }
+	std::size_t                        GetIndex() const { return m_Index; }
+	// Last field is packet footer, it can't be readed as data
+	bool                               CanRead() const { return m_Index + 1 < m_Count; }
+
+	// Return current field and move cursor to next field
+	const char*                        Next(std::string &data)
+	{
+		if (m_Index >= m_Count)
+			return nullptr;
+
+		const std::size_t start = m_Cursor;
+		std::size_t end = start;
+
+		while (end < data.size() && data[end] != m_Separator && data[end] != '\0')
+			end++;
+
+		if (end < data.size())
+			data[end] = '\0';
+
+		m_Cursor = end + 1;
+		m_Index++;
+
+		return data.c_str() + start;
+	}
+
+	// Last field without moving cursor
+	const char*                        Last(const std::string &data) const
+	{
+		return m_Count > 0 ? data.c_str() + m_LastFieldOffset : nullptr;
+	}
+
+	// Put separators back, after it packet data can be sended again
+	void                               Join(std::string &data) const
+	{
+		for (std::size_t i = 0; i < data.size(); ++i)
+		{
+			if (data[i] == '\0')
+				data[i] = m_Separator;
+		}
+	}
+public:
+	static bool                        ToInt(const char* field, int &value)
+	{
+		if (!field || *field == '\0')
+			return false;
+
+		char* end = nullptr;
+		errno = 0;
+		const long result = std::strtol(field, &end, 10);
+
+		if (*end != '\0' || errno == ERANGE || result > INT_MAX || result < INT_MIN)
+			return false;
+
+		value = static_cast<int>(result);
+		return true;
+	}
+
+	static bool                        ToFloat(const char* field, float &value)
+	{
+		if (!field || *field == '\0')
+			return false;
+
+		char* end = nullptr;
+		errno = 0;
+		const float result = std::strtof(field, &end);
+
+		if (*end != '\0' || errno == ERANGE)
+			return false;
+
+		value = result;
+		return true;
+	}
+
+	static bool                        ToDouble(const char* field, double &value)
+	{
+		if (!field || *field == '\0')
+			return false;
+
+		char* end = nullptr;
+		errno = 0;
+		const double result = std::strtod(field, &end);
+
+		if (*end != '\0' || errno == ERANGE)
+			return false;
+
+		value = result;
+		return true;
+	}
+private:
+	char                               m_Separator;
+	std::size_t                        m_Count;
+	std::size_t                        m_Index;
+	std::size_t                        m_Cursor;
+	std::size_t                        m_LastFieldOffset;
+};
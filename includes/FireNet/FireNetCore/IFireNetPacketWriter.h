@@ -0,0 +1,50 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#pragma once
+
+#include <string>
+#include <cstdio>
+
+// Append values to packet buffer in place (TCP and UDP packets).
+// Numbers formatted on stack, so writing field don't create temporary strings.
+class CFireNetPacketWriter
+{
+public:
+	static void                        AppendInt(std::string &data, int value)
+	{
+		char buffer[12];
+		char* end = buffer + sizeof(buffer);
+		char* begin = end;
+
+		unsigned int absValue = value < 0 ? 0u - static_cast<unsigned int>(value) : static_cast<unsigned int>(value);
+
+		do
+		{
+			*--begin = static_cast<char>('0' + absValue % 10);
+			absValue /= 10;
+		} while (absValue != 0);
+
+		if (value < 0)
+			*--begin = '-';
+
+		data.append(begin, end);
+	}
+
+	// Same format as std::to_string, so packets stay readable by old clients
+	static void                        AppendDouble(std::string &data, double value)
+	{
+		char buffer[64];
+		const int size = std::snprintf(buffer, sizeof(buffer), "%f", value);
+
+		if (size > 0 && size < static_cast<int>(sizeof(buffer)))
+			data.append(buffer, static_cast<std::size_t>(size));
+		else
+			data.append(std::to_string(value));
+	}
+
+	static void                        AppendFloat(std::string &data, float value)
+	{
+		AppendDouble(data, static_cast<double>(value));
+	}
+};
@@ -0,0 +1,192 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#pragma once
+
+#include <string>
+#include <cstring>
+
+#include "IFireNetTcpPacket.h"
+
+// TCP stream framing
+//
+// Legacy text packet : !0x0|type|data|...|0x0!
+// Binary frame       : [marker][length hi][length lo][type][payload]
+//
+// Payload of binary frame is legacy text packet, so both forms can be mixed in one stream.
+// Legacy packets always start with '!', binary frames with marker byte. Peer switch to binary
+// framing after first binary frame received from other side.
+
+enum class EFireNetTcpFrameFormat : int
+{
+	Legacy,
+	Binary,
+};
+
+enum class EFireNetTcpFrameHeader : int
+{
+	MARKER = 0xFB,
+	SIZE = 4,
+	// Length is 16 bit, bigger payload can't be framed
+	MAX_PAYLOAD = 0xFFFF,
+};
+
+struct SFireNetTcpFrame
+{
+	SFireNetTcpFrame() : format(EFireNetTcpFrameFormat::Legacy), type(EFireNetTcpPacketType::Empty) {}
+
+	EFireNetTcpFrameFormat format;
+	EFireNetTcpPacketType  type;
+	std::string            data;
+};
+
+// Write binary frame header to out (EFireNetTcpFrameHeader::SIZE bytes).
+// Return false and write nothing if size can't be stored in header
+inline bool FireNetWriteTcpFrameHeader(char* out, EFireNetTcpPacketType type, std::size_t size)
+{
+	if (size == 0 || size > static_cast<std::size_t>(EFireNetTcpFrameHeader::MAX_PAYLOAD))
+		return false;
+
+	out[0] = static_cast<char>(EFireNetTcpFrameHeader::MARKER);
+	out[1] = static_cast<char>((size >> 8) & 0xFF);
+	out[2] = static_cast<char>(size & 0xFF);
+	out[3] = static_cast<char>(type);
+
+	return true;
+}
+
+// Encode text packet to binary frame. Return empty string if packet too big for frame
+inline std::string FireNetEncodeTcpFrame(EFireNetTcpPacketType type, const char* data, std::size_t size)
+{
+	char header[static_cast<std::size_t>(EFireNetTcpFrameHeader::SIZE)];
+	if (!FireNetWriteTcpFrameHeader(header, type, size))
+		return std::string();
+
+	std::string frame;
+	frame.reserve(sizeof(header) + size);
+	frame.append(header, sizeof(header));
+	frame.append(data, size);
+
+	return frame;
+}
+
+inline std::string FireNetEncodeTcpFrame(IFireNetTcpPacket &packet)
+{
+	const char* data = packet.toString();
+	return FireNetEncodeTcpFrame(packet.getType(), data, packet.getLength());
+}
+
+// Streaming decoder : collects bytes from socket and cuts them to frames
+class CFireNetTcpFrameDecoder
+{
+public:
+	explicit CFireNetTcpFrameDecoder(std::size_t maxFrameSize = static_cast<std::size_t>(EFireNetTcpPackeMaxSize::SIZE))
+		: m_MaxFrameSize(maxFrameSize)
+		, m_ReadPos(0)
+		, bIsCorrupted(false)
+	{}
+public:
+	void                               Append(const char* data, std::size_t size)
+	{
+		if (bIsCorrupted || size == 0)
+			return;
+
+		// Drop already decoded bytes before buffer grows
+		if (m_ReadPos > 0 && m_ReadPos == m_Buffer.size())
+		{
+			m_Buffer.clear();
+			m_ReadPos = 0;
+		}
+		else if (m_ReadPos > m_MaxFrameSize)
+		{
+			m_Buffer.erase(0, m_ReadPos);
+			m_ReadPos = 0;
+		}
+
+		m_Buffer.append(data, size);
+	}
+
+	// Return true if full frame extracted. When stream can't be decoded IsCorrupted() become true
+	bool                               Next(SFireNetTcpFrame &frame)
+	{
+		if (bIsCorrupted || m_ReadPos >= m_Buffer.size())
+			return false;
+
+		const std::size_t available = m_Buffer.size() - m_ReadPos;
+		const unsigned char first = static_cast<unsigned char>(m_Buffer[m_ReadPos]);
+
+		if (first == static_cast<unsigned char>(EFireNetTcpFrameHeader::MARKER))
+		{
+			const std::size_t headerSize = static_cast<std::size_t>(EFireNetTcpFrameHeader::SIZE);
+
+			if (available < headerSize)
+				return false;
+
+			const std::size_t payloadSize = (static_cast<unsigned char>(m_Buffer[m_ReadPos + 1]) << 8) | static_cast<unsigned char>(m_Buffer[m_ReadPos + 2]);
+
+			if (payloadSize == 0 || payloadSize > m_MaxFrameSize)
+			{
+				bIsCorrupted = true;
+				return false;
+			}
+
+			if (available < headerSize + payloadSize)
+				return false;
+
+			frame.format = EFireNetTcpFrameFormat::Binary;
+			frame.type = static_cast<EFireNetTcpPacketType>(static_cast<unsigned char>(m_Buffer[m_ReadPos + 3]));
+			frame.data.assign(m_Buffer, m_ReadPos + headerSize, payloadSize);
+
+			m_ReadPos += headerSize + payloadSize;
+			return true;
+		}
+		else if (first == '!')
+		{
+			// Legacy packet ends with footer
+			const char* footer = "0x0!";
+			const std::size_t footerSize = 4;
+			const std::size_t end = m_Buffer.find(footer, m_ReadPos + 1, footerSize);
+
+			if (end == std::string::npos)
+			{
+				if (available > m_MaxFrameSize)
+					bIsCorrupted = true;
+
+				return false;
+			}
+
+			const std::size_t size = end + footerSize - m_ReadPos;
+
+			if (size > m_MaxFrameSize)
+			{
+				bIsCorrupted = true;
+				return false;
+			}
+
+			frame.format = EFireNetTcpFrameFormat::Legacy;
+			frame.type = EFireNetTcpPacketType::Empty;
+			frame.data.assign(m_Buffer, m_ReadPos, size);
+
+			m_ReadPos += size;
+			return true;
+		}
+
+		bIsCorrupted = true;
+		return false;
+	}
+
+	bool                               IsCorrupted() const { return bIsCorrupted; }
+	std::size_t                        GetBufferedSize() const { return m_Buffer.size() - m_ReadPos; }
+
+	void                               Reset()
+	{
+		m_Buffer.clear();
+		m_ReadPos = 0;
+		bIsCorrupted = false;
+	}
+private:
+	std::string                        m_Buffer;
+	std::size_t                        m_MaxFrameSize;
+	std::size_t                        m_ReadPos;
+	bool                               bIsCorrupted;
+};
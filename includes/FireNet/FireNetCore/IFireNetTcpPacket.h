@@ -4,9 +4,10 @@
 #pragma once
 
 #include <string>
-#include <sstream>
 #include <vector>
-#include <stdexcept>
+
+#include "IFireNetPacketReader.h"
+#include "IFireNetPacketWriter.h"
 
 enum class EFireNetTcpPacketType : int
 {
@@ -38,6 +39,12 @@ enum class EFireNetTcpQuery : int
 	RegisterServer,
 	UpdateServer,
 	UpdateProfile,
+	// Chat channels
+	JoinChatChannel,
+	LeaveChatChannel,
+	SetStatus,
+	// Remote only, members of clan, party and match chat channels
+	SetChatMember,
 };
 
 enum class EFireNetTcpResult : int
@@ -62,6 +69,12 @@ enum class EFireNetTcpResult : int
 	RegisterServerComplete,
 	UpdateServerComplete,
 	UpdateProfileComplete,
+	// Client already have this shop version
+	GetShopNotModified,
+	JoinChatChannelComplete,
+	LeaveChatChannelComplete,
+	SetStatusComplete,
+	SetChatMemberComplete,
 };
 
 enum class EFireNetTcpError : int
@@ -85,6 +98,10 @@ enum class EFireNetTcpError : int
 	RegisterServerFail,
 	UpdateServerFail,
 	UpdateProfileFail,
+	JoinChatChannelFail,
+	LeaveChatChannelFail,
+	SetStatusFail,
+	SetChatMemberFail,
 };
 
 // Only server to client
@@ -95,6 +112,10 @@ enum class EFireNetTcpSMessage : int
 	ClanChatMsg,
 	ServerMessage,
 	ServerCommand,
+	PartyChatMsg,
+	MatchChatMsg,
+	// Count, then uid and status of every changed friend
+	FriendsStatus,
 };
 
 // Max TCP packet size
@@ -128,40 +149,38 @@ public:
 	virtual double                     ReadDouble() = 0;
 public: 
 	virtual const char*                toString() = 0;
-	virtual std::size_t                getLength() { return strlen(m_Data.c_str()); }
+	virtual std::size_t                getLength() { return m_Data.size(); }
 public:
 	EFireNetTcpPacketType              getType() { return m_Type; }
+	// Received packet still have unread fields, used for optional fields at end of packet
+	bool                               CanReadMore() const { return bInitFromData && bIsGoodPacket && m_Reader.CanRead(); }
 protected:
 	void                               WritePacketType(EFireNetTcpPacketType type) { WriteInt(static_cast<int>(type)); }
 	void                               WriteHeader() { WriteString(m_Header); }
-	void                               WriteFooter() { m_Data = m_Data + m_Footer; };
+	void                               WriteFooter()
+	{
+		if (!bIsCompleted)
+		{
+			m_Data.append(m_Footer);
+			bIsCompleted = true;
+		}
+	}
 protected:
 	virtual void                       GenerateSession() = 0;
 	virtual void                       ReadPacket() = 0;
-protected:
-	std::vector<std::string>           Split(const std::string &s, char separator)
-	{
-		std::stringstream ss;
-		ss.str(s);
-		std::string item;
-		std::vector<std::string> m_vector;
-
-		while (std::getline(ss, item, separator))
-			m_vector.push_back(item);
-
-		return m_vector;
-	}
 protected:
 	std::string                        m_Data;
 	char                               m_Separator;
 	std::string                        m_Header;
 	std::string                        m_Footer;
 
-	std::vector<std::string>           m_Packet;
+	CFireNetPacketReader               m_Reader;
 	EFireNetTcpPacketType              m_Type;
 
+	// Only for writing
+	bool                               bIsCompleted;
+
 	// Only for reading
 	bool                               bInitFromData;
 	bool                               bIsGoodPacket;
-	int                                m_LastIndex;
 }; 
\ No newline at end of file
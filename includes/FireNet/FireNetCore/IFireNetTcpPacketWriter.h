@@ -0,0 +1,73 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#pragma once
+
+#include "IFireNetTcpPacket.h"
+
+// Writing part of TCP packet without logging, shared by server packet and packet benchmark.
+// Reading and toString stay in packet class, they report errors through own log
+class CFireNetTcpPacketWriter : public IFireNetTcpPacket
+{
+protected:
+	// For received packets, fields set by packet class
+	CFireNetTcpPacketWriter() {}
+
+	explicit CFireNetTcpPacketWriter(EFireNetTcpPacketType type)
+	{
+		m_Separator = '|';
+		m_Type = type;
+
+		// Only for writing
+		bIsCompleted = false;
+		m_Data.reserve(static_cast<std::size_t>(EFireNetTcpPackeMaxSize::SIZE));
+
+		// Only for reading
+		bInitFromData = false;
+		bIsGoodPacket = false;
+
+		GenerateSession();
+		WriteHeader();
+		WritePacketType(type);
+	}
+public:
+	virtual void                       WriteString(const std::string &value) override
+	{
+		m_Data.append(value);
+		m_Data.push_back(m_Separator);
+	}
+	virtual void                       WriteInt(int value) override
+	{
+		CFireNetPacketWriter::AppendInt(m_Data, value);
+		m_Data.push_back(m_Separator);
+	}
+	virtual void                       WriteBool(bool value) override
+	{
+		CFireNetPacketWriter::AppendInt(m_Data, value ? 1 : 0);
+		m_Data.push_back(m_Separator);
+	}
+	virtual void                       WriteFloat(float value) override
+	{
+		CFireNetPacketWriter::AppendFloat(m_Data, value);
+		m_Data.push_back(m_Separator);
+	}
+	virtual void                       WriteDouble(double value) override
+	{
+		CFireNetPacketWriter::AppendDouble(m_Data, value);
+		m_Data.push_back(m_Separator);
+	}
+protected:
+	// Packet data with footer
+	const char*                        FinishWriting()
+	{
+		WriteFooter();
+		return m_Data.c_str();
+	}
+
+	virtual void                       GenerateSession() override
+	{
+		// TODO
+		m_Header = "!0x0";
+		m_Footer = "0x0!";
+	}
+};
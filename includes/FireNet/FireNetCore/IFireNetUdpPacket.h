@@ -4,9 +4,10 @@
 #pragma once
 
 #include <string>
-#include <sstream>
 #include <vector>
-#include <stdexcept>
+
+#include "IFireNetPacketReader.h"
+#include "IFireNetPacketWriter.h"
 
 enum class EFireNetUdpPacketType : int
 {
@@ -76,7 +77,7 @@ public:
 	virtual double                     ReadDouble() = 0;
 public:
 	virtual const char*                toString() = 0;	
-	virtual std::size_t                getLength() { return strlen(m_Data.c_str()); }
+	virtual std::size_t                getLength() { return m_Data.size(); }
 public:
 	EFireNetUdpPacketType              getType() { return m_Type; }
 	int                                getPacketNumber() { return m_PacketNumber; }
@@ -84,37 +85,33 @@ public:
 protected:
 	void                               WritePacketType(EFireNetUdpPacketType type) { WriteInt(static_cast<int>(type)); }
 	void                               WriteHeader() { WriteString(m_Header); }
-	void                               WriteFooter() { m_Data = m_Data + m_Footer; };
+	void                               WriteFooter()
+	{
+		if (!bIsCompleted)
+		{
+			m_Data.append(m_Footer);
+			bIsCompleted = true;
+		}
+	}
 protected:
 	virtual void                       GenerateSession() = 0;
 	virtual void                       ReadPacket() = 0;
 	virtual void                       EncryptPacket() = 0;
 	virtual void                       DecryptPacket() = 0;
-protected:
-	std::vector<std::string>           Split(const std::string &s, char separator)
-	{
-		std::stringstream ss;
-		ss.str(s);
-		std::string item;
-		std::vector<std::string> m_vector;
-
-		while (std::getline(ss, item, separator))
-			m_vector.push_back(item);
-
-		return m_vector;
-	}
 protected:
 	std::string                        m_Data;
 	char                               m_Separator;
 	std::string                        m_Header;
 	std::string                        m_Footer;
 
-	std::vector<std::string>           m_Packet;
+	CFireNetPacketReader               m_Reader;
 	EFireNetUdpPacketType              m_Type;
 
+	// Only for writing
+	bool                               bIsCompleted;
+
 	// Only for reading
 	bool                               bInitFromData;
 	bool                               bIsGoodPacket;
-	int                                m_LastIndex;
 	int                                m_PacketNumber;
 };
\ No newline at end of file
@@ -9,11 +9,14 @@ CUdpPacket::CUdpPacket(int packetNumber, EFireNetUdpPacketType type)
 	m_Separator = '|';
 	m_Type = type;
 
+	// Only for writing
+	bIsCompleted = false;
+	m_Data.reserve(static_cast<std::size_t>(EFireNetUdpPackeMaxSize::SIZE));
+
 	// Only for reading
 	bInitFromData = false;
 	bIsGoodPacket = false;
 
-	m_LastIndex = 0;
 	m_PacketNumber = 0;
 
 	GenerateSession();
@@ -31,10 +34,10 @@ CUdpPacket::CUdpPacket(const char * data)
 		m_Type = EFireNetUdpPacketType::Empty;
 		m_Separator = '|';
 
+		bIsCompleted = true;
 		bInitFromData = true;
 		bIsGoodPacket = false;
 
-		m_LastIndex = 0;
 		m_PacketNumber = 0;
 
 		GenerateSession();
@@ -44,43 +47,49 @@ CUdpPacket::CUdpPacket(const char * data)
 	{
 		CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Empty UDP packet!");
 		m_Type = EFireNetUdpPacketType::Empty;
+		bIsCompleted = true;
+		bInitFromData = true;
+		bIsGoodPacket = false;
 	}
 }
 
 void CUdpPacket::WriteString(const std::string & value)
 {
-	m_Data = m_Data + value + m_Separator;
+	m_Data.append(value);
+	m_Data.push_back(m_Separator);
 }
 
 void CUdpPacket::WriteInt(int value)
 {
-	m_Data = m_Data + std::to_string(value) + m_Separator;
+	CFireNetPacketWriter::AppendInt(m_Data, value);
+	m_Data.push_back(m_Separator);
 }
 
 void CUdpPacket::WriteBool(bool value)
 {
-	int m_value = value ? 1 : 0;
-	m_Data = m_Data + std::to_string(m_value) + m_Separator;
+	CFireNetPacketWriter::AppendInt(m_Data, value ? 1 : 0);
+	m_Data.push_back(m_Separator);
 }
 
 void CUdpPacket::WriteFloat(float value)
 {
-	m_Data = m_Data + std::to_string(value) + m_Separator;
+	CFireNetPacketWriter::AppendFloat(m_Data, value);
+	m_Data.push_back(m_Separator);
 }
 
 void CUdpPacket::WriteDouble(double value)
 {
-	m_Data = m_Data + std::to_string(value) + m_Separator;
+	CFireNetPacketWriter::AppendDouble(m_Data, value);
+	m_Data.push_back(m_Separator);
 }
 
 const char * CUdpPacket::ReadString()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
-			return m_Packet.at(m_LastIndex - 1).c_str();
+			return m_Reader.Next(m_Data);
 		}
 		else
 		{
@@ -99,19 +108,16 @@ int CUdpPacket::ReadInt()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
+			int value = 0;
 
-			try
-			{
-				return std::stoi(m_Packet.at(m_LastIndex - 1));
-			}
-			catch (std::invalid_argument &)
+			if (!CFireNetPacketReader::ToInt(m_Reader.Next(m_Data), value))
 			{
 				CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_ERROR, TITLE "Error reading int from UDP packet. Can't convert string to int");
-				return 0;
 			}
+
+			return value;
 		}
 		else
 		{
@@ -135,19 +141,16 @@ float CUdpPacket::ReadFloat()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
+			float value = 0.0f;
 
-			try
-			{
-				return std::stof(m_Packet.at(m_LastIndex - 1));
-			}
-			catch (std::invalid_argument &)
+			if (!CFireNetPacketReader::ToFloat(m_Reader.Next(m_Data), value))
 			{
 				CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Error reading float from UDP packet. Can't convert string to float");
-				return 0.0f;
 			}
+
+			return value;
 		}
 		else
 		{
@@ -166,19 +169,16 @@ double CUdpPacket::ReadDouble()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
+			double value = 0.0;
 
-			try
-			{
-				return std::stod(m_Packet.at(m_LastIndex - 1));
-			}
-			catch (std::invalid_argument &)
+			if (!CFireNetPacketReader::ToDouble(m_Reader.Next(m_Data), value))
 			{
 				CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Error reading double from TCP packet. Can't convert string to double");
-				return 0.0;
 			}
+
+			return value;
 		}
 		else
 		{
@@ -211,7 +211,11 @@ const char * CUdpPacket::toString()
 		return m_Data.c_str();
 	}
 	else
+	{
+		// Fields of received packet terminated in place by reader, put separators back
+		m_Reader.Join(m_Data);
 		return m_Data.c_str();
+	}
 }
 
 void CUdpPacket::GenerateSession()
@@ -226,7 +230,6 @@ void CUdpPacket::ReadPacket()
 	if (!m_Data.empty())
 	{
 		DecryptPacket();
-		m_Packet = Split(m_Data, m_Separator);
 
 		ICVar* debug = gEnv->pConsole->GetCVar("firenet_packet_debug");
 
@@ -236,22 +239,24 @@ void CUdpPacket::ReadPacket()
 			CryLog(TITLE "Input UDP packet size : %d", getLength());
 		}
 
-		if (m_Packet.size() >= 4)
+		if (m_Reader.Init(m_Data, m_Separator) >= 4)
 		{
-			std::string packet_header = m_Packet.at(0);
-			std::string packet_type = m_Packet.at(1);
-			std::string packet_number = m_Packet.at(2);
-			std::string packet_footer = m_Packet.at(m_Packet.size() - 1);
+			// 0 - header, 1 - type, 2 - packet number, 3 - start data
+			const char* packet_header = m_Reader.Next(m_Data);
+			const char* packet_type = m_Reader.Next(m_Data);
+			const char* packet_number = m_Reader.Next(m_Data);
+			const char* packet_footer = m_Reader.Last(m_Data);
 
 			if (packet_header == m_Header && packet_footer == m_Footer)
 			{
-				m_Type = (EFireNetUdpPacketType)std::stoi(packet_type);
-				m_PacketNumber = std::stoi(packet_number);
+				int type = 0;
+				CFireNetPacketReader::ToInt(packet_type, type);
+				CFireNetPacketReader::ToInt(packet_number, m_PacketNumber);
+				m_Type = (EFireNetUdpPacketType)type;
 
 				if (m_Type != EFireNetUdpPacketType::Empty)
 				{
 					bIsGoodPacket = true;
-					m_LastIndex = 3; // 0 - header, 1 - type, 2 - packet number, 3 - start data
 				}
 				else
 				{
@@ -37,6 +37,7 @@ CFireNetCorePlugin::~CFireNetCorePlugin()
 		pConsole->UnregisterVariable("firenet_ip");
 		pConsole->UnregisterVariable("firenet_port");
 		pConsole->UnregisterVariable("firenet_timeout");
+		pConsole->UnregisterVariable("firenet_binary_framing");
 #ifndef NDEBUG
 		pConsole->UnregisterVariable("firenet_packet_debug");
 #endif
@@ -127,6 +128,7 @@ void CFireNetCorePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT
 		mEnv->net_ip = REGISTER_STRING("firenet_ip", "127.0.0.1", VF_NULL, "Sets the FireNet master server ip address");
 		REGISTER_CVAR2("firenet_port", &mEnv->net_port, 3322, VF_CHEAT, "FireNet master server port");
 		REGISTER_CVAR2("firenet_timeout", &mEnv->net_timeout, 10, VF_NULL, "FireNet master server timeout");
+		REGISTER_CVAR2("firenet_binary_framing", &mEnv->net_binary_framing, 1, VF_NULL, "Use length-prefixed binary framing for TCP packets (0 - legacy text packets)");
 
 		if(gEnv->IsDedicated())
 			REGISTER_CVAR2("firenet_remote_port", &mEnv->net_remote_port, 5200, VF_CHEAT, "FireNet master server port for game server");
@@ -258,6 +260,7 @@ void CFireNetCorePlugin::GetShop()
 
 	CTcpPacket packet(EFireNetTcpPacketType::Query);
 	packet.WriteQuery(EFireNetTcpQuery::GetShop);
+	packet.WriteInt(mEnv->m_ShopVersion);
 
 	mEnv->SendPacket(packet);
 }
@@ -371,6 +374,60 @@ void CFireNetCorePlugin::SendChatMessage(EFireNetChatMsgType type, int uid)
 	mEnv->SendPacket(packet);
 }
 
+void CFireNetCorePlugin::JoinChatChannel(const std::string & channel)
+{
+	CryLog(TITLE "Try join chat channel");
+
+	if (!channel.empty())
+	{
+		CTcpPacket packet(EFireNetTcpPacketType::Query);
+		packet.WriteQuery(EFireNetTcpQuery::JoinChatChannel);
+		packet.WriteString(channel.c_str());
+
+		mEnv->SendPacket(packet);
+	}
+	else
+	{
+		CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE  "Can't join chat channel. Empty channel name");
+	}
+}
+
+void CFireNetCorePlugin::LeaveChatChannel(const std::string & channel)
+{
+	CryLog(TITLE "Try leave chat channel");
+
+	if (!channel.empty())
+	{
+		CTcpPacket packet(EFireNetTcpPacketType::Query);
+		packet.WriteQuery(EFireNetTcpQuery::LeaveChatChannel);
+		packet.WriteString(channel.c_str());
+
+		mEnv->SendPacket(packet);
+	}
+	else
+	{
+		CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE  "Can't leave chat channel. Empty channel name");
+	}
+}
+
+void CFireNetCorePlugin::SetStatus(EFireNetPlayerStatus status)
+{
+	CryLog(TITLE "Try set status");
+
+	if (status != EStatus_Offline)
+	{
+		CTcpPacket packet(EFireNetTcpPacketType::Query);
+		packet.WriteQuery(EFireNetTcpQuery::SetStatus);
+		packet.WriteInt(status);
+
+		mEnv->SendPacket(packet);
+	}
+	else
+	{
+		CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE  "Can't set status. Offline status can't be set");
+	}
+}
+
 void CFireNetCorePlugin::GetGameServer(const std::string & map, const std::string & gamerules)
 {
 	CryLog(TITLE "Try get game server");
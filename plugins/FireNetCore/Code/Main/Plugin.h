@@ -53,6 +53,9 @@ public:
 	virtual void             AcceptInvite() override;
 	virtual void             RemoveFriend(int uid) override;
 	virtual void             SendChatMessage(EFireNetChatMsgType type, int uid = 0) override;
+	virtual void             JoinChatChannel(const std::string &channel) override;
+	virtual void             LeaveChatChannel(const std::string &channel) override;
+	virtual void             SetStatus(EFireNetPlayerStatus status) override;
 	virtual void             GetGameServer(const std::string &map, const std::string &gamerules) override;
 	virtual void             SendRawRequestToMasterServer(CTcpPacket &packet) override;
 	virtual bool             IsConnected() override;
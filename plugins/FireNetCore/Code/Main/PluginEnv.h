@@ -22,6 +22,9 @@ struct SPluginEnv
 		net_port = 0;
 		net_timeout = 0;
 		net_debug = 0;
+		net_binary_framing = 1;
+
+		m_ShopVersion = 0;
 	}
 
 	// Pointers
@@ -31,12 +34,17 @@ struct SPluginEnv
 	// Containers
 	std::vector<IFireNetListener*>    m_Listeners;
 
+	// Last received shop, server don't send it again while version same
+	std::string                       m_Shop;
+	int                               m_ShopVersion;
+
 	// CVars
 	ICVar*                            net_ip;
 	int                               net_port;
 	int                               net_remote_port;
 	int                               net_timeout;
 	int                               net_debug;
+	int                               net_binary_framing;
 
 	// Send FireNet event with arguments
 	inline void SendFireNetEvent(EFireNetEvents event, SFireNetEventArgs& args = SFireNetEventArgs())
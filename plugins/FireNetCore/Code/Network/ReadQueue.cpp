@@ -56,13 +56,11 @@ void CReadQueue::ReadResult(CTcpPacket & packet, EFireNetTcpResult result)
 	}
 	case EFireNetTcpResult::LoginCompleteWithProfile :
 	{
-		CryLog(TITLE "Authorization complete. Profile loading...");
+		CryLog(TITLE "Authorization complete. Loading profile...");
 		mEnv->SendFireNetEvent(FIRENET_EVENT_AUTHORIZATION_COMPLETE_WITH_PROFILE);
-
-		if (gFireNet && gFireNet->pCore)
-		{
-			gFireNet->pCore->GetProfile();
-		}
+		// Profile comes with login result, game get same events as after GetProfile
+		mEnv->SendFireNetEvent(FIRENET_EVENT_GET_PROFILE_COMPLETE);
+		LoadProfile(packet);
 
 		break;
 	}	
@@ -94,6 +92,16 @@ void CReadQueue::ReadResult(CTcpPacket & packet, EFireNetTcpResult result)
 		CryLog(TITLE "Get shop complete. Loading...");
 		LoadShop(packet);
 
+		break;
+	}
+	case EFireNetTcpResult::GetShopNotModified :
+	{
+		CryLog(TITLE "Shop not changed. Loading last received shop...");
+
+		SFireNetEventArgs shop;
+		shop.AddString(mEnv->m_Shop.c_str());
+		mEnv->SendFireNetEvent(FIRENET_EVENT_GET_SHOP_COMPLETE, shop);
+
 		break;
 	}	
 	case EFireNetTcpResult::BuyItemComplete :
@@ -149,6 +157,36 @@ void CReadQueue::ReadResult(CTcpPacket & packet, EFireNetTcpResult result)
 		LoadGameServerInfo(packet);
 		break;
 	}
+	case EFireNetTcpResult::JoinChatChannelComplete :
+	{
+		string channel = packet.ReadString();
+		CryLog(TITLE "Join chat channel %s complete", channel);
+
+		SFireNetEventArgs args;
+		args.AddString(channel);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_JOIN_CHAT_CHANNEL_COMPLETE, args);
+		break;
+	}
+	case EFireNetTcpResult::LeaveChatChannelComplete :
+	{
+		string channel = packet.ReadString();
+		CryLog(TITLE "Leave chat channel %s complete", channel);
+
+		SFireNetEventArgs args;
+		args.AddString(channel);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_LEAVE_CHAT_CHANNEL_COMPLETE, args);
+		break;
+	}
+	case EFireNetTcpResult::SetStatusComplete :
+	{
+		int status = packet.ReadInt();
+		CryLog(TITLE "Set status %d complete", status);
+
+		SFireNetEventArgs args;
+		args.AddInt(status);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_SET_STATUS_COMPLETE, args);
+		break;
+	}
 	default:
 		break;
 	}
@@ -241,6 +279,24 @@ void CReadQueue::ReadError(CTcpPacket & packet, EFireNetTcpError error)
 		mEnv->SendFireNetEvent(FIRENET_EVENT_GET_GAME_SERVER_FAILED, args);
 		break;
 	}
+	case EFireNetTcpError::JoinChatChannelFail :
+	{
+		CryLog(TITLE "Join chat channel failed. Reason = %d", reason);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_JOIN_CHAT_CHANNEL_FAILED, args);
+		break;
+	}
+	case EFireNetTcpError::LeaveChatChannelFail :
+	{
+		CryLog(TITLE "Leave chat channel failed. Reason = %d", reason);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_LEAVE_CHAT_CHANNEL_FAILED, args);
+		break;
+	}
+	case EFireNetTcpError::SetStatusFail :
+	{
+		CryLog(TITLE "Set status failed. Reason = %d", reason);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_SET_STATUS_FAILED, args);
+		break;
+	}
 	default:
 		break;
 	}
@@ -289,15 +345,74 @@ void CReadQueue::ReadServerMsg(CTcpPacket & packet, EFireNetTcpSMessage serverMs
 		string from = packet.ReadString();
 		string msg = packet.ReadString();
 
+		string channel = packet.ReadString();
+
 		CryLog(TITLE "[ClanChat] %s : %s", from, msg);
 
 		SFireNetEventArgs chat;
 		chat.AddString(from);
 		chat.AddString(msg);
+		chat.AddString(channel);
 		mEnv->SendFireNetEvent(FIRENET_EVENT_CLAN_CHAT_MSG_RECEIVED, chat);
 
 		break;
 	}
+	case EFireNetTcpSMessage::PartyChatMsg :
+	{
+		CryLog(TITLE "Received party chat message");
+
+		string from = packet.ReadString();
+		string msg = packet.ReadString();
+		string channel = packet.ReadString();
+
+		CryLog(TITLE "[PartyChat] %s : %s", from, msg);
+
+		SFireNetEventArgs chat;
+		chat.AddString(from);
+		chat.AddString(msg);
+		chat.AddString(channel);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_PARTY_CHAT_MSG_RECEIVED, chat);
+
+		break;
+	}
+	case EFireNetTcpSMessage::MatchChatMsg :
+	{
+		CryLog(TITLE "Received match chat message");
+
+		string from = packet.ReadString();
+		string msg = packet.ReadString();
+		string channel = packet.ReadString();
+
+		CryLog(TITLE "[MatchChat] %s : %s", from, msg);
+
+		SFireNetEventArgs chat;
+		chat.AddString(from);
+		chat.AddString(msg);
+		chat.AddString(channel);
+		mEnv->SendFireNetEvent(FIRENET_EVENT_MATCH_CHAT_MSG_RECEIVED, chat);
+
+		break;
+	}
+	case EFireNetTcpSMessage::FriendsStatus :
+	{
+		// Server collect status changes, so one message can have few friends
+		int count = packet.ReadInt();
+
+		CryLog(TITLE "Received status of %d friends", count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			int uid = packet.ReadInt();
+			int status = packet.ReadInt();
+
+			SFireNetEventArgs friendStatus;
+			friendStatus.AddInt(uid);
+			friendStatus.AddInt(status);
+			mEnv->SendFireNetEvent(FIRENET_EVENT_FRIEND_STATUS_CHANGED, friendStatus);
+		}
+
+		break;
+	}
 	case EFireNetTcpSMessage::ServerMessage :
 	{
 		CryLog(TITLE "Received server message");
@@ -366,6 +481,10 @@ void CReadQueue::LoadShop(CTcpPacket & packet)
 {
 	string rawShop = packet.ReadString();
 
+	// Remember shop with version for next requests. Old servers don't send version
+	mEnv->m_Shop = rawShop.c_str();
+	mEnv->m_ShopVersion = packet.CanReadMore() ? packet.ReadInt() : 0;
+
 	// Send event with shop data
 	SFireNetEventArgs shop;
 	shop.AddString(rawShop);
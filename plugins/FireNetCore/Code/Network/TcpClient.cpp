@@ -9,6 +9,7 @@
 CTcpClient::CTcpClient(BoostIO & io_service, BoostSslContex & context) : m_SslSocket(io_service, context) 
 	, m_IO_service(io_service)
 	, m_Timer(io_service)
+	, m_Decoder(0xFFFF) // Server answers (shop list, etc.) can be bigger than query packets
 	, pReadQueue(nullptr)
 	, bIsConnected(false)
 	, bIsClosing(false)
@@ -50,10 +51,19 @@ void CTcpClient::TimeOutCheck()
 
 void CTcpClient::AddToSendQueue(CTcpPacket & packet)
 {
-	m_IO_service.post([this, packet]()
+	std::string message = mEnv->net_binary_framing > 0 ? FireNetEncodeTcpFrame(packet) : std::string(packet.toString());
+
+	// Oversized packet can't be framed, sending it would desync stream
+	if (message.empty() || message.size() > static_cast<std::size_t>(EFireNetTcpFrameHeader::MAX_PAYLOAD) + static_cast<std::size_t>(EFireNetTcpFrameHeader::SIZE))
+	{
+		CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Can't send packet. Packet too big");
+		return;
+	}
+
+	m_IO_service.post([this, message]()
 	{
 		bool write_in_progress = !m_Queue.empty();
-		m_Queue.push(packet);
+		m_Queue.push(message);
 		if (!write_in_progress)
 		{
 			Do_Write();
@@ -198,8 +208,6 @@ void CTcpClient::Do_Handshake()
 
 void CTcpClient::Do_Read()
 {
-	std::memset(m_ReadBuffer, 0, static_cast<int>(EFireNetTcpPackeMaxSize::SIZE));
-
 	m_SslSocket.async_read_some(boost::asio::buffer(m_ReadBuffer, static_cast<int>(EFireNetTcpPackeMaxSize::SIZE)), [this](boost::system::error_code ec, std::size_t length)
 	{
 		if (!ec)
@@ -208,8 +216,23 @@ void CTcpClient::Do_Read()
 
 			m_MessageStatus = ETcpMessageStatus::Recieved;
 
-			CTcpPacket packet(m_ReadBuffer);
-			pReadQueue->ReadPacket(packet);
+			// One read can contain several packets or only part of packet
+			m_Decoder.Append(m_ReadBuffer, length);
+
+			SFireNetTcpFrame frame;
+			while (m_Decoder.Next(frame))
+			{
+				CTcpPacket packet(frame.data.c_str());
+				pReadQueue->ReadPacket(packet);
+			}
+
+			if (m_Decoder.IsCorrupted())
+			{
+				CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE  "Can't decode TCP stream from master server");
+
+				On_Disconnected();
+				return;
+			}
 
 			Do_Read();
 		}
@@ -224,10 +247,9 @@ void CTcpClient::Do_Read()
 
 void CTcpClient::Do_Write()
 {
-	const char* packetData = m_Queue.front().toString();
-	size_t      packetSize = strlen(packetData);
+	const std::string &message = m_Queue.front();
 
-	async_write(m_SslSocket, boost::asio::buffer(packetData, packetSize), [this](boost::system::error_code ec, std::size_t length)
+	async_write(m_SslSocket, boost::asio::buffer(message.data(), message.size()), [this](boost::system::error_code ec, std::size_t length)
 	{
 		if (!ec)
 		{
@@ -14,6 +14,8 @@
 
 #include "TcpPacket.h"
 
+#include <FireNetCore/IFireNetTcpFrame.h>
+
 class CReadQueue;
 
 typedef boost::asio::io_service        BoostIO;
@@ -65,7 +67,8 @@ private:
 private:
 	ETcpClientStatus        m_Status;
 	ETcpMessageStatus       m_MessageStatus;
-	std::queue <CTcpPacket> m_Queue;
+	std::queue <std::string> m_Queue;
+	CFireNetTcpFrameDecoder m_Decoder;
 
 	CReadQueue*             pReadQueue;
 
@@ -9,10 +9,13 @@ CTcpPacket::CTcpPacket(EFireNetTcpPacketType type)
 	m_Separator = '|';
 	m_Type = type;
 
+	// Only for writing
+	bIsCompleted = false;
+	m_Data.reserve(static_cast<std::size_t>(EFireNetTcpPackeMaxSize::SIZE));
+
 	// Only for reading
 	bInitFromData = false;
 	bIsGoodPacket = false;
-	m_LastIndex = 0;
 
 	GenerateSession();
 	WriteHeader();
@@ -27,9 +30,9 @@ CTcpPacket::CTcpPacket(const char * data)
 		m_Type = EFireNetTcpPacketType::Empty;
 		m_Separator = '|';
 
+		bIsCompleted = true;
 		bInitFromData = true;
 		bIsGoodPacket = false;
-		m_LastIndex = 0;
 
 		GenerateSession();
 		ReadPacket();
@@ -38,43 +41,49 @@ CTcpPacket::CTcpPacket(const char * data)
 	{
 		CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Empty TCP packet!");
 		m_Type = EFireNetTcpPacketType::Empty;
+		bIsCompleted = true;
+		bInitFromData = true;
+		bIsGoodPacket = false;
 	}
 }
 
 void CTcpPacket::WriteString(const std::string & value)
 {
-	m_Data = m_Data + value + m_Separator;
+	m_Data.append(value);
+	m_Data.push_back(m_Separator);
 }
 
 void CTcpPacket::WriteInt(int value)
 {
-	m_Data = m_Data + std::to_string(value) + m_Separator;
+	CFireNetPacketWriter::AppendInt(m_Data, value);
+	m_Data.push_back(m_Separator);
 }
 
 void CTcpPacket::WriteBool(bool value)
 {
-	int m_value = value ? 1 : 0;
-	m_Data = m_Data + std::to_string(m_value) + m_Separator;
+	CFireNetPacketWriter::AppendInt(m_Data, value ? 1 : 0);
+	m_Data.push_back(m_Separator);
 }
 
 void CTcpPacket::WriteFloat(float value)
 {
-	m_Data = m_Data + std::to_string(value) + m_Separator;
+	CFireNetPacketWriter::AppendFloat(m_Data, value);
+	m_Data.push_back(m_Separator);
 }
 
 void CTcpPacket::WriteDouble(double value)
 {
-	m_Data = m_Data + std::to_string(value) + m_Separator;
+	CFireNetPacketWriter::AppendDouble(m_Data, value);
+	m_Data.push_back(m_Separator);
 }
 
 const char * CTcpPacket::ReadString()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
-			return m_Packet.at(m_LastIndex - 1).c_str();
+			return m_Reader.Next(m_Data);
 		}
 		else
 		{
@@ -93,19 +102,16 @@ int CTcpPacket::ReadInt()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
+			int value = 0;
 
-			try
-			{
-				return std::stoi(m_Packet.at(m_LastIndex - 1));
-			}
-			catch (std::invalid_argument &)
+			if (!CFireNetPacketReader::ToInt(m_Reader.Next(m_Data), value))
 			{
 				CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_ERROR, TITLE "Error reading int from TCP packet. Can't convert string to int");
-				return 0;
 			}
+
+			return value;
 		}
 		else
 		{
@@ -129,19 +135,16 @@ float CTcpPacket::ReadFloat()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
+			float value = 0.0f;
 
-			try
-			{
-				return std::stof(m_Packet.at(m_LastIndex - 1));
-			}
-			catch (std::invalid_argument &)
+			if (!CFireNetPacketReader::ToFloat(m_Reader.Next(m_Data), value))
 			{
 				CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Error reading float from TCP packet. Can't convert string to float");
-				return 0.0f;
 			}
+
+			return value;
 		}
 		else
 		{
@@ -160,19 +163,16 @@ double CTcpPacket::ReadDouble()
 {
 	if (bInitFromData && bIsGoodPacket)
 	{
-		if (m_Packet.size() - 1 > m_LastIndex)
+		if (m_Reader.CanRead())
 		{
-			m_LastIndex++;
+			double value = 0.0;
 
-			try
-			{
-				return std::stod(m_Packet.at(m_LastIndex - 1));
-			}
-			catch (std::invalid_argument &)
+			if (!CFireNetPacketReader::ToDouble(m_Reader.Next(m_Data), value))
 			{
 				CryWarning(VALIDATOR_MODULE_NETWORK, VALIDATOR_ERROR, TITLE "Error reading double from TCP packet. Can't convert string to double");
-				return 0.0;
 			}
+
+			return value;
 		}
 		else
 		{
@@ -203,7 +203,11 @@ const char * CTcpPacket::toString()
 		return m_Data.c_str();
 	}
 	else
+	{
+		// Fields of received packet terminated in place by reader, put separators back
+		m_Reader.Join(m_Data);
 		return m_Data.c_str();
+	}
 }
 
 void CTcpPacket::GenerateSession()
@@ -217,8 +221,6 @@ void CTcpPacket::ReadPacket()
 {
 	if (!m_Data.empty())
 	{
-		m_Packet = Split(m_Data, m_Separator);
-
 		// Packet debugging
 		if (mEnv->net_debug > 0)
 		{
@@ -226,20 +228,22 @@ void CTcpPacket::ReadPacket()
 			CryLog(TITLE "Input TCP packet size : %d", getLength());
 		}
 
-		if (m_Packet.size() >= 3)
+		if (m_Reader.Init(m_Data, m_Separator) >= 3)
 		{
-			std::string packet_header = m_Packet.at(0);
-			std::string packet_type = m_Packet.at(1);
-			std::string packet_footer = m_Packet.at(m_Packet.size() - 1);
+			// 0 - header, 1 - type, 2 - start data
+			const char* packet_header = m_Reader.Next(m_Data);
+			const char* packet_type = m_Reader.Next(m_Data);
+			const char* packet_footer = m_Reader.Last(m_Data);
 
 			if (packet_header == m_Header && packet_footer == m_Footer)
 			{
-				m_Type = (EFireNetTcpPacketType)std::stoi(packet_type);
+				int type = 0;
+				CFireNetPacketReader::ToInt(packet_type, type);
+				m_Type = (EFireNetTcpPacketType)type;
 
 				if (m_Type != EFireNetTcpPacketType::Empty)
 				{
 					bIsGoodPacket = true;
-					m_LastIndex = 2; // 0 - header, 1 - type, 2 - start data
 				}
 				else
 				{
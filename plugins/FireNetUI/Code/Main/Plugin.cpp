@@ -224,12 +224,30 @@ void CFireNetUIPlugin::OnFireNetEvent(EFireNetEvents event, SFireNetEventArgs &
 		break;
 	case FIRENET_EVENT_GET_GAME_SERVER_FAILED:
 		break;
+	case FIRENET_EVENT_JOIN_CHAT_CHANNEL_COMPLETE:
+		break;
+	case FIRENET_EVENT_JOIN_CHAT_CHANNEL_FAILED:
+		break;
+	case FIRENET_EVENT_LEAVE_CHAT_CHANNEL_COMPLETE:
+		break;
+	case FIRENET_EVENT_LEAVE_CHAT_CHANNEL_FAILED:
+		break;
+	case FIRENET_EVENT_SET_STATUS_COMPLETE:
+		break;
+	case FIRENET_EVENT_SET_STATUS_FAILED:
+		break;
 	case FIRENET_EVENT_GLOBAL_CHAT_MSG_RECEIVED:
 		break;
 	case FIRENET_EVENT_PRIVATE_CHAT_MSG_RECEIVED:
 		break;
 	case FIRENET_EVENT_CLAN_CHAT_MSG_RECEIVED:
 		break;
+	case FIRENET_EVENT_PARTY_CHAT_MSG_RECEIVED:
+		break;
+	case FIRENET_EVENT_MATCH_CHAT_MSG_RECEIVED:
+		break;
+	case FIRENET_EVENT_FRIEND_STATUS_CHANGED:
+		break;
 	case FIRENET_EVENT_CONSOLE_COMMAND_RECEIVED:
 		break;
 	case FIRENET_EVENT_SERVER_MESSAGE_RECEIVED:
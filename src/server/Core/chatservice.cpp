@@ -0,0 +1,240 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include "global.h"
+#include "chatservice.h"
+#include "tcppacket.h"
+
+const char* ChatService::GLOBAL_CHANNEL = "global";
+
+ChatService::ChatService(int shardsCount) :
+	m_Rate(0.0),
+	m_Burst(1.0),
+	m_HistorySize(0),
+	bOpenGroups(false)
+{
+	if (shardsCount <= 0)
+		shardsCount = 1;
+
+	m_Shards.reserve(shardsCount);
+
+	for (int i = 0; i < shardsCount; ++i)
+		m_Shards.push_back(new SShard);
+}
+
+ChatService::~ChatService()
+{
+	qDeleteAll(m_Shards);
+	m_Shards.clear();
+}
+
+void ChatService::SetLimits(double rate, double burst, int historySize)
+{
+	m_Rate = rate;
+	m_Burst = qMax(burst, 1.0);
+	m_HistorySize = qMax(historySize, 0);
+}
+
+ChatService::SShard & ChatService::ShardByChannel(const QString & channel)
+{
+	return *m_Shards[qHash(channel) % m_Shards.size()];
+}
+
+qint64 ChatService::Publish(const QString & channel, const QString & sender, const QString & message, QByteArray & data)
+{
+	EChatChannelType type = GetChannelType(channel);
+
+	if (type == EChatChannelType::Unknown)
+	{
+		qWarning() << "Can't publish message to chat channel" << channel << ". Unknown channel";
+		return -1;
+	}
+
+	qint64 now = RateLimiter::Now();
+
+	// Encoded before lock, channel can be throttled but it's rare case
+	QByteArray encoded = EncodeMessage(type, channel, sender, message);
+
+	SShard &shard = ShardByChannel(channel);
+	QMutexLocker locker(&shard.lock);
+
+	SChannel &entry = shard.channels[channel];
+
+	if (m_Rate > 0.0)
+	{
+		qint64 wait = entry.bucket.Take(1.0, m_Rate, m_Burst, now);
+		if (wait > 0)
+			return wait;
+	}
+
+	entry.lastActivity = now;
+
+	if (m_HistorySize > 0)
+	{
+		if (entry.history.size() != m_HistorySize)
+		{
+			entry.history.resize(m_HistorySize);
+			entry.start = 0;
+			entry.count = 0;
+		}
+
+		if (entry.count < m_HistorySize)
+		{
+			entry.history[(entry.start + entry.count) % m_HistorySize] = encoded;
+			entry.count++;
+		}
+		else
+		{
+			entry.history[entry.start] = encoded;
+			entry.start = (entry.start + 1) % m_HistorySize;
+		}
+	}
+
+	data = encoded;
+	return 0;
+}
+
+bool ChatService::SetMember(const QString & channel, int uid, bool bMember)
+{
+	EChatChannelType type = GetChannelType(channel);
+
+	if (type == EChatChannelType::Unknown || type == EChatChannelType::Global || uid <= 0)
+		return false;
+
+	SShard &shard = ShardByChannel(channel);
+	QMutexLocker locker(&shard.lock);
+
+	if (bMember)
+	{
+		shard.members[channel].insert(uid);
+		return true;
+	}
+
+	auto it = shard.members.find(channel);
+	if (it != shard.members.end())
+	{
+		it->remove(uid);
+
+		if (it->isEmpty())
+			shard.members.erase(it);
+	}
+
+	return true;
+}
+
+bool ChatService::IsMember(const QString & channel, int uid)
+{
+	EChatChannelType type = GetChannelType(channel);
+
+	if (type == EChatChannelType::Unknown)
+		return false;
+	if (type == EChatChannelType::Global || bOpenGroups)
+		return true;
+
+	SShard &shard = ShardByChannel(channel);
+	QMutexLocker locker(&shard.lock);
+
+	auto it = shard.members.constFind(channel);
+	return it != shard.members.constEnd() && it->contains(uid);
+}
+
+QList<QByteArray> ChatService::GetHistory(const QString & channel)
+{
+	QList<QByteArray> history;
+
+	SShard &shard = ShardByChannel(channel);
+	QMutexLocker locker(&shard.lock);
+
+	auto it = shard.channels.constFind(channel);
+	if (it == shard.channels.constEnd() || it->history.isEmpty())
+		return history;
+
+	history.reserve(it->count);
+
+	for (int i = 0; i < it->count; ++i)
+		history.push_back(it->history.at((it->start + i) % it->history.size()));
+
+	return history;
+}
+
+void ChatService::RemoveIdle(qint64 idleTime)
+{
+	qint64 now = RateLimiter::Now();
+
+	for (auto it = m_Shards.begin(); it != m_Shards.end(); ++it)
+	{
+		QMutexLocker locker(&(*it)->lock);
+
+		for (auto channel = (*it)->channels.begin(); channel != (*it)->channels.end();)
+		{
+			if (now - channel->lastActivity > idleTime)
+				channel = (*it)->channels.erase(channel);
+			else
+				++channel;
+		}
+	}
+}
+
+void ChatService::Clear()
+{
+	for (auto it = m_Shards.begin(); it != m_Shards.end(); ++it)
+	{
+		QMutexLocker locker(&(*it)->lock);
+		(*it)->channels.clear();
+		(*it)->members.clear();
+	}
+}
+
+EChatChannelType ChatService::GetChannelType(const QString & channel)
+{
+	if (channel == GLOBAL_CHANNEL)
+		return EChatChannelType::Global;
+
+	// Separator of packet fields can't be in channel name
+	if (channel.size() > 64 || channel.contains('|'))
+		return EChatChannelType::Unknown;
+
+	int separator = channel.indexOf(':');
+	if (separator <= 0 || separator == channel.size() - 1)
+		return EChatChannelType::Unknown;
+
+	QStringRef prefix = channel.leftRef(separator);
+
+	if (prefix == "clan")
+		return EChatChannelType::Clan;
+	if (prefix == "party")
+		return EChatChannelType::Party;
+	if (prefix == "match")
+		return EChatChannelType::Match;
+
+	return EChatChannelType::Unknown;
+}
+
+QByteArray ChatService::EncodeMessage(EChatChannelType type, const QString & channel, const QString & sender, const QString & message)
+{
+	EFireNetTcpSMessage msgType = EFireNetTcpSMessage::GlobalChatMsg;
+
+	switch (type)
+	{
+	case EChatChannelType::Clan:
+		msgType = EFireNetTcpSMessage::ClanChatMsg;
+		break;
+	case EChatChannelType::Party:
+		msgType = EFireNetTcpSMessage::PartyChatMsg;
+		break;
+	case EChatChannelType::Match:
+		msgType = EFireNetTcpSMessage::MatchChatMsg;
+		break;
+	default:
+		break;
+	}
+
+	CTcpPacket packet(EFireNetTcpPacketType::ServerMessage);
+	packet.WriteServerMessage(msgType);
+	packet.WriteString(sender.toStdString());
+	packet.WriteString(message.toStdString());
+	packet.WriteString(channel.toStdString());
+
+	const char* packetData = packet.toString();
+	return QByteArray(packetData, static_cast<int>(packet.getLength()));
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef CHATSERVICE_H
+#define CHATSERVICE_H
+
+#include <QHash>
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QByteArray>
+
+#include "ratelimiter.h"
+
+// Channel name is type prefix + id, for e.g. "clan:Wolves", "party:1024", "match:7". Global channel have not id.
+// Clan, party and match channels can be joined only by members set by game servers or admins (SetMember),
+// with chat_open_group_channels = 1 anyone can join them and then only unguessable ids keep channel private
+enum class EChatChannelType : int
+{
+	Unknown,
+	Global,
+	Clan,
+	Party,
+	Match,
+};
+
+// Chat channels state : flood throttling and history for late joiners.
+// Subscribers are not here, every server thread keep own subscriber lists (see TcpThread),
+// so fan-out of message don't need any global lock.
+// Messages are stored already encoded, one buffer shared by history and all threads.
+class ChatService
+{
+public:
+	explicit ChatService(int shardsCount = 16);
+	~ChatService();
+public:
+	void                        SetLimits(double rate, double burst, int historySize);
+	void                        SetOpenGroups(bool bOpen) { bOpenGroups = bOpen; }
+
+	// Membership of clan, party or match channel, return false if channel unknown or global
+	bool                        SetMember(const QString &channel, int uid, bool bMember);
+	// Global channel is open for everyone
+	bool                        IsMember(const QString &channel, int uid);
+
+	// Return 0 and encoded message if channel accept it, -1 if channel unknown,
+	// otherwise time in ms until channel accept messages again
+	qint64                      Publish(const QString &channel, const QString &sender, const QString &message, QByteArray &data);
+	// Encoded messages of channel, oldest first
+	QList<QByteArray>           GetHistory(const QString &channel);
+	// Forget channels without messages longer than idleTime ms
+	void                        RemoveIdle(qint64 idleTime);
+
+	void                        Clear();
+public:
+	static const char*          GLOBAL_CHANNEL;
+
+	static EChatChannelType     GetChannelType(const QString &channel);
+	static QByteArray           EncodeMessage(EChatChannelType type, const QString &channel, const QString &sender, const QString &message);
+private:
+	// Fixed size ring, newest message overwrite oldest one
+	struct SChannel
+	{
+		SChannel() : start(0), count(0), lastActivity(0) {}
+
+		STokenBucket                   bucket;
+		QVector<QByteArray>            history;
+		int                            start;
+		int                            count;
+		qint64                         lastActivity;
+	};
+
+	struct SShard
+	{
+		QMutex                         lock;
+		QHash<QString, SChannel>       channels;
+		// Not removed with idle channels, game server remove members itself
+		QHash<QString, QSet<int>>      members;
+	};
+
+	SShard&                     ShardByChannel(const QString &channel);
+private:
+	QVector<SShard*>            m_Shards;
+	double                      m_Rate;
+	double                      m_Burst;
+	int                         m_HistorySize;
+	bool                        bOpenGroups;
+};
+
+#endif // CHATSERVICE_H
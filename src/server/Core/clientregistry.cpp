@@ -0,0 +1,354 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "global.h"
+#include "clientregistry.h"
+
+ClientRegistry::ClientRegistry(int shardsCount)
+{
+	if (shardsCount <= 0)
+		shardsCount = 1;
+
+	m_Shards.reserve(shardsCount);
+
+	for (int i = 0; i < shardsCount; ++i)
+		m_Shards.push_back(new SShard);
+}
+
+ClientRegistry::~ClientRegistry()
+{
+	qDeleteAll(m_Shards);
+	m_Shards.clear();
+}
+
+ClientRegistry::SShard & ClientRegistry::ShardBySocket(QSslSocket * socket)
+{
+	return *m_Shards[qHash(socket) % m_Shards.size()];
+}
+
+ClientRegistry::SShard & ClientRegistry::ShardByUid(int uid)
+{
+	return *m_Shards[qHash(uid) % m_Shards.size()];
+}
+
+ClientRegistry::SShard & ClientRegistry::ShardByNickname(const QString & nickname)
+{
+	return *m_Shards[qHash(nickname) % m_Shards.size()];
+}
+
+bool ClientRegistry::Add(const SClient & client)
+{
+	if (client.socket == nullptr)
+	{
+		qWarning() << "Can't add client. Client socket = nullptr";
+		return false;
+	}
+
+	SEntry entry;
+	entry.client = client;
+	entry.client.profile = client.profile ? SProfilePtr(new SProfile(*client.profile)) : SProfilePtr();
+	entry.uid = client.profile ? client.profile->uid : 0;
+	entry.nickname = client.profile ? client.profile->nickname : QString();
+
+	{
+		SShard &shard = ShardBySocket(client.socket);
+		QWriteLocker locker(&shard.lock);
+
+		if (shard.bySocket.contains(client.socket))
+		{
+			qWarning() << "Can't add client" << client.socket << ". Client alredy added";
+			return false;
+		}
+
+		shard.bySocket.insert(client.socket, entry);
+	}
+
+	IndexUid(entry.uid, client.socket);
+	IndexNickname(entry.nickname, client.socket);
+
+	m_Count.ref();
+
+	qDebug() << "Adding new client" << client.socket;
+
+	return true;
+}
+
+bool ClientRegistry::Remove(QSslSocket * socket)
+{
+	if (socket == nullptr)
+	{
+		qWarning() << "Can't remove client. Client socket = nullptr";
+		return false;
+	}
+
+	SEntry entry;
+
+	{
+		SShard &shard = ShardBySocket(socket);
+		QWriteLocker locker(&shard.lock);
+
+		auto it = shard.bySocket.find(socket);
+		if (it == shard.bySocket.end())
+		{
+			qWarning() << "Can't remove client. Client not found";
+			return false;
+		}
+
+		entry = it.value();
+		shard.bySocket.erase(it);
+	}
+
+	UnindexUid(entry.uid, socket);
+	UnindexNickname(entry.nickname, socket);
+
+	m_Count.deref();
+
+	qDebug() << "Removing client" << socket;
+
+	return true;
+}
+
+bool ClientRegistry::Update(const SClient & client)
+{
+	if (client.socket == nullptr)
+	{
+		qWarning() << "Can't update client. Client socket = nullptr";
+		return false;
+	}
+
+	if (!client.profile)
+	{
+		qWarning() << "Can't update client" << client.socket << ". Profile = nullptr";
+		return false;
+	}
+
+	int oldUid = 0;
+	QString oldNickname;
+
+	// Snapshot created before lock, readers can hold old one as long as they need
+	SProfilePtr snapshot(new SProfile(*client.profile));
+
+	const int newUid = snapshot->uid;
+	const QString newNickname = snapshot->nickname;
+
+	{
+		SShard &shard = ShardBySocket(client.socket);
+		QWriteLocker locker(&shard.lock);
+
+		auto it = shard.bySocket.find(client.socket);
+		if (it == shard.bySocket.end())
+		{
+			qWarning() << "Can't update client. Client" << client.socket << "not found";
+			return false;
+		}
+
+		oldUid = it->uid;
+		oldNickname = it->nickname;
+
+		it->client.profile = snapshot;
+		it->client.status = client.status;
+		it->uid = newUid;
+		it->nickname = newNickname;
+	}
+
+	if (oldUid != newUid)
+	{
+		UnindexUid(oldUid, client.socket);
+		IndexUid(newUid, client.socket);
+	}
+
+	if (oldNickname != newNickname)
+	{
+		UnindexNickname(oldNickname, client.socket);
+		IndexNickname(newNickname, client.socket);
+	}
+
+	qDebug() << "Client" << client.socket << "updated.";
+
+	return true;
+}
+
+bool ClientRegistry::SetRoute(QSslSocket * socket, const SConnectionRoute & route)
+{
+	if (socket == nullptr)
+		return false;
+
+	SShard &shard = ShardBySocket(socket);
+	QWriteLocker locker(&shard.lock);
+
+	auto it = shard.bySocket.find(socket);
+	if (it == shard.bySocket.end())
+		return false;
+
+	it->client.route = route;
+	return true;
+}
+
+bool ClientRegistry::GetClient(QSslSocket * socket, SClient & client)
+{
+	if (socket == nullptr)
+		return false;
+
+	SShard &shard = ShardBySocket(socket);
+	QReadLocker locker(&shard.lock);
+
+	auto it = shard.bySocket.constFind(socket);
+	if (it == shard.bySocket.constEnd())
+		return false;
+
+	client = it->client;
+	return true;
+}
+
+QSslSocket * ClientRegistry::GetSocketByUid(int uid)
+{
+	if (uid <= 0)
+		return nullptr;
+
+	SShard &shard = ShardByUid(uid);
+	QReadLocker locker(&shard.lock);
+
+	return shard.byUid.value(uid, nullptr);
+}
+
+QSslSocket * ClientRegistry::GetSocketByNickname(const QString & nickname)
+{
+	if (nickname.isEmpty())
+		return nullptr;
+
+	SShard &shard = ShardByNickname(nickname);
+	QReadLocker locker(&shard.lock);
+
+	return shard.byNickname.value(nickname, nullptr);
+}
+
+SProfilePtr ClientRegistry::GetProfileByUid(int uid)
+{
+	SClient client;
+
+	if (GetClient(GetSocketByUid(uid), client))
+		return client.profile;
+
+	return SProfilePtr();
+}
+
+SConnectionRoute ClientRegistry::GetRouteByUid(int uid)
+{
+	return GetRoute(GetSocketByUid(uid));
+}
+
+SConnectionRoute ClientRegistry::GetRouteByNickname(const QString & nickname)
+{
+	return GetRoute(GetSocketByNickname(nickname));
+}
+
+SConnectionRoute ClientRegistry::GetRoute(QSslSocket * socket)
+{
+	if (socket == nullptr)
+		return SConnectionRoute();
+
+	// Socket is only a key here, it can be deleted already
+	SShard &shard = ShardBySocket(socket);
+	QReadLocker locker(&shard.lock);
+
+	auto it = shard.bySocket.constFind(socket);
+	if (it == shard.bySocket.constEnd())
+		return SConnectionRoute();
+
+	return it->client.route;
+}
+
+QStringList ClientRegistry::GetPlayersList()
+{
+	QStringList playerList;
+
+	for (auto it = m_Shards.begin(); it != m_Shards.end(); ++it)
+	{
+		QReadLocker locker(&(*it)->lock);
+
+		for (auto client = (*it)->bySocket.constBegin(); client != (*it)->bySocket.constEnd(); ++client)
+		{
+			const SProfilePtr &profile = client->client.profile;
+
+			if (profile && !profile->nickname.isEmpty())
+			{
+				playerList.push_back("Uid: " + QString::number(profile->uid) +
+					" Nickname: " + profile->nickname +
+					" Level: " + QString::number(profile->lvl) +
+					" XP: " + QString::number(profile->xp));
+			}
+		}
+	}
+
+	return playerList;
+}
+
+void ClientRegistry::Clear()
+{
+	for (auto it = m_Shards.begin(); it != m_Shards.end(); ++it)
+	{
+		QWriteLocker locker(&(*it)->lock);
+
+		(*it)->bySocket.clear();
+		(*it)->byUid.clear();
+		(*it)->byNickname.clear();
+	}
+
+	m_Count.store(0);
+}
+
+void ClientRegistry::IndexUid(int uid, QSslSocket * socket)
+{
+	if (uid <= 0)
+		return;
+
+	SShard &shard = ShardByUid(uid);
+	QWriteLocker locker(&shard.lock);
+
+	auto it = shard.byUid.find(uid);
+	if (it != shard.byUid.end() && it.value() != socket)
+		qWarning() << "Uid" << uid << "alredy used by client" << it.value() << ". Index moved to" << socket;
+
+	shard.byUid.insert(uid, socket);
+}
+
+void ClientRegistry::UnindexUid(int uid, QSslSocket * socket)
+{
+	if (uid <= 0)
+		return;
+
+	SShard &shard = ShardByUid(uid);
+	QWriteLocker locker(&shard.lock);
+
+	// Index can already point to newer connection of same player
+	auto it = shard.byUid.find(uid);
+	if (it != shard.byUid.end() && it.value() == socket)
+		shard.byUid.erase(it);
+}
+
+void ClientRegistry::IndexNickname(const QString & nickname, QSslSocket * socket)
+{
+	if (nickname.isEmpty())
+		return;
+
+	SShard &shard = ShardByNickname(nickname);
+	QWriteLocker locker(&shard.lock);
+
+	shard.byNickname.insert(nickname, socket);
+}
+
+void ClientRegistry::UnindexNickname(const QString & nickname, QSslSocket * socket)
+{
+	if (nickname.isEmpty())
+		return;
+
+	SShard &shard = ShardByNickname(nickname);
+	QWriteLocker locker(&shard.lock);
+
+	auto it = shard.byNickname.find(nickname);
+	if (it != shard.byNickname.end() && it.value() == socket)
+		shard.byNickname.erase(it);
+}
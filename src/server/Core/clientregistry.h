@@ -0,0 +1,78 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef CLIENTREGISTRY_H
+#define CLIENTREGISTRY_H
+
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <QStringList>
+
+#include "global.h"
+
+// Online clients indexed by socket, uid and nickname.
+// Every index is split to shards with own lock, so connections from different threads
+// don't wait each other. Only one shard lock is held at time.
+// Registry keep own copy of profile made on Add/Update. Returned profiles are read-only snapshots,
+// only connection thread change client profile and publish it with Update.
+class ClientRegistry
+{
+public:
+	explicit ClientRegistry(int shardsCount = 16);
+	~ClientRegistry();
+public:
+	bool                        Add(const SClient &client);
+	bool                        Remove(QSslSocket* socket);
+	// Replace client status and profile handle, uid and nickname indexes follow the profile.
+	// Route is not changed here, it's set on Add and changed only by SetRoute
+	bool                        Update(const SClient &client);
+	// Connection moved to other thread
+	bool                        SetRoute(QSslSocket* socket, const SConnectionRoute &route);
+
+	bool                        GetClient(QSslSocket* socket, SClient &client);
+	QSslSocket*                 GetSocketByUid(int uid);
+	QSslSocket*                 GetSocketByNickname(const QString &nickname);
+	SProfilePtr                 GetProfileByUid(int uid);
+	// Invalid route if client offline
+	SConnectionRoute            GetRouteByUid(int uid);
+	SConnectionRoute            GetRouteByNickname(const QString &nickname);
+
+	QStringList                 GetPlayersList();
+	int                         Count() const { return m_Count.load(); }
+
+	void                        Clear();
+private:
+	// Uid and nickname are remembered on indexing, because profile can be changed in place
+	struct SEntry
+	{
+		SClient                        client;
+		int                            uid;
+		QString                        nickname;
+	};
+
+	struct SShard
+	{
+		QReadWriteLock                 lock;
+		QHash<QSslSocket*, SEntry>     bySocket;
+		QHash<int, QSslSocket*>        byUid;
+		QHash<QString, QSslSocket*>    byNickname;
+	};
+
+	SShard&                     ShardBySocket(QSslSocket* socket);
+	SShard&                     ShardByUid(int uid);
+	SShard&                     ShardByNickname(const QString &nickname);
+
+	SConnectionRoute            GetRoute(QSslSocket* socket);
+
+	void                        IndexUid(int uid, QSslSocket* socket);
+	void                        UnindexUid(int uid, QSslSocket* socket);
+	void                        IndexNickname(const QString &nickname, QSslSocket* socket);
+	void                        UnindexNickname(const QString &nickname, QSslSocket* socket);
+private:
+	QVector<SShard*>            m_Shards;
+	QAtomicInt                  m_Count;
+};
+
+#endif // CLIENTREGISTRY_H
@@ -0,0 +1,293 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include "global.h"
+#include "gameserverregistry.h"
+#include "ratelimiter.h"
+
+GameServerRegistry::GameServerRegistry() :
+	m_NextId(0),
+	m_ReservationTime(10000),
+	m_StaleTime(60000),
+	m_LastStaleCheck(0),
+	bFillServers(false)
+{
+}
+
+void GameServerRegistry::SetTimes(qint64 reservationTime, qint64 staleTime)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	m_ReservationTime = reservationTime;
+	m_StaleTime = staleTime;
+}
+
+void GameServerRegistry::SetFillServers(bool bFill)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	bFillServers = bFill;
+}
+
+bool GameServerRegistry::Register(const SGameServer &server)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	if (m_Servers.contains(server.name) || m_ByAddress.contains(GetAddress(server)))
+		return false;
+
+	SEntry &entry = m_Servers[server.name];
+	entry.server = server;
+	entry.id = ++m_NextId;
+	entry.lastUpdate = RateLimiter::Now();
+
+	m_ByAddress.insert(GetAddress(server), server.name);
+	Index(entry);
+
+	return true;
+}
+
+bool GameServerRegistry::Update(const SGameServer &server)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	auto it = m_Servers.find(server.name);
+	if (it == m_Servers.end() || it->server.ip != server.ip || it->server.port != server.port)
+		return false;
+
+	Unindex(*it);
+
+	// Connected players take their reservations, expired ones just leave queue after
+	const int arrived = qMin(qMax(server.online - it->server.online, 0), it->reserved);
+	it->reserved -= arrived;
+	it->consumed += arrived;
+
+	it->server = server;
+	it->lastUpdate = RateLimiter::Now();
+
+	if (it->bStale)
+	{
+		qInfo() << "Game server" << server.name << "updated and returned to matchmaking";
+		it->bStale = false;
+	}
+
+	Index(*it);
+
+	return true;
+}
+
+void GameServerRegistry::Unregister(const QString &name)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	auto it = m_Servers.find(name);
+	if (it == m_Servers.end())
+		return;
+
+	// Reservations of server are left in queue, they are skipped by id
+	Unindex(*it);
+	m_ByAddress.remove(GetAddress(it->server));
+	m_Servers.erase(it);
+}
+
+bool GameServerRegistry::Contains(const QString &name, const QString &ip, int port)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	return m_Servers.contains(name) || m_ByAddress.contains(ip + ":" + QString::number(port));
+}
+
+bool GameServerRegistry::Reserve(const QString &name, const QString &map, const QString &gamerules, SGameServer &server)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	SEntry* pEntry = nullptr;
+
+	if (!map.isEmpty() && !gamerules.isEmpty())
+		pEntry = Pick(m_ByMode, qMakePair(map, gamerules));
+	else if (!map.isEmpty())
+		pEntry = Pick(m_ByMap, map);
+	else if (!gamerules.isEmpty())
+		pEntry = Pick(m_ByGameRules, gamerules);
+	else if (!name.isEmpty())
+	{
+		// Only indexed server have free slot and not stale
+		auto it = m_Servers.find(name);
+		if (it != m_Servers.end() && it->load >= 0)
+			pEntry = &(*it);
+	}
+
+	if (!pEntry)
+		return false;
+
+	if (m_ReservationTime > 0)
+	{
+		Unindex(*pEntry);
+		pEntry->reserved++;
+		Index(*pEntry);
+
+		SReservation reservation;
+		reservation.expire = RateLimiter::Now() + m_ReservationTime;
+		reservation.name = pEntry->server.name;
+		reservation.id = pEntry->id;
+		m_Reservations.enqueue(reservation);
+	}
+
+	server = pEntry->server;
+
+	return true;
+}
+
+void GameServerRegistry::RemoveExpired()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	const qint64 now = RateLimiter::Now();
+
+	while (!m_Reservations.isEmpty() && m_Reservations.head().expire <= now)
+	{
+		SReservation reservation = m_Reservations.dequeue();
+
+		auto it = m_Servers.find(reservation.name);
+		if (it == m_Servers.end() || it->id != reservation.id)
+			continue;
+
+		if (it->consumed > 0)
+		{
+			it->consumed--;
+		}
+		else if (it->reserved > 0)
+		{
+			Unindex(*it);
+			it->reserved--;
+			Index(*it);
+		}
+	}
+
+	// Full check not needed often, servers are updated much slower
+	if (m_StaleTime <= 0 || now - m_LastStaleCheck < 1000)
+		return;
+
+	m_LastStaleCheck = now;
+
+	for (auto it = m_Servers.begin(); it != m_Servers.end(); ++it)
+	{
+		if (!it->bStale && now - it->lastUpdate > m_StaleTime)
+		{
+			qWarning() << "Game server" << it->server.name << "not updated" << (now - it->lastUpdate) / 1000 << "seconds and removed from matchmaking";
+
+			Unindex(*it);
+			it->bStale = true;
+		}
+	}
+}
+
+int GameServerRegistry::GetCount()
+{
+	QMutexLocker locker(&m_Mutex);
+	return m_Servers.size();
+}
+
+QStringList GameServerRegistry::GetServerList()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	QStringList serverList;
+
+	for (auto it = m_Servers.constBegin(); it != m_Servers.constEnd(); ++it)
+	{
+		const SGameServer &server = it->server;
+
+		serverList.push_back(server.name + " <" + server.ip + ":" + QString::number(server.port) + ">"
+			" Map <" + server.map + ":" + server.gamerules + ">"
+			" Online <" + QString::number(server.online) + "/" + QString::number(server.maxPlayers) + ">"
+			" Reserved <" + QString::number(it->reserved) + ">" + (it->bStale ? " Not responding" : ""));
+	}
+
+	return serverList;
+}
+
+void GameServerRegistry::Clear()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	m_Servers.clear();
+	m_ByAddress.clear();
+	m_ByMode.clear();
+	m_ByMap.clear();
+	m_ByGameRules.clear();
+	m_Reservations.clear();
+}
+
+void GameServerRegistry::Index(SEntry &entry)
+{
+	entry.load = CalculateLoad(entry);
+	if (entry.load < 0)
+		return;
+
+	const SGameServer &server = entry.server;
+	const TLoadKey key(entry.load, server.name);
+
+	m_ByMode[qMakePair(server.map, server.gamerules)].insert(key);
+	m_ByMap[server.map].insert(key);
+	m_ByGameRules[server.gamerules].insert(key);
+}
+
+void GameServerRegistry::Unindex(SEntry &entry)
+{
+	if (entry.load < 0)
+		return;
+
+	const SGameServer &server = entry.server;
+	const TLoadKey key(entry.load, server.name);
+
+	RemoveFromIndex(m_ByMode, qMakePair(server.map, server.gamerules), key);
+	RemoveFromIndex(m_ByMap, server.map, key);
+	RemoveFromIndex(m_ByGameRules, server.gamerules, key);
+
+	entry.load = -1;
+}
+
+template<typename TKey>
+GameServerRegistry::SEntry* GameServerRegistry::Pick(const QHash<TKey, TLoadIndex> &indexes, const TKey &key)
+{
+	auto it = indexes.constFind(key);
+	if (it == indexes.constEnd() || it->empty())
+		return nullptr;
+
+	// Players spread by all servers, in fill mode they fill servers one by one
+	const QString &name = bFillServers ? it->rbegin()->second : it->begin()->second;
+
+	auto entry = m_Servers.find(name);
+	return entry != m_Servers.end() ? &(*entry) : nullptr;
+}
+
+template<typename TKey>
+void GameServerRegistry::RemoveFromIndex(QHash<TKey, TLoadIndex> &indexes, const TKey &key, const TLoadKey &value)
+{
+	auto it = indexes.find(key);
+	if (it == indexes.end())
+		return;
+
+	it->erase(value);
+
+	if (it->empty())
+		indexes.erase(it);
+}
+
+int GameServerRegistry::CalculateLoad(const SEntry &entry)
+{
+	const SGameServer &server = entry.server;
+	const int players = server.online + entry.reserved;
+
+	// Full servers are not indexed
+	if (entry.bStale || server.maxPlayers <= 0 || players >= server.maxPlayers)
+		return -1;
+
+	return players * 1000 / server.maxPlayers;
+}
+
+QString GameServerRegistry::GetAddress(const SGameServer &server)
+{
+	return server.ip + ":" + QString::number(server.port);
+}
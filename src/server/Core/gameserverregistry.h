@@ -0,0 +1,105 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef GAMESERVERREGISTRY_H
+#define GAMESERVERREGISTRY_H
+
+#include <QHash>
+#include <QQueue>
+#include <QPair>
+#include <QMutex>
+#include <QStringList>
+
+#include <set>
+
+#include "global.h"
+
+// Registered game servers for matchmaking. Servers with free slots are kept sorted by load
+// in indexes by (map, gamerules), map and gamerules, so search don't depend on servers count.
+// Every found server get reservation for one player until he connect or reservation expired,
+// so players searching at same time are not sent to one nearly full server.
+// Server without updates longer than stale time is not used for matchmaking until next update.
+class GameServerRegistry
+{
+public:
+	GameServerRegistry();
+public:
+	// Times in ms, stale time 0 - servers never become stale
+	void                        SetTimes(qint64 reservationTime, qint64 staleTime);
+	// Most loaded server first instead of least loaded, players fill servers one by one
+	void                        SetFillServers(bool bFill);
+
+	// Return false if server with same name or address already registered
+	bool                        Register(const SGameServer &server);
+	// Name and address can't be changed, return false if server not registered
+	bool                        Update(const SGameServer &server);
+	void                        Unregister(const QString &name);
+	bool                        Contains(const QString &name, const QString &ip, int port);
+
+	// Search by map and gamerules, by one of them or by name if both empty.
+	// Least loaded server with free slot (most loaded in fill mode) is returned and one slot reserved on it
+	bool                        Reserve(const QString &name, const QString &map, const QString &gamerules, SGameServer &server);
+	// Release expired reservations and remove stale servers from matchmaking
+	void                        RemoveExpired();
+
+	int                         GetCount();
+	QStringList                 GetServerList();
+
+	void                        Clear();
+private:
+	struct SEntry
+	{
+		SEntry() : id(0), reserved(0), consumed(0), lastUpdate(0), load(-1), bStale(false) {}
+
+		SGameServer                    server;
+		quint32                        id;
+		// Reservations waiting player and reservations already taken by connected players
+		int                            reserved;
+		int                            consumed;
+		qint64                         lastUpdate;
+		// Load in indexes, -1 if server not indexed
+		int                            load;
+		bool                           bStale;
+	};
+
+	struct SReservation
+	{
+		qint64                         expire;
+		QString                        name;
+		quint32                        id;
+	};
+
+	// Load in permille and server name, least loaded server is first
+	typedef QPair<int, QString>    TLoadKey;
+	typedef std::set<TLoadKey>     TLoadIndex;
+
+	void                        Index(SEntry &entry);
+	void                        Unindex(SEntry &entry);
+
+	template<typename TKey>
+	SEntry*                     Pick(const QHash<TKey, TLoadIndex> &indexes, const TKey &key);
+	template<typename TKey>
+	static void                 RemoveFromIndex(QHash<TKey, TLoadIndex> &indexes, const TKey &key, const TLoadKey &value);
+
+	static int                  CalculateLoad(const SEntry &entry);
+	static QString              GetAddress(const SGameServer &server);
+private:
+	QMutex                      m_Mutex;
+	QHash<QString, SEntry>      m_Servers;
+	QHash<QString, QString>     m_ByAddress;
+
+	QHash<QPair<QString, QString>, TLoadIndex> m_ByMode;
+	QHash<QString, TLoadIndex>  m_ByMap;
+	QHash<QString, TLoadIndex>  m_ByGameRules;
+
+	// Reservation time is same for all, so queue is sorted by expire time
+	QQueue<SReservation>        m_Reservations;
+
+	quint32                     m_NextId;
+	qint64                      m_ReservationTime;
+	qint64                      m_StaleTime;
+	qint64                      m_LastStaleCheck;
+	bool                        bFillServers;
+};
+
+#endif // GAMESERVERREGISTRY_H
@@ -0,0 +1,34 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include "global.h"
+#include "mailbox.h"
+
+ConnectionMailbox::ConnectionMailbox(const TDeliver &deliver, QObject *parent) : QObject(parent),
+	m_Scheduled(0),
+	m_Deliver(deliver)
+{
+}
+
+void ConnectionMailbox::Post(const SMailboxMessage & message)
+{
+	m_Queue.Push(message);
+
+	// Event loop already going to drain mailbox
+	if (!m_Scheduled.testAndSetOrdered(0, 1))
+		return;
+
+	// Works from threads without event loop too (database tasks)
+	QMetaObject::invokeMethod(this, "Drain", Qt::QueuedConnection);
+}
+
+void ConnectionMailbox::Drain()
+{
+	// Cleared before reading, message pushed while draining schedule new drain
+	m_Scheduled.storeRelease(0);
+
+	SMailboxMessage message;
+
+	while (m_Queue.Pop(message))
+		m_Deliver(message);
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QByteArray>
+
+#include <functional>
+
+#include "global.h"
+
+// Multi-producer single-consumer queue without locks (D. Vyukov intrusive queue with stub node).
+// Push can be called from any thread, Pop only from one consumer thread.
+// Pop can return false while producer is in the middle of Push, item will be available on next Pop.
+template<typename T>
+class MpscQueue
+{
+public:
+	MpscQueue() : m_Head(&m_Stub), m_Tail(&m_Stub) {}
+	~MpscQueue()
+	{
+		T value;
+		while (Pop(value)) {}
+	}
+public:
+	void                        Push(const T &value)
+	{
+		SNode* node = new SNode;
+		node->value = value;
+		Link(node);
+	}
+
+	bool                        Pop(T &value)
+	{
+		SNode* tail = m_Tail;
+		SNode* next = tail->next.loadAcquire();
+
+		if (tail == &m_Stub)
+		{
+			if (!next)
+				return false;
+
+			m_Tail = next;
+			tail = next;
+			next = next->next.loadAcquire();
+		}
+
+		if (!next)
+		{
+			// Producer swapped head but not linked node yet
+			if (tail != m_Head.loadAcquire())
+				return false;
+
+			Link(&m_Stub);
+			next = tail->next.loadAcquire();
+
+			if (!next)
+				return false;
+		}
+
+		m_Tail = next;
+		value = tail->value;
+		delete tail;
+
+		return true;
+	}
+private:
+	struct SNode
+	{
+		SNode() : next(nullptr) {}
+
+		QAtomicPointer<SNode>          next;
+		T                              value;
+	};
+
+	void                        Link(SNode* node)
+	{
+		node->next.store(nullptr);
+		SNode* prev = m_Head.fetchAndStoreOrdered(node);
+		prev->next.storeRelease(node);
+	}
+private:
+	SNode                       m_Stub;
+	QAtomicPointer<SNode>       m_Head;
+	// Only consumer use it
+	SNode*                      m_Tail;
+};
+
+// Packet or profile change for one connection
+struct SMailboxMessage
+{
+	SMailboxMessage() : type(0), uid(0) {}
+
+	SConnectionRoute            route;
+	QByteArray                  data;
+	int                         type;
+	// Set for profile changes instead of data
+	int                         uid;
+	std::function<void(SProfile&)> modifier;
+};
+
+// Mailbox of server thread. Lives on thread of his event loop, any thread post messages to it
+// without locks and only first message after drain wake up the event loop.
+class ConnectionMailbox : public QObject
+{
+	Q_OBJECT
+public:
+	typedef std::function<void(const SMailboxMessage&)> TDeliver;
+
+	explicit ConnectionMailbox(const TDeliver &deliver, QObject *parent = nullptr);
+public:
+	// Thread-safe
+	void                        Post(const SMailboxMessage &message);
+public slots:
+	void                        Drain();
+private:
+	MpscQueue<SMailboxMessage>  m_Queue;
+	QAtomicInt                  m_Scheduled;
+	TDeliver                    m_Deliver;
+};
+
+#endif // MAILBOX_H
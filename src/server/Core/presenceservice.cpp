@@ -0,0 +1,192 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include "global.h"
+#include "presenceservice.h"
+
+PresenceService::PresenceService()
+{
+}
+
+void PresenceService::SetOnline(int uid, const QSet<int>& friends)
+{
+	if (uid <= 0)
+		return;
+
+	QMutexLocker locker(&m_Mutex);
+
+	SPresence &presence = m_Players[uid];
+	presence.friends = friends;
+	presence.sessions++;
+
+	// New connection of player need statuses of friends anyway
+	MarkSnapshot(uid);
+
+	if (presence.sessions == 1)
+	{
+		presence.status = EStatus_Online;
+		m_Departed.remove(uid);
+		MarkChanged(uid);
+	}
+}
+
+void PresenceService::SetOffline(int uid)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	auto it = m_Players.find(uid);
+	if (it == m_Players.end())
+		return;
+
+	if (--it->sessions > 0)
+		return;
+
+	// Friends still need to know that player gone
+	m_Departed.insert(uid, it->friends);
+	m_Players.erase(it);
+
+	m_Snapshots.remove(uid);
+	MarkChanged(uid);
+}
+
+bool PresenceService::SetStatus(int uid, int status)
+{
+	// Player can't be offline while connected
+	if (status < EStatus_Online || status >= EStatus_Offline)
+		return false;
+
+	QMutexLocker locker(&m_Mutex);
+
+	auto it = m_Players.find(uid);
+	if (it == m_Players.end())
+		return false;
+
+	if (it->status != status)
+	{
+		it->status = status;
+		MarkChanged(uid);
+	}
+
+	return true;
+}
+
+int PresenceService::GetStatus(int uid)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	auto it = m_Players.constFind(uid);
+	return it != m_Players.constEnd() ? it->status : EStatus_Offline;
+}
+
+void PresenceService::AddFriends(int uid, int friendUid)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	auto first = m_Players.find(uid);
+	auto second = m_Players.find(friendUid);
+
+	if (first != m_Players.end())
+		first->friends.insert(friendUid);
+	if (second != m_Players.end())
+		second->friends.insert(uid);
+
+	// Both online - both get status of new friend with next update
+	if (first != m_Players.end() && second != m_Players.end())
+	{
+		MarkSnapshot(uid);
+		MarkSnapshot(friendUid);
+	}
+}
+
+void PresenceService::RemoveFriends(int uid, int friendUid)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	auto first = m_Players.find(uid);
+	if (first != m_Players.end())
+		first->friends.remove(friendUid);
+
+	auto second = m_Players.find(friendUid);
+	if (second != m_Players.end())
+		second->friends.remove(uid);
+}
+
+QHash<int, QVector<TPresenceStatus>> PresenceService::TakeUpdates()
+{
+	QHash<int, QHash<int, int>> statuses;
+
+	{
+		QMutexLocker locker(&m_Mutex);
+
+		if (m_Changed.isEmpty() && m_Snapshots.isEmpty())
+			return QHash<int, QVector<TPresenceStatus>>();
+
+		// Changed player - to all his online friends
+		for (auto uid = m_Changed.constBegin(); uid != m_Changed.constEnd(); ++uid)
+		{
+			auto player = m_Players.constFind(*uid);
+			const bool bOnline = player != m_Players.constEnd();
+			const int status = bOnline ? player->status : EStatus_Offline;
+			const QSet<int> friends = bOnline ? player->friends : m_Departed.value(*uid);
+
+			for (auto friendUid = friends.constBegin(); friendUid != friends.constEnd(); ++friendUid)
+			{
+				if (m_Players.contains(*friendUid))
+					statuses[*friendUid].insert(*uid, status);
+			}
+		}
+
+		// Online friends - to player, offline is default status on client
+		for (auto uid = m_Snapshots.constBegin(); uid != m_Snapshots.constEnd(); ++uid)
+		{
+			auto player = m_Players.constFind(*uid);
+			if (player == m_Players.constEnd())
+				continue;
+
+			for (auto friendUid = player->friends.constBegin(); friendUid != player->friends.constEnd(); ++friendUid)
+			{
+				auto friendPlayer = m_Players.constFind(*friendUid);
+				if (friendPlayer != m_Players.constEnd())
+					statuses[*uid].insert(*friendUid, friendPlayer->status);
+			}
+		}
+
+		m_Changed.clear();
+		m_Snapshots.clear();
+		m_Departed.clear();
+	}
+
+	QHash<int, QVector<TPresenceStatus>> updates;
+	updates.reserve(statuses.size());
+
+	for (auto it = statuses.constBegin(); it != statuses.constEnd(); ++it)
+	{
+		QVector<TPresenceStatus> &list = updates[it.key()];
+		list.reserve(it->size());
+
+		for (auto status = it->constBegin(); status != it->constEnd(); ++status)
+			list.push_back(qMakePair(status.key(), status.value()));
+	}
+
+	return updates;
+}
+
+void PresenceService::Clear()
+{
+	QMutexLocker locker(&m_Mutex);
+
+	m_Players.clear();
+	m_Changed.clear();
+	m_Snapshots.clear();
+	m_Departed.clear();
+}
+
+void PresenceService::MarkChanged(int uid)
+{
+	m_Changed.insert(uid);
+}
+
+void PresenceService::MarkSnapshot(int uid)
+{
+	m_Snapshots.insert(uid);
+}
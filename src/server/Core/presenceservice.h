@@ -0,0 +1,66 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef PRESENCESERVICE_H
+#define PRESENCESERVICE_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QPair>
+#include <QMutex>
+
+#include <string>
+#include <vector>
+
+#include <FireNetCore/IFireNetBase.h>
+
+// Status of friend for presence update : first - uid, second - EFireNetPlayerStatus
+typedef QPair<int, int> TPresenceStatus;
+
+// Status of online players and who must know about it.
+// Changes are not sent at once, they collected until TakeUpdates and only last status of player
+// is sent, so when many friends come online together every client get one update with all of them.
+class PresenceService
+{
+public:
+	PresenceService();
+public:
+	// Player can be online from few connections at same time, he is offline after last one closed
+	void                        SetOnline(int uid, const QSet<int> &friends);
+	void                        SetOffline(int uid);
+	// Return false if player offline or status wrong
+	bool                        SetStatus(int uid, int status);
+	int                         GetStatus(int uid);
+
+	// Friends are symmetric, both players get status of other one
+	void                        AddFriends(int uid, int friendUid);
+	void                        RemoveFriends(int uid, int friendUid);
+
+	// Statuses to send to every online player since last call
+	QHash<int, QVector<TPresenceStatus>> TakeUpdates();
+
+	void                        Clear();
+private:
+	struct SPresence
+	{
+		SPresence() : status(EStatus_Offline), sessions(0) {}
+
+		int                            status;
+		int                            sessions;
+		QSet<int>                      friends;
+	};
+
+	void                        MarkChanged(int uid);
+	void                        MarkSnapshot(int uid);
+private:
+	QMutex                      m_Mutex;
+	QHash<int, SPresence>       m_Players;
+	// Players with changed status and players who need statuses of all friends
+	QSet<int>                   m_Changed;
+	QSet<int>                   m_Snapshots;
+	// Offline players are removed from m_Players, their friends still need update
+	QHash<int, QSet<int>>       m_Departed;
+};
+
+#endif // PRESENCESERVICE_H
@@ -0,0 +1,196 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include <cmath>
+
+#include "global.h"
+#include "ratelimiter.h"
+
+void STokenBucket::Refill(double rate, double burst, qint64 now)
+{
+	// New bucket start full, so normal login burst pass at once
+	if (lastUpdate < 0)
+	{
+		tokens = burst;
+		lastUpdate = now;
+		return;
+	}
+
+	if (now > lastUpdate)
+	{
+		tokens = qMin(burst, tokens + (now - lastUpdate) * rate / 1000.0);
+		lastUpdate = now;
+	}
+}
+
+qint64 STokenBucket::Take(double cost, double rate, double burst, qint64 now)
+{
+	if (rate <= 0.0)
+		return 0;
+
+	Refill(rate, burst, now);
+
+	// Packet more expensive than whole bucket must pass sometime
+	cost = qMin(cost, burst);
+
+	if (tokens >= cost)
+	{
+		tokens -= cost;
+		return 0;
+	}
+
+	return qMax<qint64>(1, static_cast<qint64>(std::ceil((cost - tokens) * 1000.0 / rate)));
+}
+
+void STokenBucket::Refund(double cost, double burst)
+{
+	tokens = qMin(burst, tokens + cost);
+}
+
+bool STokenBucket::IsFull(double rate, double burst, qint64 now)
+{
+	Refill(rate, burst, now);
+	return tokens >= burst;
+}
+
+RateLimiter::RateLimiter(int shardsCount) :
+	m_Rate(0.0),
+	m_Burst(0.0)
+{
+	if (shardsCount <= 0)
+		shardsCount = 1;
+
+	m_Shards.reserve(shardsCount);
+
+	for (int i = 0; i < shardsCount; ++i)
+		m_Shards.push_back(new SShard);
+}
+
+RateLimiter::~RateLimiter()
+{
+	qDeleteAll(m_Shards);
+	m_Shards.clear();
+}
+
+void RateLimiter::SetLimits(double rate, double burst)
+{
+	m_Rate = rate;
+	m_Burst = qMax(burst, 1.0);
+}
+
+RateLimiter::SShard & RateLimiter::ShardByAddress(const QHostAddress & address)
+{
+	return *m_Shards[qHash(address) % m_Shards.size()];
+}
+
+qint64 RateLimiter::Take(const QHostAddress & address, double cost)
+{
+	if (!IsEnabled())
+		return 0;
+
+	SShard &shard = ShardByAddress(address);
+	QMutexLocker locker(&shard.lock);
+
+	return shard.buckets[address].Take(cost, m_Rate, m_Burst, Now());
+}
+
+void RateLimiter::Refund(const QHostAddress & address, double cost)
+{
+	if (!IsEnabled())
+		return;
+
+	SShard &shard = ShardByAddress(address);
+	QMutexLocker locker(&shard.lock);
+
+	auto it = shard.buckets.find(address);
+	if (it != shard.buckets.end())
+		it->Refund(cost, m_Burst);
+}
+
+void RateLimiter::RemoveFull()
+{
+	qint64 now = Now();
+
+	for (auto it = m_Shards.begin(); it != m_Shards.end(); ++it)
+	{
+		QMutexLocker locker(&(*it)->lock);
+
+		for (auto bucket = (*it)->buckets.begin(); bucket != (*it)->buckets.end();)
+		{
+			if (bucket->IsFull(m_Rate, m_Burst, now))
+				bucket = (*it)->buckets.erase(bucket);
+			else
+				++bucket;
+		}
+	}
+}
+
+qint64 RateLimiter::Now()
+{
+	static const QElapsedTimer timer = []()
+	{
+		QElapsedTimer started;
+		started.start();
+		return started;
+	}();
+
+	return timer.elapsed();
+}
+
+double RateLimiter::GetPacketCost(const std::string & data)
+{
+	// Packet : !0x0|type|query|...
+	std::size_t typeStart = data.find('|');
+	if (typeStart == std::string::npos)
+		return 1.0;
+
+	std::size_t queryStart = data.find('|', typeStart + 1);
+	if (queryStart == std::string::npos)
+		return 1.0;
+
+	int type = 0;
+	for (std::size_t i = typeStart + 1; i < queryStart && i < typeStart + 4; ++i)
+	{
+		if (data[i] < '0' || data[i] > '9')
+			return 1.0;
+		type = type * 10 + (data[i] - '0');
+	}
+
+	if (type != static_cast<int>(EFireNetTcpPacketType::Query))
+		return 1.0;
+
+	int query = 0;
+	for (std::size_t i = queryStart + 1; i < data.size() && data[i] != '|' && i < queryStart + 4; ++i)
+	{
+		if (data[i] < '0' || data[i] > '9')
+			return 1.0;
+		query = query * 10 + (data[i] - '0');
+	}
+
+	return GetQueryCost(static_cast<EFireNetTcpQuery>(query));
+}
+
+double RateLimiter::GetQueryCost(EFireNetTcpQuery query)
+{
+	// Queries going to database cost more
+	switch (query)
+	{
+	case EFireNetTcpQuery::Register :
+		return 5.0;
+	case EFireNetTcpQuery::Login :
+	case EFireNetTcpQuery::CreateProfile :
+		return 3.0;
+	case EFireNetTcpQuery::GetShop :
+	case EFireNetTcpQuery::BuyItem :
+	case EFireNetTcpQuery::RemoveItem :
+	case EFireNetTcpQuery::SendInvite :
+	case EFireNetTcpQuery::AcceptInvite :
+	case EFireNetTcpQuery::RemoveFriend :
+		return 2.0;
+	default:
+		return 1.0;
+	}
+}
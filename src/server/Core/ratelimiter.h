@@ -0,0 +1,76 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QHostAddress>
+
+#include <string>
+
+#include <FireNetCore/IFireNetTcpPacket.h>
+
+enum class ERateLimitMode : int
+{
+	Disabled,
+	// Delay packets of client until he have enough tokens
+	Soft,
+	// Disconnect client
+	Hard,
+};
+
+// Token bucket : tokens refill with constant rate up to burst size, every packet take his cost.
+// Not thread-safe, connection bucket used only by connection thread.
+struct STokenBucket
+{
+	STokenBucket() : tokens(0.0), lastUpdate(-1) {}
+
+	// Return 0 if tokens taken, otherwise time in ms until bucket have enough tokens
+	qint64                      Take(double cost, double rate, double burst, qint64 now);
+	void                        Refund(double cost, double burst);
+	bool                        IsFull(double rate, double burst, qint64 now);
+
+	double                      tokens;
+	qint64                      lastUpdate;
+private:
+	void                        Refill(double rate, double burst, qint64 now);
+};
+
+// Buckets shared by all connections from one IP address
+class RateLimiter
+{
+public:
+	explicit RateLimiter(int shardsCount = 16);
+	~RateLimiter();
+public:
+	void                        SetLimits(double rate, double burst);
+
+	qint64                      Take(const QHostAddress &address, double cost);
+	void                        Refund(const QHostAddress &address, double cost);
+	// Full buckets don't limit anything, so they can be removed
+	void                        RemoveFull();
+	bool                        IsEnabled() const { return m_Rate > 0.0; }
+public:
+	// Monotonic time in ms
+	static qint64               Now();
+	// Cost of packet by query type. Query type read from raw frame, without building packet
+	static double               GetPacketCost(const std::string &data);
+	static double               GetQueryCost(EFireNetTcpQuery query);
+private:
+	struct SShard
+	{
+		QMutex                          lock;
+		QHash<QHostAddress, STokenBucket> buckets;
+	};
+
+	SShard&                     ShardByAddress(const QHostAddress &address);
+private:
+	QVector<SShard*>            m_Shards;
+	double                      m_Rate;
+	double                      m_Burst;
+};
+
+#endif // RATELIMITER_H
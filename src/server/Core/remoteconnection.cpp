@@ -5,6 +5,7 @@
 #include "remoteconnection.h"
 #include "remoteserver.h"
 #include "tcppacket.h"
+#include "sslcontext.h"
 
 #include "Workers/Packets/remoteclientquerys.h"
 #include "Tools/settings.h"
@@ -13,18 +14,21 @@ RemoteConnection::RemoteConnection(QObject *parent) : QObject(parent),
 	m_socket(nullptr),
 	m_Client(),
 	pQuerys(nullptr),
+	m_WriteBufferPackets(0),
+	m_HandshakeTimer(nullptr),
 	bConnected(false),
-	bLastMsgSended(true)
+	bFlushScheduled(false),
+	bBinaryFraming(false)
 {
 
 	m_maxPacketSize = gEnv->pSettings->GetVariable("net_max_packet_read_size").toInt();
+	m_Decoder = CFireNetTcpFrameDecoder(m_maxPacketSize);
 	m_maxBadPacketsCount = gEnv->pSettings->GetVariable("net_max_bad_packets_count").toInt();
 	m_BadPacketsCount = 0;
 
-	m_Time = QTime::currentTime();
-	m_InputPacketsCount = 0;
-	m_PacketsSpeed = 0;
-	m_maxPacketSpeed = gEnv->pSettings->GetVariable("net_max_packets_speed").toInt();
+	m_RateLimitMode = static_cast<ERateLimitMode>(gEnv->pSettings->GetVariable("net_rate_limit_mode").toInt());
+	m_Rate = gEnv->pSettings->GetVariable("net_rate_limit_rate").toDouble();
+	m_RateBurst = gEnv->pSettings->GetVariable("net_rate_limit_burst").toDouble();
 }
 
 RemoteConnection::~RemoteConnection()
@@ -34,26 +38,51 @@ RemoteConnection::~RemoteConnection()
 	SAFE_RELEASE(pQuerys);
 }
 
-void RemoteConnection::Update()
+void RemoteConnection::SendMessage(CTcpPacket & packet)
 {
-	if (!m_Packets.empty() && m_socket && bConnected && bLastMsgSended)
+	const char* data = packet.toString();
+	const int size = static_cast<int>(packet.getLength());
+
+	// Client can't read bigger packet in any framing, length in binary header would wrap
+	if (size > static_cast<int>(EFireNetTcpFrameHeader::MAX_PAYLOAD))
+	{
+		qCritical() << "Can't send packet to remote client" << m_socket << ". Packet size" << size << "bigger than frame limit";
+		return;
+	}
+
+	if (bBinaryFraming)
 	{
-		bLastMsgSended = false;
-		CTcpPacket packet = m_Packets.front();
-		m_Packets.pop();
-		m_socket->write(packet.toString());
+		char header[static_cast<int>(EFireNetTcpFrameHeader::SIZE)];
+		FireNetWriteTcpFrameHeader(header, packet.getType(), packet.getLength());
+		m_WriteBuffer.append(header, sizeof(header));
 	}
 
-	if (m_Time.elapsed() >= 1000)
+	m_WriteBuffer.append(data, size);
+	m_WriteBufferPackets++;
+
+	// All packets sended during one event loop iteration go to socket with one write
+	if (!bFlushScheduled)
 	{
-		m_Time = QTime::currentTime();
-		CalculateStatistic();
+		bFlushScheduled = true;
+		QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
 	}
 }
 
-void RemoteConnection::SendMessage(CTcpPacket & packet)
+void RemoteConnection::Flush()
 {
-	m_Packets.push(packet);
+	bFlushScheduled = false;
+
+	if (!m_socket || !bConnected || m_WriteBuffer.isEmpty())
+		return;
+
+	m_socket->write(m_WriteBuffer);
+
+	STrafficCounters* pCounters = gEnv->pRemoteServer->GetCounters();
+	pCounters->outputPackets.fetchAndAddRelaxed(m_WriteBufferPackets);
+	pCounters->outputBytes.fetchAndAddRelaxed(m_WriteBuffer.size());
+
+	m_WriteBuffer.clear();
+	m_WriteBufferPackets = 0;
 }
 
 void RemoteConnection::accept(qint64 socketDescriptor)
@@ -68,21 +97,30 @@ void RemoteConnection::accept(qint64 socketDescriptor)
 	if (!m_socket->setSocketDescriptor(socketDescriptor))
 	{
 		qCritical() << "Can't accept socket!";
+		emit finished();
 		return;
 	}
 
-	m_socket->setLocalCertificate("key.pem");
-	m_socket->setPrivateKey("key.key");
-	m_socket->startServerEncryption();
-	
+	// Don't block remote server thread, connected() called by encrypted() signal
 	int timeout = gEnv->pSettings->GetVariable("net_encryption_timeout").toInt();
 
-	if (!m_socket->waitForEncrypted(timeout * 1000))
-	{
-		qCritical() << "Can't accept socket! Encryption timeout!";
-		emit finished();
+	m_HandshakeTime.start();
+	m_HandshakeTimer = new QTimer(this);
+	m_HandshakeTimer->setSingleShot(true);
+	connect(m_HandshakeTimer, &QTimer::timeout, this, &RemoteConnection::handshakeTimeout);
+	m_HandshakeTimer->start(timeout * 1000);
+
+	m_socket->setSslConfiguration(gEnv->pSslContext->GetConfiguration());
+	m_socket->startServerEncryption();
+}
+
+void RemoteConnection::handshakeTimeout()
+{
+	if (bConnected)
 		return;
-	}
+
+	qCritical() << "Can't accept socket" << m_socket << "! Encryption timeout!";
+	close();
 }
 
 void RemoteConnection::connected()
@@ -90,6 +128,11 @@ void RemoteConnection::connected()
 	if (!m_socket)
 		return;
 
+	if (m_HandshakeTimer)
+		m_HandshakeTimer->stop();
+
+	qDebug() << "Remote client" << m_socket << "handshake time" << m_HandshakeTime.elapsed() << "ms.";
+
 	m_Client.socket = m_socket;
 	m_Client.server = nullptr;
 	m_Client.isAdmin = false;
@@ -107,6 +150,9 @@ void RemoteConnection::connected()
 
 	qInfo() << "Remote client" << m_socket << "connected.";
 	qInfo() << "Remote client count " << gEnv->pRemoteServer->GetClientCount();
+
+	if (!m_WriteBuffer.isEmpty())
+		Flush();
 }
 
 void RemoteConnection::disconnected()
@@ -137,42 +183,76 @@ void RemoteConnection::readyRead()
 	if (!m_socket)
 		return;
 
-	m_InputPacketsCount++;
-
-	emit received();
-
-	// If client send a lot bad packet we need disconnect him
-	if (m_BadPacketsCount >= m_maxBadPacketsCount)
+	// Read by chunks, one chunk can contain several packets or only part of packet
+	while (m_socket->bytesAvailable() > 0)
 	{
-		qWarning() << "Exceeded the number of bad packets from a client. Connection will be closed" << m_socket;
-		close();
-		return;
-	}
-
-	//qDebug() << "Read message from client" << m_socket;
-	//qDebug() << "Available bytes for read" << m_socket->bytesAvailable();
+		QByteArray chunk = m_socket->read(m_maxPacketSize);
+		m_Decoder.Append(chunk.constData(), chunk.size());
 
-	// Check bytes count before reading
-	if (m_socket->bytesAvailable() > m_maxPacketSize)
-	{
-		qWarning() << "Very big packet from client" << m_socket;
-		m_BadPacketsCount++;
-		return;
-	}
-	else if (m_socket->bytesAvailable() <= 0)
-	{
-		qDebug() << "Very small packet from client" << m_socket;
-		m_BadPacketsCount++;
-		return;
-	}
+		gEnv->pRemoteServer->GetCounters()->inputBytes.fetchAndAddRelaxed(chunk.size());
 
-	qDebug() << "Read message from remote client" << m_socket;
+		SFireNetTcpFrame frame;
+		while (m_Decoder.Next(frame))
+		{
+			// Remote clients are not delayed, only disconnected
+			if (m_RateLimitMode != ERateLimitMode::Disabled &&
+				m_RateBucket.Take(RateLimiter::GetPacketCost(frame.data), m_Rate, m_RateBurst, RateLimiter::Now()) > 0)
+			{
+				qWarning() << "Remote client" << m_socket << "exceeded packets rate limit. Connection will be closed";
+				gEnv->pRemoteServer->GetCounters()->rateLimited.fetchAndAddRelaxed(1);
+				close();
+				return;
+			}
+
+			gEnv->pRemoteServer->GetCounters()->inputPackets.fetchAndAddRelaxed(1);
+
+			// If client send a lot bad packet we need disconnect him
+			if (m_BadPacketsCount >= m_maxBadPacketsCount)
+			{
+				qWarning() << "Exceeded the number of bad packets from a client. Connection will be closed" << m_socket;
+				close();
+				return;
+			}
+
+			// Client use binary framing - answer him the same way
+			if (frame.format == EFireNetTcpFrameFormat::Binary && !bBinaryFraming)
+			{
+				qDebug() << "Remote client" << m_socket << "switched to binary framing";
+				bBinaryFraming = true;
+			}
+
+			qDebug() << "Read message from remote client" << m_socket;
+
+			CTcpPacket packet(frame.data.c_str());
+
+			if (frame.format == EFireNetTcpFrameFormat::Binary && frame.type != packet.getType())
+			{
+				qWarning() << "Wrong packet type in frame header from remote client" << m_socket;
+				m_BadPacketsCount++;
+				gEnv->pRemoteServer->GetCounters()->badPackets.fetchAndAddRelaxed(1);
+				continue;
+			}
+
+			ProcessPacket(packet);
+		}
 
-	CTcpPacket packet(m_socket->readAll());
+		if (m_Decoder.IsCorrupted())
+		{
+			qWarning() << "Can't decode stream from remote client" << m_socket << ". Connection will be closed";
+			close();
+			return;
+		}
+	}
+}
 
+void RemoteConnection::ProcessPacket(CTcpPacket & packet)
+{
 	if (packet.getType() == EFireNetTcpPacketType::Query)
 	{
-		switch (packet.ReadQuery())
+		EFireNetTcpQuery query = packet.ReadQuery();
+		gEnv->pRemoteServer->GetCounters()->AddQuery(query);
+
+		switch (query)
 		{
 		case EFireNetTcpQuery::AdminLogin :
 		{
@@ -204,10 +284,16 @@ void RemoteConnection::readyRead()
 			pQuerys->onGameServerUpdateOnlineProfile(packet);
 			break;
 		}
+		case EFireNetTcpQuery::SetChatMember :
+		{
+			pQuerys->onSetChatMember(packet);
+			break;
+		}
 		default:
 		{
 			qCritical() << "Error reading query. Can't get query type!";
 			m_BadPacketsCount++;
+			gEnv->pRemoteServer->GetCounters()->badPackets.fetchAndAddRelaxed(1);
 			break;
 		}
 		}
@@ -216,6 +302,7 @@ void RemoteConnection::readyRead()
 	{
 		qCritical() << "Error reading packet. Can't get packet type!";
 		m_BadPacketsCount++;
+		gEnv->pRemoteServer->GetCounters()->badPackets.fetchAndAddRelaxed(1);
 	}
 }
 
@@ -226,10 +313,6 @@ void RemoteConnection::bytesWritten(qint64 bytes)
 	if (!m_socket)
 		return;
 
-	emit sended();
-
-	bLastMsgSended = true;
-
 	qDebug() << "Message to remote client" << m_socket << "sended! Size =" << bytes;
 }
 
@@ -244,19 +327,6 @@ void RemoteConnection::socketError(QAbstractSocket::SocketError error)
 	}
 }
 
-void RemoteConnection::CalculateStatistic()
-{
-	m_PacketsSpeed = m_InputPacketsCount;
-
-	if (m_PacketsSpeed >= m_maxPacketSpeed)
-	{
-		qWarning() << "Client" << m_socket << "exceeded the limit of the number of packets per second. Speed:" << m_PacketsSpeed << ". Maximum speed :" << m_maxPacketSpeed;
-		close();
-	}
-
-	m_InputPacketsCount = 0;
-}
-
 void RemoteConnection::close()
 {
 	if (!m_socket)
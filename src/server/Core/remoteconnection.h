@@ -6,10 +6,15 @@
 
 #include <QObject>
 #include <QSslSocket>
-#include <queue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArray>
 
 #include "global.h"
 #include "tcppacket.h"
+#include "ratelimiter.h"
+
+#include <FireNetCore/IFireNetTcpFrame.h>
 
 class RemoteClientQuerys;
 
@@ -22,7 +27,7 @@ public:
 public:
 	void                  SendMessage(CTcpPacket &packet);
 private:
-	void                  CalculateStatistic();
+	void                  ProcessPacket(CTcpPacket &packet);
 public slots:
 	void                  accept(qint64 socketDescriptor);
 	void                  close();
@@ -31,28 +36,34 @@ public slots:
 	void                  readyRead();
 	void                  bytesWritten(qint64 bytes);
 	void                  socketError(QAbstractSocket::SocketError error);
-	void                  Update();
+	void                  Flush();
+	void                  handshakeTimeout();
 signals:
 	void                  finished();
-	void                  received();
-	void                  sended();
 private:
 	QSslSocket*           m_socket;
 	RemoteClientQuerys*   pQuerys;
 	SRemoteClient         m_Client;
-	std::queue<CTcpPacket> m_Packets;
+	QByteArray            m_WriteBuffer;
+	int                   m_WriteBufferPackets;
+
+	CFireNetTcpFrameDecoder m_Decoder;
+
+	QTimer*               m_HandshakeTimer;
+	QElapsedTimer         m_HandshakeTime;
 private:
 	int                   m_maxPacketSize;
 	int                   m_maxBadPacketsCount;
 	int                   m_BadPacketsCount;
 
-	QTime                 m_Time;
-	int                   m_InputPacketsCount;
-	int                   m_PacketsSpeed;
-	int                   m_maxPacketSpeed;
+	ERateLimitMode        m_RateLimitMode;
+	STokenBucket          m_RateBucket;
+	double                m_Rate;
+	double                m_RateBurst;
 
 	bool                  bConnected;
-	bool                  bLastMsgSended;
+	bool                  bFlushScheduled;
+	bool                  bBinaryFraming;
 };
 
 #endif // REMOTECONNECTION_H
\ No newline at end of file
@@ -16,6 +16,7 @@ RemoteServer::RemoteServer(QObject *parent) : QTcpServer(parent),
 	bHaveAdmin(false)
 {
 	m_MaxClinetCount = 0;
+	m_Time = QTime::currentTime();
 }
 
 RemoteServer::~RemoteServer()
@@ -31,10 +32,21 @@ void RemoteServer::Clear()
 
 	m_connections.clear();
 	m_Clients.clear();
+	m_GameServers.Clear();
 }
 
 void RemoteServer::Update()
 {
+	// Every one second - release expired reservations of game servers
+	if (m_Time.elapsed() >= 1000)
+	{
+		m_Time = QTime::currentTime();
+
+		m_GameServers.SetTimes(gEnv->pSettings->GetVariable("remote_reservation_time").toInt() * 1000,
+			gEnv->pSettings->GetVariable("remote_server_timeout").toInt() * 1000);
+		m_GameServers.SetFillServers(gEnv->pSettings->GetVariable("remote_fill_servers").toBool());
+		m_GameServers.RemoveExpired();
+	}
 }
 
 void RemoteServer::run()
@@ -43,6 +55,10 @@ void RemoteServer::run()
 	{
 		gEnv->m_ServerStatus.m_RemoteServerStatus = "online";
 
+		m_GameServers.SetTimes(gEnv->pSettings->GetVariable("remote_reservation_time").toInt() * 1000,
+			gEnv->pSettings->GetVariable("remote_server_timeout").toInt() * 1000);
+		m_GameServers.SetFillServers(gEnv->pSettings->GetVariable("remote_fill_servers").toBool());
+
 		qInfo() << "Remote server started on" << gEnv->pSettings->GetVariable("sv_ip").toString();
 		qInfo() << "Remote server thread " << QThread::currentThread();
 	}
@@ -68,10 +84,6 @@ void RemoteServer::incomingConnection(qintptr socketDescriptor)
 	connect(this, &RemoteServer::close, m_remoteConnection, &RemoteConnection::close);
 	connect(m_remoteConnection, &RemoteConnection::finished, this, &RemoteServer::CloseConnection);
 
-	connect(m_remoteConnection, &RemoteConnection::received, gEnv->pServer, &TcpServer::MessageReceived);
-	connect(m_remoteConnection, &RemoteConnection::sended, gEnv->pServer, &TcpServer::MessageSended);
-	connect(gEnv->pTimer, &QTimer::timeout, m_remoteConnection, &RemoteConnection::Update);
-
 	m_connections.append(m_remoteConnection);
 	m_remoteConnection->accept(socketDescriptor);
 }
@@ -124,6 +136,11 @@ void RemoteServer::RemoveClient(SRemoteClient &client)
 			if (it->socket == client.socket)
 			{
 				qDebug() << "Removing remote client" << client.socket;
+
+				// Players can't be sent to disconnected game server
+				if (it->isGameServer && it->server)
+					m_GameServers.Unregister(it->server->name);
+
 				m_Clients.erase(it);
 				return;
 			}
@@ -163,80 +180,12 @@ void RemoteServer::UpdateClient(SRemoteClient* client)
 	qWarning() << "Can't update client. Client" << client->socket << "not found";
 }
 
-bool RemoteServer::CheckGameServerExists(const QString &name, const QString &ip, int port)
-{
-	QMutexLocker locker(&m_Mutex);
-
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-	{
-		if (it->server)
-		{
-			if ((it->server->ip == ip && it->server->port == port) || it->server->name == name)
-			{
-				return true;
-			}
-		}
-	}
-
-	return false;
-}
-
 int RemoteServer::GetClientCount()
 {
 	QMutexLocker locker(&m_Mutex);
 	return bHaveAdmin ? m_Clients.size() - 1 : m_Clients.size();
 }
 
-QStringList RemoteServer::GetServerList()
-{
-	QStringList serverList;
-
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-	{
-		if (it->server != nullptr && it->isGameServer)
-		{
-			serverList.push_back(it->server->name + " <" + it->server->ip + ":" + QString::number(it->server->port) + ">"
-			" Map <" + it->server->map + ":" + it->server->gamerules + ">"
-			" Online <" + QString::number(it->server->online) + "/" + QString::number(it->server->maxPlayers) + ">");
-		}
-	}
-
-	return serverList;
-}
-
-SGameServer* RemoteServer::GetGameServer(const QString &name, const QString &map, const QString &gamerules)
-{
-	SGameServer gameServer;
-	bool byMap = false;
-	bool byGameRules = false;
-	bool byName = false;
-
-	if (!map.isEmpty())
-		byMap = true;
-	if (!gamerules.isEmpty() && !byMap)
-		byGameRules = true;
-	if (!name.isEmpty() && !byMap && !byGameRules)
-		byName = true;
-
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-	{
-		if (it->server != nullptr && it->isGameServer)
-		{
-			// by map
-			if (byMap && it->server->map == map)
-				return it->server;
-			// by gamerules
-			if (byGameRules && it->server->gamerules == gamerules)
-				return it->server;
-			// by name
-			if (byName && it->server->name == name)
-				return it->server;
-		}
-	}
-
-	return nullptr;
-}
-
 void RemoteServer::CloseConnection()
 {
 	if (!QObject::sender())
@@ -9,9 +9,12 @@
 #include <QTcpServer>
 #include <QSslSocket>
 #include <QMutex>
+#include <QTime>
 
 #include "global.h"
 #include "remoteconnection.h"
+#include "trafficcounters.h"
+#include "gameserverregistry.h"
 
 class CTcpPacket;
 
@@ -28,16 +31,17 @@ public:
 	void                     AddNewClient(SRemoteClient &client);
 	void                     RemoveClient(SRemoteClient &client);
 	void                     UpdateClient(SRemoteClient* client);
-	bool                     CheckGameServerExists(const QString &name, const QString &ip, int port);
 	void                     SetMaxClientCount(int count) { m_MaxClinetCount = count; }
 	int                      GetClientCount();
 	int                      GetMaxClientCount() { return m_MaxClinetCount; }
 	bool                     IsHaveAdmin() { return bHaveAdmin; }
 	void                     SetAdmin(bool bAmin) { bHaveAdmin = bAmin; }
 
-	QStringList              GetServerList();
-	SGameServer*             GetGameServer(const QString &name, const QString &map, const QString &gamerules);
-	
+	QStringList              GetServerList() { return m_GameServers.GetServerList(); }
+	// Registered game servers, thread-safe
+	GameServerRegistry*      GetGameServers() { return &m_GameServers; }
+
+	STrafficCounters*        GetCounters() { return &m_Counters; }
 private:
 	bool                     CreateServer();
 	virtual void             incomingConnection(qintptr socketDescriptor);
@@ -51,6 +55,10 @@ private:
 	QVector<SRemoteClient>   m_Clients;
 	QList<RemoteConnection*> m_connections;
 	QMutex                   m_Mutex;
+	GameServerRegistry       m_GameServers;
+
+	STrafficCounters         m_Counters;
+	QTime                    m_Time;
 
 	int                      m_MaxClinetCount;
 	bool                     bHaveAdmin;
@@ -0,0 +1,99 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QFile>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "global.h"
+#include "sslcontext.h"
+
+SslContext::SslContext(QObject *parent) : QObject(parent),
+	bLoaded(false)
+{
+}
+
+SslContext::~SslContext()
+{
+	qDebug() << "~SslContext";
+}
+
+bool SslContext::Load(const QString &certificatePath, const QString &keyPath)
+{
+	m_CertificatePath = certificatePath;
+	m_KeyPath = keyPath;
+
+	return Reload();
+}
+
+bool SslContext::Reload()
+{
+	QSslConfiguration configuration;
+
+	if (!CreateConfiguration(configuration))
+	{
+		qCritical() << "Can't load SSL certificate" << m_CertificatePath << "and key" << m_KeyPath << (bLoaded ? ". Old certificate still used" : "");
+		return false;
+	}
+
+	QWriteLocker locker(&m_Lock);
+	m_Configuration = configuration;
+	bLoaded = true;
+
+	qInfo() << "SSL certificate" << m_CertificatePath << "loaded. Expiry date :" << configuration.localCertificate().expiryDate().toString();
+
+	return true;
+}
+
+QSslConfiguration SslContext::GetConfiguration()
+{
+	QReadLocker locker(&m_Lock);
+	return m_Configuration;
+}
+
+bool SslContext::IsLoaded()
+{
+	QReadLocker locker(&m_Lock);
+	return bLoaded;
+}
+
+bool SslContext::CreateConfiguration(QSslConfiguration &configuration)
+{
+	QFile certificateFile(m_CertificatePath);
+	QFile keyFile(m_KeyPath);
+
+	if (!certificateFile.open(QIODevice::ReadOnly))
+	{
+		qWarning() << "Can't open SSL certificate file" << m_CertificatePath;
+		return false;
+	}
+
+	if (!keyFile.open(QIODevice::ReadOnly))
+	{
+		qWarning() << "Can't open SSL key file" << m_KeyPath;
+		return false;
+	}
+
+	QSslCertificate certificate(certificateFile.readAll(), QSsl::Pem);
+	QSslKey key(keyFile.readAll(), QSsl::Rsa, QSsl::Pem);
+
+	if (certificate.isNull())
+	{
+		qWarning() << "Bad SSL certificate" << m_CertificatePath;
+		return false;
+	}
+
+	if (key.isNull())
+	{
+		qWarning() << "Bad SSL key" << m_KeyPath;
+		return false;
+	}
+
+	configuration = QSslConfiguration::defaultConfiguration();
+	configuration.setLocalCertificate(certificate);
+	configuration.setPrivateKey(key);
+
+	return true;
+}
@@ -0,0 +1,38 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef SSLCONTEXT_H
+#define SSLCONTEXT_H
+
+#include <QObject>
+#include <QSslConfiguration>
+#include <QReadWriteLock>
+
+// Process-wide TLS settings for accepted sockets.
+// Certificate and private key are read and parsed once, every connection get copy of
+// implicitly shared configuration. Reload build new configuration first and swap it only
+// when both files are valid, so broken files on disk never break new connections.
+class SslContext : public QObject
+{
+	Q_OBJECT
+public:
+	explicit SslContext(QObject *parent = nullptr);
+	~SslContext();
+public:
+	bool                Load(const QString &certificatePath, const QString &keyPath);
+	bool                Reload();
+
+	QSslConfiguration   GetConfiguration();
+	bool                IsLoaded();
+private:
+	bool                CreateConfiguration(QSslConfiguration &configuration);
+private:
+	QString             m_CertificatePath;
+	QString             m_KeyPath;
+
+	QSslConfiguration   m_Configuration;
+	QReadWriteLock      m_Lock;
+	bool                bLoaded;
+};
+
+#endif // SSLCONTEXT_H
@@ -4,30 +4,44 @@
 #include "global.h"
 #include "tcpconnection.h"
 #include "tcpserver.h"
+#include "tcpthread.h"
 #include "tcppacket.h"
+#include "sslcontext.h"
 
 #include "Workers/Packets/clientquerys.h"
+#include "Workers/Packets/querydispatcher.h"
+#include "Workers/Databases/dbtaskpool.h"
 #include "Workers/Databases/mysqlconnector.h"
 #include "Workers/Databases/dbworker.h"
+#include "Workers/Databases/profilecache.h"
 #include "Tools/settings.h"
 
 TcpConnection::TcpConnection(QObject *parent) : QObject(parent),
 	pQuery(nullptr),
+	pCounters(nullptr),
 	m_Socket(nullptr),
+	m_WriteBufferPackets(0),
+	m_HandshakeTimer(nullptr),
 	bConnected(false),
+	bHandshaking(false),
 	bIsQuiting(false),
-	bLastMsgSended(true)
+	bFlushScheduled(false),
+	bBinaryFraming(false),
+	bHasPendingFrame(false),
+	bRateLimited(false),
+	bBusy(false),
+	bClosePending(false)
 {
 	Q_UNUSED(parent);
 
 	m_maxPacketSize = gEnv->pSettings->GetVariable("net_max_packet_read_size").toInt();
+	m_Decoder = CFireNetTcpFrameDecoder(m_maxPacketSize);
 	m_maxBadPacketsCount = gEnv->pSettings->GetVariable("net_max_bad_packets_count").toInt();
 	m_BadPacketsCount = 0;
 
-	m_Time = QTime::currentTime();
-	m_InputPacketsCount = 0;
-	m_PacketsSpeed = 0;
-	m_maxPacketSpeed = gEnv->pSettings->GetVariable("net_max_packets_speed").toInt();
+	m_RateLimitMode = static_cast<ERateLimitMode>(gEnv->pSettings->GetVariable("net_rate_limit_mode").toInt());
+	m_Rate = gEnv->pSettings->GetVariable("net_rate_limit_rate").toDouble();
+	m_RateBurst = gEnv->pSettings->GetVariable("net_rate_limit_burst").toDouble();
 }
 
 TcpConnection::~TcpConnection()
@@ -37,26 +51,88 @@ TcpConnection::~TcpConnection()
 	SAFE_RELEASE(pQuery);
 }
 
-void TcpConnection::Update()
+void TcpConnection::SendMessage(CTcpPacket& packet)
 {
-	if (!m_Packets.empty() && m_Socket && bConnected && bLastMsgSended)
+	const char* data = packet.toString();
+
+	// Answer from database task, write buffer owned by connection thread
+	if (QThread::currentThread() != thread())
 	{
-		bLastMsgSended = false;
-		CTcpPacket packet = m_Packets.front();
-		m_Packets.pop();
-		m_Socket->write(packet.toString());
+		QByteArray buffer(data, static_cast<int>(packet.getLength()));
+		QMetaObject::invokeMethod(this, "SendData", Qt::QueuedConnection, Q_ARG(QByteArray, buffer), Q_ARG(int, static_cast<int>(packet.getType())));
+		return;
 	}
 
-	if (m_Time.elapsed() >= 1000)
+	if (bIsQuiting)
+		return;
+
+	AppendPacket(data, static_cast<int>(packet.getLength()), packet.getType());
+}
+
+void TcpConnection::SendEncoded(const QByteArray & data, EFireNetTcpPacketType type)
+{
+	if (QThread::currentThread() != thread())
 	{
-		m_Time = QTime::currentTime();
-		CalculateStatistic();
+		QMetaObject::invokeMethod(this, "SendData", Qt::QueuedConnection, Q_ARG(QByteArray, data), Q_ARG(int, static_cast<int>(type)));
+		return;
 	}
+
+	if (bIsQuiting)
+		return;
+
+	AppendPacket(data.constData(), data.size(), type);
 }
 
-void TcpConnection::SendMessage(CTcpPacket& packet)
+void TcpConnection::SendData(const QByteArray & data, int type)
+{
+	if (bIsQuiting)
+		return;
+
+	AppendPacket(data.constData(), data.size(), static_cast<EFireNetTcpPacketType>(type));
+}
+
+void TcpConnection::AppendPacket(const char * data, int size, EFireNetTcpPacketType type)
+{
+	// Client can't read bigger packet in any framing, length in binary header would wrap
+	if (size > static_cast<int>(EFireNetTcpFrameHeader::MAX_PAYLOAD))
+	{
+		qCritical() << "Can't send packet to client" << m_Socket << ". Packet size" << size << "bigger than frame limit";
+		return;
+	}
+
+	if (bBinaryFraming)
+	{
+		char header[static_cast<int>(EFireNetTcpFrameHeader::SIZE)];
+		FireNetWriteTcpFrameHeader(header, type, static_cast<std::size_t>(size));
+		m_WriteBuffer.append(header, sizeof(header));
+	}
+
+	m_WriteBuffer.append(data, size);
+	m_WriteBufferPackets++;
+
+	// All packets sended during one event loop iteration go to socket with one write
+	if (!bFlushScheduled)
+	{
+		bFlushScheduled = true;
+		QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
+	}
+}
+
+void TcpConnection::Flush()
 {
-	m_Packets.push(packet);
+	bFlushScheduled = false;
+
+	if (!m_Socket || !bConnected || m_WriteBuffer.isEmpty())
+		return;
+
+	m_Socket->write(m_WriteBuffer);
+	m_LastActivity.start();
+
+	pCounters->outputPackets.fetchAndAddRelaxed(m_WriteBufferPackets);
+	pCounters->outputBytes.fetchAndAddRelaxed(m_WriteBuffer.size());
+
+	m_WriteBuffer.clear();
+	m_WriteBufferPackets = 0;
 }
 
 void TcpConnection::quit()
@@ -64,7 +140,11 @@ void TcpConnection::quit()
 	qDebug() << "Quit called, closing client";
 
 	bIsQuiting = true;
-	m_Socket->close();
+
+	FinishHandshake(false);
+
+	if (m_Socket)
+		m_Socket->close();
 }
 
 void TcpConnection::accept(qint64 socketDescriptor)
@@ -79,201 +159,381 @@ void TcpConnection::accept(qint64 socketDescriptor)
 		return;
 	}
 
+	bHandshaking = true;
+	m_HandshakeTime.start();
+
 	if (!m_Socket->setSocketDescriptor(socketDescriptor))
 	{
 		qDebug() << "Can't accept socket!";
+		FinishHandshake(false);
+		emit closed();
 		return;
 	}
 
-	m_Socket->setLocalCertificate("key.pem");
-	m_Socket->setPrivateKey("key.key");
-	m_Socket->startServerEncryption();
+	m_PeerAddress = m_Socket->peerAddress();
 
+	// Handshake goes in event loop, encrypted() call connected() when it done.
+	// Thread don't wait here, so slow client can't stop other connections
 	int timeout = gEnv->pSettings->GetVariable("net_encryption_timeout").toInt();
 
-	if (!m_Socket->waitForEncrypted(timeout * 1000))
-	{
-		qDebug() << "Can't accept socket! Encryption timeout!";
-		emit quit();
+	m_HandshakeTimer = new QTimer(this);
+	m_HandshakeTimer->setSingleShot(true);
+	connect(m_HandshakeTimer, &QTimer::timeout, this, &TcpConnection::handshakeTimeout);
+	m_HandshakeTimer->start(timeout * 1000);
+
+	m_Socket->setSslConfiguration(gEnv->pSslContext->GetConfiguration());
+	m_Socket->startServerEncryption();
+
+	qDebug() << "Client accepted, handshake started. Socket " << m_Socket;
+}
+
+void TcpConnection::handshakeTimeout()
+{
+	if (!bHandshaking)
+		return;
+
+	qDebug() << "Can't accept socket" << m_Socket << "! Encryption timeout!";
+	quit();
+}
+
+void TcpConnection::FinishHandshake(bool success)
+{
+	if (!bHandshaking)
 		return;
-	}
 
-	qDebug() << "Client accepted. Socket " << m_Socket;
+	bHandshaking = false;
+
+	if (m_HandshakeTimer)
+		m_HandshakeTimer->stop();
+
+	emit handshakeFinished(success, m_HandshakeTime.elapsed());
 }
 
 void TcpConnection::connected()
 {
-    if(!m_Socket)
+    if(!m_Socket || bIsQuiting)
 		return;
 
+	FinishHandshake(true);
+
 	m_Client.socket = m_Socket;
-	m_Client.profile = nullptr;
+	m_Client.profile.clear();
 	m_Client.status = 0;	
 
-	// Add client to server client list
-	gEnv->pServer->AddNewClient(m_Client);
-
 	// Create client querys worker
 	pQuery = new ClientQuerys(this);
 	// Set socket for client querys worker
 	pQuery->SetSocket(m_Socket);
-	// Set client
+	// Set client (creates empty profile)
 	pQuery->SetClient(&m_Client);
 	// Set connection
 	pQuery->SetConnection(this);
 
+	// Add client to server client list
+	gEnv->pServer->AddNewClient(m_Client);
+
 	bConnected = true;
+	m_LastActivity.start();
 
 	qInfo() << "Client" << m_Socket << "connected.";
 
+	if (!m_WriteBuffer.isEmpty())
+		Flush();
+
 	emit opened();
 }
 
 void TcpConnection::disconnected()
 {
+	FinishHandshake(false);
+
 	if (!m_Socket || !bConnected)
 	{
 		emit closed();
 		return;
 	}
 
-	// Remove client from server client list
-	gEnv->pServer->RemoveClient(m_Client);
-
 	qInfo() << "Client" << m_Socket << "disconnected.";
 
+	// Database task own client until it finished, all cleanup done after it.
+	// Login finished by this task can still put player to presence
+	if (bBusy)
+	{
+		bClosePending = true;
+		return;
+	}
+
+	ReleaseClient();
 	emit closed();
 }
 
-void TcpConnection::readyRead()
+void TcpConnection::ReleaseClient()
 {
-    if(!m_Socket || bIsQuiting)
-		return;
-
-	m_InputPacketsCount++;
+	// Session in presence released only once
+	bConnected = false;
 
-	emit received();
+	// Remove client from server client list
+	gEnv->pServer->RemoveClient(m_Client);
 
-	// If client send a lot bad packet we need disconnect him
-	if (m_BadPacketsCount >= m_maxBadPacketsCount)
-	{
-		qWarning() << "Exceeded the number of bad packets from a client. Connection will be closed" << m_Socket;
-		quit();
+	if (!m_Client.profile || m_Client.profile->uid <= 0)
 		return;
-	}
 
-	// STACK OVERFLOW HERE !!!
-    //qDebug() << "Read message from client" << m_Socket;
- 	//qDebug() << "Available bytes for read" << m_Socket->bytesAvailable();
+	// Changes of leaving player written without waiting flush timer
+	gEnv->pDBWorker->GetProfileCache()->FlushProfile(m_Client.profile->uid);
 
-	// Check bytes count before reading
-	if (m_Socket->bytesAvailable() > m_maxPacketSize)
-	{
-		qWarning() << "Very big packet from client" << m_Socket;
-		m_BadPacketsCount++;
-		return;
-	}
-	else if (m_Socket->bytesAvailable() <= 0)
-	{
-		qDebug() << "Very small packet from client" << m_Socket;
-		m_BadPacketsCount++;
+	// Only players with profile are in presence
+	if (m_Client.status == 1)
+		gEnv->pServer->GetPresence()->SetOffline(m_Client.profile->uid);
+}
+
+void TcpConnection::readyRead()
+{
+    if(!m_Socket || bIsQuiting || bRateLimited || bBusy)
 		return;
-	}
 
-	CTcpPacket packet(m_Socket->readAll());
+	m_LastActivity.start();
 
-	if(packet.getType() == EFireNetTcpPacketType::Query)
+	for (;;)
 	{
-		switch (packet.ReadQuery())
-		{
-		case EFireNetTcpQuery::Login :
-		{
-			pQuery->onLogin(packet);
-			break;
-		}
-		case EFireNetTcpQuery::Register :
-		{
-			pQuery->onRegister(packet);
-			break;
-		}
-		case EFireNetTcpQuery::CreateProfile :
-		{
-			pQuery->onCreateProfile(packet);
-			break;
-		}
-		case EFireNetTcpQuery::GetProfile :
-		{
-			pQuery->onGetProfile();
-			break;
-		}
-		case EFireNetTcpQuery::GetShop :
-		{
-			pQuery->onGetShopItems();
-			break;
-		}
-		case EFireNetTcpQuery::BuyItem :
-		{
-			pQuery->onBuyItem(packet);
-			break;
-		}
-		case EFireNetTcpQuery::RemoveItem :
+		// Read by chunks only when decoder need more data, one chunk can contain several packets or only part of packet
+		if (!bHasPendingFrame && !m_Decoder.Next(m_PendingFrame))
 		{
-			pQuery->onRemoveItem(packet);
-			break;
-		}		
-		case EFireNetTcpQuery::SendInvite :
-		{
-			pQuery->onInvite(packet);
-			break;
-		}
-		case EFireNetTcpQuery::DeclineInvite :
-		{
-			pQuery->onDeclineInvite(packet);
-			break;
-		}
-		case EFireNetTcpQuery::AcceptInvite :
-		{
-			break;
+			if (m_Decoder.IsCorrupted())
+			{
+				qWarning() << "Can't decode stream from client" << m_Socket << ". Connection will be closed";
+				quit();
+				return;
+			}
+
+			if (m_Socket->bytesAvailable() <= 0)
+				return;
+
+			QByteArray chunk = m_Socket->read(m_maxPacketSize);
+			m_Decoder.Append(chunk.constData(), chunk.size());
+
+			pCounters->inputBytes.fetchAndAddRelaxed(chunk.size());
+			continue;
 		}
-		case EFireNetTcpQuery::RemoveFriend :
+
+		// Frame stay pending while client wait for tokens
+		bHasPendingFrame = true;
+
+		if (!CheckRateLimit(m_PendingFrame))
+			return;
+
+		bHasPendingFrame = false;
+
+		const SFireNetTcpFrame &frame = m_PendingFrame;
+
+		pCounters->inputPackets.fetchAndAddRelaxed(1);
+
+		// If client send a lot bad packet we need disconnect him
+		if (m_BadPacketsCount >= m_maxBadPacketsCount)
 		{
-			pQuery->onRemoveFriend(packet);
-			break;
+			qWarning() << "Exceeded the number of bad packets from a client. Connection will be closed" << m_Socket;
+			quit();
+			return;
 		}
-		case EFireNetTcpQuery::SendChatMsg :
+
+		// Client use binary framing - answer him the same way
+		if (frame.format == EFireNetTcpFrameFormat::Binary && !bBinaryFraming)
 		{
-			pQuery->onChatMessage(packet);
-			break;
+			qDebug() << "Client" << m_Socket << "switched to binary framing";
+			bBinaryFraming = true;
 		}
-		case EFireNetTcpQuery::GetServer :
+
+		CTcpPacket packet(frame.data.c_str());
+
+		if (frame.format == EFireNetTcpFrameFormat::Binary && frame.type != packet.getType())
 		{
-			pQuery->onGetGameServer(packet);
-			break;
+			qWarning() << "Wrong packet type in frame header from client" << m_Socket;
+			m_BadPacketsCount++;
+			pCounters->badPackets.fetchAndAddRelaxed(1);
+			continue;
 		}
 
-		default:
+		ProcessPacket(packet);
+
+		// Next packets wait until database task finished, so answers keep order
+		if (bIsQuiting || bBusy)
+			return;
+	}
+}
+
+bool TcpConnection::CheckRateLimit(const SFireNetTcpFrame & frame)
+{
+	if (m_RateLimitMode == ERateLimitMode::Disabled)
+		return true;
+
+	// Cost known from raw frame, so abusive client don't cost us packet parsing
+	const double cost = RateLimiter::GetPacketCost(frame.data);
+
+	qint64 wait = m_RateBucket.Take(cost, m_Rate, m_RateBurst, RateLimiter::Now());
+
+	if (wait == 0)
+	{
+		RateLimiter* pIpLimiter = gEnv->pServer->GetIpLimiter();
+		wait = pIpLimiter->Take(m_PeerAddress, cost);
+
+		if (wait > 0)
+			m_RateBucket.Refund(cost, m_RateBurst);
+	}
+
+	if (wait == 0)
+		return true;
+
+	pCounters->rateLimited.fetchAndAddRelaxed(1);
+
+	if (m_RateLimitMode == ERateLimitMode::Hard)
+	{
+		qWarning() << "Client" << m_Socket << "exceeded packets rate limit. Connection will be closed";
+		quit();
+		return false;
+	}
+
+	// Soft mode : stop reading until tokens refilled, unread data stay in bounded socket buffer
+	bRateLimited = true;
+
+	QTimer::singleShot(static_cast<int>(wait), this, [this]()
+	{
+		bRateLimited = false;
+		readyRead();
+	});
+
+	return false;
+}
+
+void TcpConnection::ProcessPacket(CTcpPacket & packet)
+{
+	if(packet.getType() == EFireNetTcpPacketType::Query)
+	{
+		EFireNetTcpQuery query = packet.ReadQuery();
+		pCounters->AddQuery(query);
+
+		const SQueryHandler* handler = gEnv->pServer->GetDispatcher()->Find(query);
+
+		if (!handler)
 		{
 			qCritical() << "Error reading query. Can't get query type!";
 			m_BadPacketsCount++;
-			break;
-		}
+			pCounters->badPackets.fetchAndAddRelaxed(1);
+			return;
 		}
+
+		if (handler->type == EQueryHandlerType::Database)
+			RunDatabaseQuery(handler, packet);
+		else
+			handler->func(pQuery, packet);
 	}
 	else
 	{
 		qCritical() << "Error reading packet. Can't get packet type!";
 		m_BadPacketsCount++;
+		pCounters->badPackets.fetchAndAddRelaxed(1);
 	}
 }
 
-void TcpConnection::bytesWritten(qint64 bytes)
+void TcpConnection::RunDatabaseQuery(const SQueryHandler * handler, CTcpPacket & packet)
 {
-    if(!m_Socket)
+	bBusy = true;
+
+	// Tasks of one player go one by one, even from different connections.
+	// Not authorized client don't have uid yet, his tasks ordered by connection
+	quint64 key = 0;
+
+	if (m_Client.profile && m_Client.profile->uid > 0)
+		key = static_cast<quint64>(m_Client.profile->uid);
+	else
+		key = static_cast<quint64>(reinterpret_cast<quintptr>(this)) | (Q_UINT64_C(1) << 63);
+
+	TcpConnection* connection = this;
+	ClientQuerys* query = pQuery;
+	SQueryHandler::THandler func = handler->func;
+
+	gEnv->pDBWorker->GetTaskPool()->Post(key, [connection, query, func, packet]() mutable
+	{
+		func(query, packet);
+		QMetaObject::invokeMethod(connection, "QueryFinished", Qt::QueuedConnection);
+	});
+}
+
+void TcpConnection::QueryFinished()
+{
+	bBusy = false;
+
+	// Apply profile changes from other players after own query changes
+	while (!m_DeferredModifiers.isEmpty())
+	{
+		QPair<int, TProfileModifier> modifier = m_DeferredModifiers.takeFirst();
+		ModifyProfile(modifier.first, modifier.second);
+	}
+
+	if (bClosePending)
+	{
+		ReleaseClient();
+		emit closed();
 		return;
+	}
 
-	emit sended();
+	// Continue with packets received while query worked
+	readyRead();
+}
 
-	bLastMsgSended = true;
+void TcpConnection::ModifyProfile(int uid, const TProfileModifier &func)
+{
+	// Profile used by database task now
+	if (bBusy)
+	{
+		m_DeferredModifiers.append(qMakePair(uid, func));
+		return;
+	}
+
+	if (!m_Client.profile || m_Client.profile->uid != uid)
+		return;
+
+	func(*m_Client.profile);
+
+	// Publish new profile snapshot
+	gEnv->pServer->UpdateClient(&m_Client);
+}
+
+bool TcpConnection::IsIdle(qint64 idleTime)
+{
+	if (!m_Socket || !bConnected || bHandshaking || bIsQuiting || bFlushScheduled)
+		return false;
+
+	if (!m_WriteBuffer.isEmpty() || m_Decoder.GetBufferedSize() > 0 || bHasPendingFrame || bRateLimited || bBusy)
+		return false;
+
+	if (m_Socket->bytesToWrite() > 0 || m_Socket->bytesAvailable() > 0)
+		return false;
+
+	return m_LastActivity.isValid() && m_LastActivity.elapsed() >= idleTime;
+}
+
+void TcpConnection::migrate(TcpThread * target)
+{
+	if (!target || !target->GetThread() || target->GetThread() == thread())
+		return;
+
+	// Move only quiet connections, so no one packet lost or reordered
+	qint64 idleTime = gEnv->pSettings->GetVariable("sv_rebalance_idle_time").toInt() * 1000;
+
+	if (!IsIdle(idleTime))
+		return;
+
+	qDebug() << "Moving client" << m_Socket << "to" << target;
+
+	pCounters = target->GetCounters();
+	moveToThread(target->GetThread());
+
+	emit moved(target);
+}
+
+void TcpConnection::bytesWritten(qint64 bytes)
+{
+    if(!m_Socket)
+		return;
 
     qDebug() << "Message to client" << m_Socket << "sended! Size =" << bytes;
 }
@@ -302,6 +562,11 @@ QSslSocket * TcpConnection::CreateSocket()
 	qDebug() << "Creating socket for client";
 
 	QSslSocket *socket = new QSslSocket(this);
+
+	// Socket stop reading when buffer full, so client delayed by rate limit or database task
+	// wait in kernel buffers instead of server memory. Whole TLS record must fit in buffer
+	socket->setReadBufferSize(qMax(m_maxPacketSize * 4, 32 * 1024));
+
 	connect(socket, &QSslSocket::encrypted, this, &TcpConnection::connected, Qt::QueuedConnection);
 	connect(socket, &QSslSocket::disconnected, this, &TcpConnection::disconnected, Qt::QueuedConnection);
 	connect(socket, &QSslSocket::readyRead, this, &TcpConnection::readyRead, Qt::QueuedConnection);
@@ -310,17 +575,4 @@ QSslSocket * TcpConnection::CreateSocket()
 	connect(socket, static_cast<void (QSslSocket::*)(QAbstractSocket::SocketError)>(&QSslSocket::error), this, &TcpConnection::socketError, Qt::QueuedConnection);
 
 	return socket;
-}
-
-void TcpConnection::CalculateStatistic()
-{
-	m_PacketsSpeed = m_InputPacketsCount;
-
-	if (m_PacketsSpeed >= m_maxPacketSpeed)
-	{
-		qWarning() << "Client" << m_Socket << "exceeded the limit of the number of packets per second. Speed:" << m_PacketsSpeed << ". Maximum speed :" << m_maxPacketSpeed;
-		quit();
-	}
-
-	m_InputPacketsCount = 0;
 }
\ No newline at end of file
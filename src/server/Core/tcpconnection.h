@@ -7,13 +7,25 @@
 #include <QObject>
 #include <QSslSocket>
 #include <QTime>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArray>
 
-#include <queue>
+#include <functional>
 
 #include "global.h"
 #include "tcppacket.h"
+#include "trafficcounters.h"
+#include "ratelimiter.h"
+
+#include <FireNetCore/IFireNetTcpFrame.h>
 
 class ClientQuerys;
+class TcpThread;
+struct SQueryHandler;
+
+typedef std::function<void(SProfile&)> TProfileModifier;
+Q_DECLARE_METATYPE(TProfileModifier)
 
 class TcpConnection : public QObject
 {
@@ -22,10 +34,24 @@ public:
     explicit TcpConnection(QObject *parent = nullptr);
     ~TcpConnection();
 public:
+	// Can be called from database task of this connection
 	void                  SendMessage(CTcpPacket &packet);
+	// Send packet encoded before, shared data not copied
+	void                  SendEncoded(const QByteArray &data, EFireNetTcpPacketType type);
+	bool                  IsIdle(qint64 idleTime);
+	// Must be called before accept
+	void                  SetCounters(STrafficCounters* counters) { pCounters = counters; }
+	void                  SetRoute(const SConnectionRoute &route) { m_Client.route = route; }
+	QSslSocket*           GetSocket() { return m_Socket; }
 private:
 	QSslSocket*            CreateSocket();
-	void                   CalculateStatistic();
+	bool                   CheckRateLimit(const SFireNetTcpFrame &frame);
+	void                   ProcessPacket(CTcpPacket &packet);
+	void                   RunDatabaseQuery(const SQueryHandler* handler, CTcpPacket &packet);
+	void                   AppendPacket(const char* data, int size, EFireNetTcpPacketType type);
+	void                   FinishHandshake(bool success);
+	// Registry, presence and profile flush of closed client, only when no database task use it
+	void                   ReleaseClient();
 public slots:
 	void                   quit();
 	void                   accept(qint64 socketDescriptor);
@@ -35,31 +61,57 @@ public slots:
 	void                   bytesWritten(qint64 bytes);
 	void                   stateChanged(QAbstractSocket::SocketState socketState);
 	void                   socketError(QAbstractSocket::SocketError error);
-	void                   Update();
+	void                   Flush();
+	void                   handshakeTimeout();
+	// Thread-safe with Qt::QueuedConnection
+	void                   SendData(const QByteArray &data, int type);
+	void                   migrate(TcpThread* target);
+	// Connection thread only or Qt::QueuedConnection
+	void                   ModifyProfile(int uid, const TProfileModifier &func);
+	void                   QueryFinished();
 signals:
 	void                   opened();
 	void                   closed();
-
-	void                   received();
-	void                   sended();
+	void                   handshakeFinished(bool success, qint64 time);
+	void                   moved(TcpThread* target);
 private:
 	ClientQuerys*          pQuery;
+	STrafficCounters*      pCounters;
 	QSslSocket*            m_Socket;
 	SClient                m_Client;
-	std::queue<CTcpPacket> m_Packets;
+	QByteArray             m_WriteBuffer;
+	int                    m_WriteBufferPackets;
+
+	CFireNetTcpFrameDecoder m_Decoder;
+	SFireNetTcpFrame       m_PendingFrame;
+
+	QTimer*                m_HandshakeTimer;
+	QElapsedTimer          m_HandshakeTime;
+	QElapsedTimer          m_LastActivity;
+
+	// Profile changes came while database task use profile
+	QList<QPair<int, TProfileModifier>> m_DeferredModifiers;
 private:
 	int                    m_maxPacketSize;
 	int                    m_maxBadPacketsCount;
 	int                    m_BadPacketsCount;
 
-	QTime                  m_Time;
-	int                    m_InputPacketsCount;
-	int                    m_PacketsSpeed;
-	int                    m_maxPacketSpeed;
+	// Rate limiting
+	ERateLimitMode         m_RateLimitMode;
+	STokenBucket           m_RateBucket;
+	double                 m_Rate;
+	double                 m_RateBurst;
+	QHostAddress           m_PeerAddress;
 
 	bool                   bConnected;
+	bool                   bHandshaking;
 	bool                   bIsQuiting;
-	bool                   bLastMsgSended;
+	bool                   bFlushScheduled;
+	bool                   bBinaryFraming;
+	bool                   bHasPendingFrame;
+	bool                   bRateLimited;
+	bool                   bBusy;
+	bool                   bClosePending;
 };
 
 #endif // TCPCONNECTION_H
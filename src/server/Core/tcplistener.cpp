@@ -0,0 +1,107 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include "global.h"
+#include "tcplistener.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+TcpListener::TcpListener(QObject *parent) : QTcpServer(parent)
+{
+}
+
+TcpListener::~TcpListener()
+{
+	qDebug() << "~TcpListener";
+}
+
+bool TcpListener::IsReusePortSupported()
+{
+#ifdef Q_OS_LINUX
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool TcpListener::ListenReusePort(const QHostAddress & address, quint16 port)
+{
+#ifdef Q_OS_LINUX
+	const bool bIPv6 = address.protocol() == QAbstractSocket::IPv6Protocol;
+
+	int fd = ::socket(bIPv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		qCritical() << "Can't create listening socket. Reason =" << strerror(errno);
+		return false;
+	}
+
+	// Option must be set before bind, QTcpServer::listen can't do it
+	int enable = 1;
+	if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0 ||
+		::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+	{
+		qCritical() << "Can't set SO_REUSEPORT. Reason =" << strerror(errno);
+		::close(fd);
+		return false;
+	}
+
+	int result = -1;
+
+	if (bIPv6)
+	{
+		sockaddr_in6 addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin6_family = AF_INET6;
+		addr.sin6_port = htons(port);
+
+		Q_IPV6ADDR ip = address.toIPv6Address();
+		memcpy(&addr.sin6_addr, &ip, sizeof(addr.sin6_addr));
+
+		result = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+	}
+	else
+	{
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(address.toIPv4Address());
+
+		result = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+	}
+
+	if (result < 0 || ::listen(fd, SOMAXCONN) < 0)
+	{
+		qCritical() << "Can't listen on port" << port << ". Reason =" << strerror(errno);
+		::close(fd);
+		return false;
+	}
+
+	if (!setSocketDescriptor(fd))
+	{
+		qCritical() << "Can't use listening socket. Reason =" << errorString();
+		::close(fd);
+		return false;
+	}
+
+	return true;
+#else
+	Q_UNUSED(address);
+	Q_UNUSED(port);
+
+	qWarning() << "SO_REUSEPORT listeners not supported on this platform";
+	return false;
+#endif
+}
+
+void TcpListener::incomingConnection(qintptr socketDescriptor)
+{
+	emit incoming(socketDescriptor);
+}
@@ -0,0 +1,30 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef TCPLISTENER_H
+#define TCPLISTENER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHostAddress>
+
+// Listening socket owned by one connection thread.
+// With SO_REUSEPORT every thread bind same address and port, kernel spread new
+// connections between them, so accepted descriptor never leave thread where it was accepted.
+class TcpListener : public QTcpServer
+{
+	Q_OBJECT
+public:
+	explicit TcpListener(QObject *parent = nullptr);
+	~TcpListener();
+public:
+	// Linux only, on other systems always return false
+	bool              ListenReusePort(const QHostAddress &address, quint16 port);
+	static bool       IsReusePortSupported();
+private:
+	virtual void      incomingConnection(qintptr socketDescriptor);
+signals:
+	void              incoming(qintptr socketDescriptor);
+};
+
+#endif // TCPLISTENER_H
@@ -3,19 +3,13 @@
 
 #pragma once
 
-#include <FireNetCore/IFireNetTcpPacket.h>
+#include <FireNetCore/IFireNetTcpPacketWriter.h>
 
-class CTcpPacket : public IFireNetTcpPacket
+class CTcpPacket : public CFireNetTcpPacketWriter
 {
 public:
 	CTcpPacket::CTcpPacket(EFireNetTcpPacketType type);
 	CTcpPacket::CTcpPacket(const char* data);
-public:
-	virtual void               WriteString(const std::string &value) override;
-	virtual void               WriteInt(int value) override;
-	virtual void               WriteBool(bool value) override;
-	virtual void               WriteFloat(float value) override;
-	virtual void               WriteDouble(double value) override;
 public:
 	virtual const char*        ReadString() override;
 	virtual int                ReadInt() override;
@@ -25,6 +19,5 @@ public:
 public:
 	virtual const char*        toString() override;
 private:
-	virtual void               GenerateSession() override;
 	virtual void               ReadPacket() override;
 };
\ No newline at end of file
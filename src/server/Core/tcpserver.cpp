@@ -1,23 +1,41 @@
 // Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
 // License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
 
+#include <QTimer>
+
 #include "global.h"
 #include "tcpserver.h"
 #include "tcpthread.h"
+#include "tcplistener.h"
+#include "remoteserver.h"
 
 #include "Workers/Databases/dbworker.h"
+#include "Workers/Databases/profilecache.h"
+#include "Workers/Packets/clientquerys.h"
 #include "Tools/settings.h"
 
 TcpServer::TcpServer(QObject *parent) : QTcpServer(parent),
-	bClosed(false)
+	bClosed(false),
+	bReusePort(false)
 {
 	m_maxThreads = 0;
 	m_maxConnections = 0;
 	m_connectionTimeout = 0;
 
 	m_Time = QTime::currentTime();
+	m_PresenceTime = QTime::currentTime();
 	m_InputPacketsCount = 0;
 	m_OutputPacketsCount = 0;
+	m_InputBytes = 0;
+	m_OutputBytes = 0;
+	m_BadPacketsCount = 0;
+	m_RateLimitedCount = 0;
+	m_HandshakesRejected = 0;
+
+	qRegisterMetaType<TcpThread*>("TcpThread*");
+	qRegisterMetaType<TProfileModifier>("TProfileModifier");
+
+	ClientQuerys::RegisterHandlers(m_Dispatcher);
 }
 
 TcpServer::~TcpServer()
@@ -38,17 +56,52 @@ void TcpServer::Update()
 	{
 		m_Time = QTime::currentTime();
 		CalculateStatistic();
+		Rebalance();
+
+		m_IpLimiter.RemoveFull();
+		m_Chat.RemoveIdle(gEnv->pSettings->GetVariable("chat_channel_ttl").toInt() * 1000);
 	}
-}
 
-void TcpServer::MessageReceived()
-{
-	m_InputPacketsCount++;
+	// Status changes collected while interval, so friends get them by one packet
+	if (m_PresenceTime.elapsed() >= gEnv->pSettings->GetVariable("presence_update_interval").toInt())
+	{
+		m_PresenceTime = QTime::currentTime();
+		SendPresenceUpdates();
+	}
 }
 
-void TcpServer::MessageSended()
+void TcpServer::SendPresenceUpdates()
 {
-	m_OutputPacketsCount++;
+	// Packet size is limited, big updates sent by parts
+	const int maxStatusesInPacket = 32;
+
+	QHash<int, QVector<TPresenceStatus>> updates = m_Presence.TakeUpdates();
+
+	for (auto it = updates.constBegin(); it != updates.constEnd(); ++it)
+	{
+		SConnectionRoute route = m_Clients.GetRouteByUid(it.key());
+		if (!route.IsValid())
+			continue;
+
+		const QVector<TPresenceStatus> &statuses = it.value();
+
+		for (int start = 0; start < statuses.size(); start += maxStatusesInPacket)
+		{
+			const int count = qMin(maxStatusesInPacket, statuses.size() - start);
+
+			CTcpPacket packet(EFireNetTcpPacketType::ServerMessage);
+			packet.WriteServerMessage(EFireNetTcpSMessage::FriendsStatus);
+			packet.WriteInt(count);
+
+			for (int i = start; i < start + count; ++i)
+			{
+				packet.WriteInt(statuses.at(i).first);
+				packet.WriteInt(statuses.at(i).second);
+			}
+
+			sendMessageToClient(route, packet);
+		}
+	}
 }
 
 void TcpServer::SetMaxThreads(int maximum)
@@ -77,23 +130,44 @@ bool TcpServer::Listen(const QHostAddress & address, quint16 port)
 		return false;
 	}
 
-	if (!QTcpServer::listen(address, port))
+	m_IpLimiter.SetLimits(gEnv->pSettings->GetVariable("net_rate_limit_ip_rate").toDouble(),
+		gEnv->pSettings->GetVariable("net_rate_limit_ip_burst").toDouble());
+
+	m_Chat.SetLimits(gEnv->pSettings->GetVariable("chat_channel_rate").toDouble(),
+		gEnv->pSettings->GetVariable("chat_channel_burst").toDouble(),
+		gEnv->pSettings->GetVariable("chat_history_size").toInt());
+	m_Chat.SetOpenGroups(gEnv->pSettings->GetVariable("chat_open_group_channels").toBool());
+
+	bReusePort = gEnv->pSettings->GetVariable("net_reuseport").toBool();
+
+	if (bReusePort && !TcpListener::IsReusePortSupported())
+	{
+		qWarning() << "SO_REUSEPORT not supported on this platform, using single listener";
+		bReusePort = false;
+	}
+
+	// With SO_REUSEPORT every thread listen by itself, kernel spread clients between them
+	if (!bReusePort && !QTcpServer::listen(address, port))
 	{
 		qCritical() << errorString();
 		return false;
 	}
 
-	qInfo() << "Start listing on port :" << port;
+	qInfo() << "Start listing on port :" << port << (bReusePort ? "by every thread" : "");
 
-	Start();
+	Start(address, port);
 
 	gEnv->m_ServerStatus.m_MainServerStatus = "online";
 
 	return true;
 }
 
-void TcpServer::Start()
+void TcpServer::Start(const QHostAddress &address, quint16 port)
 {
+	// Every runnable hold pool thread until server stop
+	if (QThreadPool::globalInstance()->maxThreadCount() < m_maxThreads)
+		QThreadPool::globalInstance()->setMaxThreadCount(m_maxThreads);
+
 	for (int i = 0; i < m_maxThreads; i++)
 	{
 		TcpThread *runnable = CreateRunnable();
@@ -103,36 +177,179 @@ void TcpServer::Start()
 			return;
 		}
 
+		runnable->SetIndex(i);
+
+		if (bReusePort)
+			runnable->SetListenAddress(address, port);
+
 		StartRunnable(runnable);
 	}
 }
 
+void TcpServer::CollectCounters(STrafficCounters * counters)
+{
+	// Take values and reset counters, connections continue counting from zero
+	m_InputPacketsCount += counters->inputPackets.fetchAndStoreRelaxed(0);
+	m_OutputPacketsCount += counters->outputPackets.fetchAndStoreRelaxed(0);
+	m_InputBytes += counters->inputBytes.fetchAndStoreRelaxed(0);
+	m_OutputBytes += counters->outputBytes.fetchAndStoreRelaxed(0);
+	m_BadPacketsCount += counters->badPackets.fetchAndStoreRelaxed(0);
+	m_RateLimitedCount += counters->rateLimited.fetchAndStoreRelaxed(0);
+	m_HandshakesRejected += counters->handshakesRejected.fetchAndStoreRelaxed(0);
+
+	for (int i = 0; i < STrafficCounters::QUERY_TYPES; ++i)
+		m_QueriesCount[i].fetchAndAddRelaxed(counters->queries[i].fetchAndStoreRelaxed(0));
+}
+
 void TcpServer::CalculateStatistic()
 {
+	{
+		QReadLocker locker(&m_ThreadsLock);
+
+		for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
+		{
+			if (*it)
+				CollectCounters((*it)->GetCounters());
+		}
+	}
+
+	if (gEnv->pRemoteServer)
+		CollectCounters(gEnv->pRemoteServer->GetCounters());
+
 	// Update input packet count + speed
 	gEnv->m_InputPacketsCount += m_InputPacketsCount;
-	gEnv->m_InputSpeed = m_InputPacketsCount;
+	gEnv->m_InputSpeed = static_cast<int>(m_InputPacketsCount);
 
 	// Update max input speed
-	if (m_InputPacketsCount > gEnv->m_InputMaxSpeed)
-		gEnv->m_InputMaxSpeed = m_InputPacketsCount;
+	if (m_InputPacketsCount > gEnv->m_InputMaxSpeed.load())
+		gEnv->m_InputMaxSpeed = static_cast<int>(m_InputPacketsCount);
 
 	// Update output packet count + speed
 	gEnv->m_OutputPacketsCount += m_OutputPacketsCount;
-	gEnv->m_OutputSpeed = m_OutputPacketsCount;
+	gEnv->m_OutputSpeed = static_cast<int>(m_OutputPacketsCount);
 
 	// Update max output speed
-	if (m_OutputPacketsCount > gEnv->m_OutputMaxSpeed)
-		gEnv->m_OutputMaxSpeed = m_OutputPacketsCount;
+	if (m_OutputPacketsCount > gEnv->m_OutputMaxSpeed.load())
+		gEnv->m_OutputMaxSpeed = static_cast<int>(m_OutputPacketsCount);
 
 	// Update max clients count
 	int m_ClientCount = GetClientCount();
-	if (m_ClientCount > gEnv->m_MaxClientCount)
+	if (m_ClientCount > gEnv->m_MaxClientCount.load())
 		gEnv->m_MaxClientCount = m_ClientCount;
 
+	// Update traffic + errors
+	gEnv->m_InputBytes += m_InputBytes;
+	gEnv->m_InputBytesSpeed = m_InputBytes;
+	gEnv->m_OutputBytes += m_OutputBytes;
+	gEnv->m_OutputBytesSpeed = m_OutputBytes;
+	gEnv->m_BadPacketsCount += m_BadPacketsCount;
+	gEnv->m_RateLimitedCount += m_RateLimitedCount;
+	gEnv->m_HandshakesRejected += m_HandshakesRejected;
+
 	// Refresh local counters
 	m_InputPacketsCount = 0;
 	m_OutputPacketsCount = 0;
+	m_InputBytes = 0;
+	m_OutputBytes = 0;
+	m_BadPacketsCount = 0;
+	m_RateLimitedCount = 0;
+	m_HandshakesRejected = 0;
+}
+
+QStringList TcpServer::GetQueriesStats()
+{
+	static const char* names[STrafficCounters::QUERY_TYPES] =
+	{
+		"Login", "Register", "CreateProfile", "GetProfile", "GetShop", "BuyItem", "RemoveItem",
+		"SendInvite", "DeclineInvite", "AcceptInvite", "RemoveFriend", "GetServer", "SendChatMsg",
+		"AdminLogin", "AdminCommand", "RegisterServer", "UpdateServer", "UpdateProfile",
+		"JoinChatChannel", "LeaveChatChannel", "SetStatus", "SetChatMember"
+	};
+
+	QStringList stats;
+
+	for (int i = 0; i < STrafficCounters::QUERY_TYPES; ++i)
+	{
+		qint64 count = m_QueriesCount[i].load();
+
+		if (count > 0)
+			stats.push_back(QString(names[i]) + " : " + QString::number(count));
+	}
+
+	return stats;
+}
+
+void TcpServer::Rebalance()
+{
+	int threshold = gEnv->pSettings->GetVariable("sv_rebalance_threshold").toInt();
+	int maxMoves = gEnv->pSettings->GetVariable("sv_rebalance_max_connections").toInt();
+
+	QReadLocker locker(&m_ThreadsLock);
+
+	if (threshold <= 0 || maxMoves <= 0 || m_threads.size() < 2)
+		return;
+
+	TcpThread* hot = nullptr;
+	TcpThread* cold = nullptr;
+	int hotLoad = 0;
+	int coldLoad = 0;
+
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
+	{
+		if (!(*it) || !(*it)->GetThread())
+			continue;
+
+		int load = (*it)->GetLoad();
+
+		if (!hot || load > hotLoad)
+		{
+			hot = *it;
+			hotLoad = load;
+		}
+		if (!cold || load < coldLoad)
+		{
+			cold = *it;
+			coldLoad = load;
+		}
+	}
+
+	if (!hot || !cold || hot == cold)
+		return;
+
+	// Same metric as for choosing threads : connections with lag weighted by sv_thread_lag_weight
+	int diff = hotLoad - coldLoad;
+
+	if (diff <= threshold)
+		return;
+
+	// Lag only choose threads. Short stall can't move more than half of connections difference,
+	// and limit per tick keep connections from jumping back and forth
+	int count = qMin((hot->Count() - cold->Count()) / 2, maxMoves);
+
+	if (count > 0)
+	{
+		qDebug() << "Rebalancing" << count << "connections from" << hot << "to" << cold;
+		hot->MigrateConnections(cold, count);
+	}
+}
+
+QStringList TcpServer::GetThreadsStats()
+{
+	QStringList stats;
+
+	QReadLocker locker(&m_ThreadsLock);
+
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
+	{
+		if (!(*it))
+			continue;
+
+		stats.push_back("Connections: " + QString::number((*it)->Count()) +
+			" Handshakes: " + QString::number((*it)->GetHandshakes()) +
+			" Lag: " + QString::number((*it)->GetLag()) + " ms");
+	}
+
+	return stats;
 }
 
 TcpThread * TcpServer::CreateRunnable()
@@ -157,7 +374,10 @@ void TcpServer::StartRunnable(TcpThread * runnable)
 
 	runnable->setAutoDelete(false);
 
-	m_threads.append(runnable);
+	{
+		QWriteLocker locker(&m_ThreadsLock);
+		m_threads.append(runnable);
+	}
 
 	connect(this, &TcpServer::closing, runnable, &TcpThread::closing, Qt::QueuedConnection);
 	connect(runnable, &TcpThread::started, this, &TcpServer::started, Qt::QueuedConnection);
@@ -175,33 +395,46 @@ void TcpServer::incomingConnection(qintptr socketDescriptor)
 	{
 		qCritical() << "Can't accept new client, because server have limit" << m_maxConnections;
 		Reject(socketDescriptor);
+		return;
 	}
 
-	int previous = 0;
-	TcpThread *runnable = m_threads.at(0);
-
-	foreach(TcpThread *item, m_threads)
-	{
-		int count = item->Count();
-
-		if (count == 0 || count < previous)
-		{
-			runnable = item;
-			break;
-		}
-
-		previous = count;
-	}
+	TcpThread *runnable = SelectRunnable();
 
 	if (!runnable)
 	{
 		qWarning() << "Could not find runable!";
+		Reject(socketDescriptor);
 		return;
 	}
 
 	Accept(socketDescriptor, runnable);
 }
 
+TcpThread * TcpServer::SelectRunnable()
+{
+	// Thread count is small, so full scan is cheap and always finds least loaded thread
+	TcpThread *runnable = nullptr;
+	int minLoad = 0;
+
+	QReadLocker locker(&m_ThreadsLock);
+
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
+	{
+		if (!(*it) || !(*it)->GetThread())
+			continue;
+
+		int load = (*it)->GetLoad();
+
+		if (!runnable || load < minLoad)
+		{
+			runnable = *it;
+			minLoad = load;
+		}
+	}
+
+	return runnable;
+}
+
 void TcpServer::Accept(qintptr handle, TcpThread * runnable)
 {
 	qDebug() << "Accepting" << handle << "on" << runnable;
@@ -229,10 +462,33 @@ void TcpServer::finished()
 
 	qDebug() << runnable << "has finished, removing from list";
 
-	m_threads.removeAll(runnable);
+	bool bAllFinished = true;
+
+	{
+		QWriteLocker locker(&m_ThreadsLock);
+
+		// Other runnables keep their indexes, routes point to them
+		const int index = m_threads.indexOf(runnable);
+		if (index >= 0)
+			m_threads[index] = nullptr;
+
+		for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
+		{
+			if (*it)
+			{
+				bAllFinished = false;
+				break;
+			}
+		}
+
+		if (bAllFinished)
+			m_threads.clear();
+	}
+
+	// Workers take pointers only under lock, so runnable not used after it removed
 	runnable->deleteLater();
 
-	if (m_threads.size() <= 0)
+	if (bAllFinished)
 	{
 		bClosed = true;
 		//gEnv->isReadyToClose = true;
@@ -256,202 +512,224 @@ void TcpServer::started()
 
 void TcpServer::AddNewClient(SClient &client)
 {
-	QMutexLocker locker(&m_Mutex);
+	m_Clients.Add(client);
+}
 
-	if (client.socket == nullptr)
-	{
-		qWarning() << "Can't add client. Client socket = nullptr";
-		return;
-	}
+void TcpServer::RemoveClient(SClient &client)
+{
+	m_Clients.Remove(client.socket);
+}
 
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
+void TcpServer::UpdateClient(SClient* client)
+{
+	if (client == nullptr)
 	{
-		if (it->socket == client.socket)
-		{
-			qWarning() << "Can't add client" << client.socket << ". Client alredy added";
-			return;
-		}
+		qWarning() << "Can't update client. Client = nullptr";
+		return;
 	}
 
-	qDebug() << "Adding new client" << client.socket;
-	m_Clients.push_back(client);
+	m_Clients.Update(*client);
 }
 
-void TcpServer::RemoveClient(SClient &client)
+bool TcpServer::UpdateProfile(const SProfile &profile, int fields)
 {
-	QMutexLocker locker(&m_Mutex);
+	SProfilePtr onlineProfile = m_Clients.GetProfileByUid(profile.uid);
 
-	if (!client.socket)
+	if (!onlineProfile)
 	{
-		qWarning() << "Can't remove client. Client socket = nullptr";
-		return;
+		qDebug() << "Profile" << profile.nickname << "not found.";
+		return false;
 	}
 
-	if (m_Clients.size() > 0)
+	// First update profile in DB
+	if (!gEnv->pDBWorker->GetProfileCache()->Update(profile, fields))
 	{
-		for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-		{
-			if (it->socket == client.socket)
-			{
-				qDebug() << "Removing client" << client.socket;
-
-				m_Clients.erase(it);
-				return;
-			}
-		}
+		qWarning() << "Failed update" << profile.nickname << "profile in DB!";
+		return false;
 	}
 
-	qWarning() << "Can't remove client. Client not found";
+	// Other fields of online profile can be newer than ours
+	ModifyOnlineProfile(profile.uid, [profile, fields](SProfile &onlineProfile)
+	{
+		ProfileCache::CopyFields(profile, onlineProfile, fields);
+	});
+
+	qDebug() << "Profile" << profile.nickname << "updated";
+	return true;
 }
 
-void TcpServer::UpdateClient(SClient* client)
+bool TcpServer::ModifyOnlineProfile(int uid, const std::function<void(SProfile&)> &func)
+{
+	// Profile owned by connection thread, so change is posted there
+	SMailboxMessage message;
+	message.route = m_Clients.GetRouteByUid(uid);
+	message.uid = uid;
+	message.modifier = func;
+
+	return PostToConnection(message);
+}
+
+void TcpServer::ForgetConnection(TcpConnection * connection)
 {
-	QMutexLocker locker(&m_Mutex);
+	QReadLocker locker(&m_ThreadsLock);
 
-	if (client->socket == nullptr)
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
 	{
-		qWarning() << "Can't update client. Client socket = nullptr";
-		return;
+		if ((*it) && (*it)->Forget(connection))
+			return;
 	}
+}
 
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-	{
-		if (it->socket == client->socket)
-		{
-			if (client->profile != nullptr)
-			{
-				it->profile = client->profile;
-				it->status = client->status;
+TcpThread * TcpServer::GetRunnable(QThread * thread)
+{
+	if (!thread)
+		return nullptr;
 
-				qDebug() << "Client" << it->socket << "updated.";
-				return;
-			}
-			else
-			{
-				qWarning() << "Can't update client" << it->socket << ". Profile = nullptr";
-				return;
-			}
-		}
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
+	{
+		if ((*it) && (*it)->GetThread() == thread)
+			return *it;
 	}
 
-	qWarning() << "Can't update client. Client" << client->socket << "not found";
+	return nullptr;
 }
 
-bool TcpServer::UpdateProfile(SProfile * profile)
+bool TcpServer::JoinChatChannel(const QString & channel, TcpConnection * connection)
 {
-	QMutexLocker locker(&m_Mutex);
+	if (!connection || ChatService::GetChannelType(channel) == EChatChannelType::Unknown)
+		return false;
+
+	QReadLocker locker(&m_ThreadsLock);
+	TcpThread* runnable = GetRunnable(connection->thread());
 
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
+	if (!runnable)
 	{
-		if (it->profile != nullptr)
-		{
-			if (it->profile->uid == profile->uid)
-			{
-				// First update profile in DB
-				if (gEnv->pDBWorker->UpdateProfile(profile))
-				{
-					it->profile = profile;
-					qDebug() << "Profile" << profile->nickname << "updated";
-					return true;
-				}
-				else
-				{
-					qWarning() << "Failed update" << profile->nickname << "profile in DB!";
-					return false;
-				}
-			}
-		}
+		qWarning() << "Can't join chat channel" << channel << ". Thread of" << connection << "not found";
+		return false;
 	}
 
-	qDebug() << "Profile" << profile->nickname << "not found.";
-	return false;
+	return runnable->Subscribe(channel, connection, gEnv->pSettings->GetVariable("chat_max_channels").toInt());
 }
 
-QStringList TcpServer::GetPlayersList()
+bool TcpServer::LeaveChatChannel(const QString & channel, TcpConnection * connection)
+{
+	QReadLocker locker(&m_ThreadsLock);
+	TcpThread* runnable = connection ? GetRunnable(connection->thread()) : nullptr;
+
+	return runnable ? runnable->Unsubscribe(channel, connection) : false;
+}
+
+bool TcpServer::SetChatMember(const QString & channel, int uid, bool bMember)
+{
+	return m_Chat.SetMember(channel, uid, bMember);
+}
+
+bool TcpServer::IsChatMember(const QString & channel, int uid)
+{
+	return m_Chat.IsMember(channel, uid);
+}
+
+QList<QByteArray> TcpServer::GetChatHistory(const QString & channel)
+{
+	return m_Chat.GetHistory(channel);
+}
+
+qint64 TcpServer::PublishChatMessage(const QString & channel, const QString & sender, const QString & message, TcpConnection * connection)
 {
-	QMutexLocker locker(&m_Mutex);
+	QReadLocker locker(&m_ThreadsLock);
+	TcpThread* runnable = connection ? GetRunnable(connection->thread()) : nullptr;
+
+	if (!runnable || !runnable->IsSubscribed(channel, connection))
+		return -1;
+
+	QByteArray data;
+	qint64 wait = m_Chat.Publish(channel, sender, message, data);
+
+	if (wait != 0)
+		return wait;
 
-	QStringList playerList;
+	const int type = static_cast<int>(EFireNetTcpPacketType::ServerMessage);
 
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
 	{
-		if (it->profile != nullptr)
-		{
-			if (!it->profile->nickname.isEmpty())
-			{
-				playerList.push_back("Uid: " + QString::number(it->profile->uid) +
-					" Nickname: " + it->profile->nickname +
-					" Level: " + QString::number(it->profile->lvl) +
-					" XP: " + QString::number(it->profile->xp));
-			}
-		}
+		if (*it)
+			(*it)->PostChat(channel, data, type);
 	}
 
-	return playerList;
+	return 0;
+}
+
+QStringList TcpServer::GetPlayersList()
+{
+	return m_Clients.GetPlayersList();
 }
 
 int TcpServer::GetClientCount()
 {
-	QMutexLocker locker(&m_Mutex);
-	return m_Clients.size();
+	return m_Clients.Count();
 }
 
-QSslSocket * TcpServer::GetSocketByUid(int uid)
+SConnectionRoute TcpServer::GetRouteByUid(int uid)
 {
-	QMutexLocker locker(&m_Mutex);
+	return m_Clients.GetRouteByUid(uid);
+}
 
-	if (uid <= 0)
-		return nullptr;
+SConnectionRoute TcpServer::GetRouteByNickname(const QString & nickname)
+{
+	return m_Clients.GetRouteByNickname(nickname);
+}
 
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-	{
-		if (it->profile != nullptr)
-		{
-			if (it->profile->uid == uid)
-			{
-				qDebug() << "Socket finded. Return";
-				return it->socket;
-			}
-		}
-	}
+void TcpServer::UpdateRoute(QSslSocket * socket, const SConnectionRoute & route)
+{
+	m_Clients.SetRoute(socket, route);
+}
 
-	qDebug() << "Socket not finded.";
-	return nullptr;
+SProfilePtr TcpServer::GetProfileByUid(int uid)
+{
+	return m_Clients.GetProfileByUid(uid);
 }
 
-SProfile * TcpServer::GetProfileByUid(int uid)
+bool TcpServer::sendMessageToClient(const SConnectionRoute &route, CTcpPacket &packet)
 {
-	QMutexLocker locker(&m_Mutex);
+	if (!route.IsValid())
+		return false;
 
-	if (uid <= 0)
-		return nullptr;
+	// Socket can be used only from thread of his connection
+	const char* packetData = packet.toString();
 
-	for (auto it = m_Clients.begin(); it != m_Clients.end(); ++it)
-	{
-		if (it->profile != nullptr)
-		{
-			if (it->profile->uid == uid)
-			{
-				qDebug() << "Profile finded. Return";
-				return it->profile;
-			}
-		}
-	}
+	SMailboxMessage message;
+	message.route = route;
+	message.data = QByteArray(packetData, static_cast<int>(packet.getLength()));
+	message.type = static_cast<int>(packet.getType());
 
-	qDebug() << "Profile not finded.";
-	return nullptr;
+	return PostToConnection(message);
 }
 
-void TcpServer::sendMessageToClient(QSslSocket* socket, CTcpPacket &packet)
+bool TcpServer::PostToConnection(const SMailboxMessage & message)
 {
-	if (socket)
-		socket->write(packet.toString());
+	if (!message.route.IsValid())
+		return false;
+
+	QReadLocker locker(&m_ThreadsLock);
+
+	if (message.route.thread >= m_threads.size() || !m_threads.at(message.route.thread))
+		return false;
+
+	return m_threads.at(message.route.thread)->Post(message);
 }
 
 void TcpServer::sendGlobalMessage(CTcpPacket &packet)
 {
-	for (auto it = m_threads.begin(); it != m_threads.end(); ++it)
+	// Serialize once, all threads share same buffer
+	const char* packetData = packet.toString();
+	const QByteArray data(packetData, static_cast<int>(packet.getLength()));
+	const int type = static_cast<int>(packet.getType());
+
+	QReadLocker locker(&m_ThreadsLock);
+
+	for (auto it = m_threads.constBegin(); it != m_threads.constEnd(); ++it)
 	{
-		(*it)->SendGlobalMessage(packet);
+		if (*it)
+			(*it)->Broadcast(data, type);
 	}
 }
\ No newline at end of file
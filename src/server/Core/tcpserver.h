@@ -10,10 +10,18 @@
 #include <QThread>
 #include <QThreadPool>
 #include <QEventLoop>
+#include <QReadWriteLock>
 #include <QDebug>
-#include <QMutex>
+
+#include <functional>
 
 #include "tcpthread.h"
+#include "clientregistry.h"
+#include "ratelimiter.h"
+#include "chatservice.h"
+#include "presenceservice.h"
+
+#include "Workers/Packets/querydispatcher.h"
 
 class CTcpPacket;
 
@@ -30,38 +38,70 @@ public:
 	bool              Listen(const QHostAddress &address, quint16 port);
 	void              Clear();
 public:
-	void              sendMessageToClient(QSslSocket* socket, CTcpPacket &packet);
+	// Thread-safe, without locks. Packet written by thread owning the connection
+	bool              sendMessageToClient(const SConnectionRoute &route, CTcpPacket &packet);
+	bool              PostToConnection(const SMailboxMessage &message);
 	void              sendGlobalMessage(CTcpPacket &packet);
 
 	void              AddNewClient(SClient &client);
 	void              RemoveClient(SClient &client);
 	void              UpdateClient(SClient* client);
-	bool              UpdateProfile(SProfile* profile);
+	// Change only given fields, see EProfileField
+	bool              UpdateProfile(const SProfile &profile, int fields);
+	// Change profile of online client on thread of his connection
+	bool              ModifyOnlineProfile(int uid, const std::function<void(SProfile&)> &func);
+	void              ForgetConnection(TcpConnection* connection);
+
+	// Chat channels. Join and leave only from thread of connection
+	bool              JoinChatChannel(const QString &channel, TcpConnection* connection);
+	bool              LeaveChatChannel(const QString &channel, TcpConnection* connection);
+	// Clan, party and match channels members, from any thread
+	bool              SetChatMember(const QString &channel, int uid, bool bMember);
+	bool              IsChatMember(const QString &channel, int uid);
+	// Last messages of channel for late joiners, oldest first
+	QList<QByteArray> GetChatHistory(const QString &channel);
+	// Return 0 if message published, -1 if sender can't write to channel, otherwise time in ms until channel accept messages
+	qint64            PublishChatMessage(const QString &channel, const QString &sender, const QString &message, TcpConnection* connection);
 
 	QStringList       GetPlayersList();
-	QSslSocket*       GetSocketByUid(int uid);
-	SProfile*         GetProfileByUid(int uid);
+	SConnectionRoute  GetRouteByUid(int uid);
+	SConnectionRoute  GetRouteByNickname(const QString &nickname);
+	void              UpdateRoute(QSslSocket* socket, const SConnectionRoute &route);
+	SProfilePtr       GetProfileByUid(int uid);
 
 	int               GetClientCount();
 	int               GetMaxClientCount() { return m_maxConnections; }
+	QStringList       GetThreadsStats();
+	QStringList       GetQueriesStats();
+
+	// Rate limit buckets shared by all clients from one IP address
+	RateLimiter*      GetIpLimiter() { return &m_IpLimiter; }
+	// Online status of players, changes sent to friends by Update
+	PresenceService*  GetPresence() { return &m_Presence; }
+	// Client query handlers, read-only after server start
+	const QueryDispatcher* GetDispatcher() const { return &m_Dispatcher; }
 
 	bool              IsClosed() { return bClosed; }
 private:
 	virtual void      incomingConnection(qintptr socketDescriptor);
 	TcpThread*        CreateRunnable();
+	TcpThread*        SelectRunnable();
 	void              StartRunnable(TcpThread *runnable);
 	void              Reject(qintptr handle);
 	void              Accept(qintptr handle, TcpThread *runnable);
-	void              Start();
+	void              Start(const QHostAddress &address, quint16 port);
+	// Runnable with event loop on given thread, m_ThreadsLock must be locked by caller
+	TcpThread*        GetRunnable(QThread* thread);
 private:
 	void              CalculateStatistic();
+	void              CollectCounters(STrafficCounters* counters);
+	void              Rebalance();
+	void              SendPresenceUpdates();
 public slots:
 	void              started();
 	void              finished();
 	void              stop();
 	void              Update();
-	void              MessageReceived();
-	void              MessageSended();
 signals:
 	void              connecting(qintptr handle, TcpThread *runnable, TcpConnection* connection);
 	void              closing();
@@ -70,15 +110,29 @@ private:
 	int               m_maxConnections;
 	int               m_connectionTimeout;
 
-	QVector<SClient>  m_Clients;
+	ClientRegistry    m_Clients;
+	RateLimiter       m_IpLimiter;
+	ChatService       m_Chat;
+	PresenceService   m_Presence;
+	QueryDispatcher   m_Dispatcher;
+	// Index in list is route thread, so finished runnables are replaced by nullptr until all finished.
+	// Workers read list, only server thread change it
 	QList<TcpThread*> m_threads;
-	QMutex            m_Mutex;
+	QReadWriteLock    m_ThreadsLock;
 
 	// Statisctic
 	QTime             m_Time;
-	int               m_InputPacketsCount;
-	int               m_OutputPacketsCount;
+	QTime             m_PresenceTime;
+	qint64            m_InputPacketsCount;
+	qint64            m_OutputPacketsCount;
+	qint64            m_InputBytes;
+	qint64            m_OutputBytes;
+	int               m_BadPacketsCount;
+	int               m_RateLimitedCount;
+	int               m_HandshakesRejected;
+	QAtomicInteger<qint64> m_QueriesCount[STrafficCounters::QUERY_TYPES];
 
 	bool			  bClosed;
+	bool              bReusePort;
 };
 #endif // TCPSERVER_H
@@ -2,14 +2,31 @@
 // License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
 
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QWriteLocker>
 
 #include "global.h"
 #include "tcpthread.h"
 #include "tcpserver.h"
+#include "tcplistener.h"
+#include "chatservice.h"
 #include "Tools/settings.h"
 
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 TcpThread::TcpThread(QObject *parent) : QObject(parent),
-	m_loop(nullptr)
+	m_loop(nullptr),
+	m_MigrateCursor(0),
+	m_Mailbox(nullptr),
+	m_Index(0),
+	m_ListenPort(0),
+	m_Thread(nullptr),
+	m_Lag(0),
+	m_Handshakes(0),
+	bChatFlushScheduled(false)
 {
 	Q_UNUSED(parent);
 }
@@ -18,6 +35,7 @@ TcpThread::~TcpThread()
 {
 	qDebug() << "~TcpThread";
 	SAFE_RELEASE(m_loop);
+	SAFE_RELEASE(m_Mailbox);
 	m_connections.clear();
 }
 
@@ -26,23 +44,421 @@ void TcpThread::run()
 	//Make an event loop to keep this alive on the thread
 	m_loop = new QEventLoop();
 	connect(this, &TcpThread::quit, m_loop, &QEventLoop::quit);
+
+	// Measure how late timer events are processed, it show how busy this thread is
+	const int lagInterval = 100;
+	QElapsedTimer lagTime;
+	QTimer lagTimer;
+
+	connect(&lagTimer, &QTimer::timeout, [this, &lagTime, lagInterval]()
+	{
+		int lag = qMax(0, static_cast<int>(lagTime.restart()) - lagInterval);
+		m_Lag.store((m_Lag.load() * 3 + lag) / 4);
+	});
+
+	lagTime.start();
+	lagTimer.start(lagInterval);
+
+	if (gEnv->pSettings->GetVariable("sv_thread_affinity").toBool())
+		PinToCore();
+
+	// Own listener, accepted clients stay on this thread
+	TcpListener listener;
+
+	if (m_ListenPort > 0)
+	{
+		connect(&listener, &TcpListener::incoming, &listener, [this](qintptr handle)
+		{
+			incoming(handle);
+		});
+
+		if (listener.ListenReusePort(m_ListenAddress, m_ListenPort))
+			qInfo() << this << "listening on port" << m_ListenPort << "with SO_REUSEPORT";
+		else
+			qCritical() << this << "can't listen on port" << m_ListenPort;
+	}
+
+	// Created on thread of event loop, so it's drained here
+	m_Mailbox = new ConnectionMailbox([this](const SMailboxMessage &message) { Deliver(message); });
+
+	// Published after mailbox created, Post check thread before use mailbox
+	m_Thread.storeRelease(QThread::currentThread());
+	emit started();
+
 	m_loop->exec();
 
+	listener.close();
+
+	m_Thread.store(nullptr);
+	lagTimer.stop();
+
 	qDebug() << this << "finished on" << QThread::currentThread();
 	emit finished();
 }
 
+void TcpThread::SetListenAddress(const QHostAddress & address, quint16 port)
+{
+	m_ListenAddress = address;
+	m_ListenPort = port;
+}
+
+void TcpThread::PinToCore()
+{
+#ifdef Q_OS_LINUX
+	int cores = QThread::idealThreadCount();
+	int core = cores > 0 ? m_Index % cores : 0;
+
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(core, &cpuset);
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+		qDebug() << this << "pinned to core" << core;
+	else
+		qWarning() << this << "can't be pinned to core" << core;
+#else
+	qWarning() << "Thread affinity not supported on this platform";
+#endif
+}
+
 int TcpThread::Count()
 {
 	QReadLocker locker(&m_lock);
 	return m_connections.count();
 }
 
-void TcpThread::SendGlobalMessage(CTcpPacket & packet)
+int TcpThread::GetLoad()
+{
+	int lagWeight = gEnv->pSettings->GetVariable("sv_thread_lag_weight").toInt();
+
+	return Count() + GetHandshakes() + GetLag() * lagWeight;
+}
+
+void TcpThread::Broadcast(const QByteArray & data, int type)
 {
-	for (auto it = m_connections.begin(); it != m_connections.end(); ++it)
+	if (!GetThread())
+		return;
+
+	// One event per thread, connections get message on thread of event loop
+	QTimer::singleShot(0, m_loop, [this, data, type]()
+	{
+		QThread* currentThread = QThread::currentThread();
+		QReadLocker locker(&m_lock);
+
+		for (auto it = m_connections.begin(); it != m_connections.end(); ++it)
+		{
+			// Connection can be on the way to other thread
+			if ((*it)->thread() == currentThread)
+				(*it)->SendData(data, type);
+			else
+				QMetaObject::invokeMethod(*it, "SendData", Qt::QueuedConnection, Q_ARG(QByteArray, data), Q_ARG(int, type));
+		}
+	});
+}
+
+void TcpThread::MigrateConnections(TcpThread * target, int count)
+{
+	if (!target || target == this || count <= 0)
+		return;
+
+	QReadLocker locker(&m_lock);
+
+	if (m_connections.isEmpty())
+		return;
+
+	count = qMin(count, m_connections.size());
+
+	// Start from other connections every time, busy ones refuse to move
+	for (int i = 0; i < count; ++i)
 	{
-		(*it)->SendMessage(packet);
+		m_MigrateCursor = (m_MigrateCursor + 1) % m_connections.size();
+		TcpConnection* connection = m_connections.at(m_MigrateCursor);
+
+		QMetaObject::invokeMethod(connection, "migrate", Qt::QueuedConnection, Q_ARG(TcpThread*, target));
+	}
+}
+
+SConnectionRoute TcpThread::Adopt(TcpConnection * connection)
+{
+	SConnectionRoute route;
+
+	{
+		QWriteLocker locker(&m_lock);
+		m_connections.append(connection);
+		route = AttachSlot(connection);
+	}
+
+	AddSignals(connection);
+
+	return route;
+}
+
+bool TcpThread::Forget(TcpConnection * connection, const SConnectionRoute &forward)
+{
+	bool removed = false;
+
+	{
+		QWriteLocker locker(&m_lock);
+		removed = m_connections.removeAll(connection) > 0;
+		DetachSlot(connection, forward);
+	}
+
+	TakeChannels(connection);
+
+	return removed;
+}
+
+SConnectionRoute TcpThread::AttachSlot(TcpConnection * connection)
+{
+	int index = -1;
+
+	if (!m_FreeSlots.isEmpty())
+	{
+		index = m_FreeSlots.dequeue();
+	}
+	else
+	{
+		index = m_Slots.size();
+		m_Slots.push_back(SSlot());
+	}
+
+	SSlot &slot = m_Slots[index];
+	slot.connection = connection;
+	slot.generation++;
+	slot.forward = SConnectionRoute();
+
+	m_SlotByConnection.insert(connection, index);
+
+	SConnectionRoute route;
+	route.thread = m_Index;
+	route.slot = index;
+	route.generation = slot.generation;
+
+	return route;
+}
+
+void TcpThread::DetachSlot(TcpConnection * connection, const SConnectionRoute & forward)
+{
+	auto it = m_SlotByConnection.find(connection);
+	if (it == m_SlotByConnection.end())
+		return;
+
+	SSlot &slot = m_Slots[it.value()];
+	slot.connection = nullptr;
+	slot.forward = forward;
+
+	m_FreeSlots.enqueue(it.value());
+	m_SlotByConnection.erase(it);
+}
+
+bool TcpThread::Post(const SMailboxMessage & message)
+{
+	if (!m_Thread.loadAcquire() || message.route.thread != m_Index)
+		return false;
+
+	m_Mailbox->Post(message);
+	return true;
+}
+
+void TcpThread::Deliver(const SMailboxMessage & message)
+{
+	SConnectionRoute forward;
+
+	{
+		QReadLocker locker(&m_lock);
+
+		const int index = message.route.slot;
+
+		if (index < 0 || index >= m_Slots.size() || m_Slots.at(index).generation != message.route.generation)
+		{
+			qDebug() << "Connection" << index << "on" << this << "closed. Message dropped";
+			return;
+		}
+
+		const SSlot &slot = m_Slots.at(index);
+		TcpConnection* connection = slot.connection;
+
+		if (connection)
+		{
+			if (connection->thread() == QThread::currentThread())
+			{
+				if (message.modifier)
+					connection->ModifyProfile(message.uid, message.modifier);
+				else
+					connection->SendData(message.data, message.type);
+			}
+			// Connection can be on the way to other thread
+			else if (message.modifier)
+			{
+				TProfileModifier modifier = message.modifier;
+				QMetaObject::invokeMethod(connection, "ModifyProfile", Qt::QueuedConnection, Q_ARG(int, message.uid), Q_ARG(TProfileModifier, modifier));
+			}
+			else
+			{
+				QMetaObject::invokeMethod(connection, "SendData", Qt::QueuedConnection, Q_ARG(QByteArray, message.data), Q_ARG(int, message.type));
+			}
+
+			return;
+		}
+
+		forward = slot.forward;
+	}
+
+	// Connection moved to other thread, message follow it
+	if (forward.IsValid())
+	{
+		SMailboxMessage forwarded = message;
+		forwarded.route = forward;
+		gEnv->pServer->PostToConnection(forwarded);
+	}
+}
+
+bool TcpThread::Subscribe(const QString & channel, TcpConnection * connection, int maxChannels)
+{
+	if (!connection || channel == ChatService::GLOBAL_CHANNEL)
+		return connection != nullptr;
+
+	QMutexLocker locker(&m_ChatLock);
+
+	QStringList &channels = m_ChatChannels[connection];
+
+	if (channels.contains(channel))
+		return true;
+
+	if (maxChannels > 0 && channels.size() >= maxChannels)
+	{
+		qWarning() << connection << "can't join chat channel" << channel << ". Too many channels";
+		return false;
+	}
+
+	channels.push_back(channel);
+	m_ChatSubscribers[channel].push_back(connection);
+
+	return true;
+}
+
+bool TcpThread::Unsubscribe(const QString & channel, TcpConnection * connection)
+{
+	QMutexLocker locker(&m_ChatLock);
+
+	auto it = m_ChatChannels.find(connection);
+	if (it == m_ChatChannels.end() || !it->removeOne(channel))
+		return false;
+
+	if (it->isEmpty())
+		m_ChatChannels.erase(it);
+
+	auto subscribers = m_ChatSubscribers.find(channel);
+	if (subscribers != m_ChatSubscribers.end())
+	{
+		subscribers->removeOne(connection);
+
+		if (subscribers->isEmpty())
+			m_ChatSubscribers.erase(subscribers);
+	}
+
+	return true;
+}
+
+bool TcpThread::IsSubscribed(const QString & channel, TcpConnection * connection)
+{
+	if (channel == ChatService::GLOBAL_CHANNEL)
+		return true;
+
+	QMutexLocker locker(&m_ChatLock);
+
+	auto it = m_ChatChannels.constFind(connection);
+	return it != m_ChatChannels.constEnd() && it->contains(channel);
+}
+
+QStringList TcpThread::TakeChannels(TcpConnection * connection)
+{
+	QMutexLocker locker(&m_ChatLock);
+
+	QStringList channels = m_ChatChannels.take(connection);
+
+	for (auto it = channels.begin(); it != channels.end(); ++it)
+	{
+		auto subscribers = m_ChatSubscribers.find(*it);
+		if (subscribers == m_ChatSubscribers.end())
+			continue;
+
+		subscribers->removeOne(connection);
+
+		if (subscribers->isEmpty())
+			m_ChatSubscribers.erase(subscribers);
+	}
+
+	return channels;
+}
+
+void TcpThread::PostChat(const QString & channel, const QByteArray & data, int type)
+{
+	if (!GetThread())
+		return;
+
+	QMutexLocker locker(&m_ChatLock);
+
+	// Nobody listen this channel here
+	if (channel != ChatService::GLOBAL_CHANNEL && !m_ChatSubscribers.contains(channel))
+		return;
+
+	SChatPost post;
+	post.channel = channel;
+	post.data = data;
+	post.type = type;
+
+	m_ChatPending.push_back(post);
+
+	if (!bChatFlushScheduled)
+	{
+		bChatFlushScheduled = true;
+		QTimer::singleShot(0, m_loop, [this]() { FlushChat(); });
+	}
+}
+
+void TcpThread::FlushChat()
+{
+	QList<SChatPost> posts;
+
+	{
+		QMutexLocker locker(&m_ChatLock);
+		posts.swap(m_ChatPending);
+		bChatFlushScheduled = false;
+	}
+
+	QThread* currentThread = QThread::currentThread();
+
+	// Locks are held while sending, so connections can't be deleted in the middle
+	auto send = [currentThread](TcpConnection* connection, const SChatPost &post)
+	{
+		// Connection can be on the way to other thread
+		if (connection->thread() == currentThread)
+			connection->SendData(post.data, post.type);
+		else
+			QMetaObject::invokeMethod(connection, "SendData", Qt::QueuedConnection, Q_ARG(QByteArray, post.data), Q_ARG(int, post.type));
+	};
+
+	for (auto post = posts.constBegin(); post != posts.constEnd(); ++post)
+	{
+		if (post->channel == ChatService::GLOBAL_CHANNEL)
+		{
+			QReadLocker locker(&m_lock);
+
+			for (auto it = m_connections.constBegin(); it != m_connections.constEnd(); ++it)
+				send(*it, *post);
+		}
+		else
+		{
+			QMutexLocker locker(&m_ChatLock);
+
+			auto subscribers = m_ChatSubscribers.constFind(post->channel);
+			if (subscribers == m_ChatSubscribers.constEnd())
+				continue;
+
+			for (auto it = subscribers->constBegin(); it != subscribers->constEnd(); ++it)
+				send(*it, *post);
+		}
 	}
 }
 
@@ -53,11 +469,82 @@ void TcpThread::connecting(qintptr handle, TcpThread *runnable, TcpConnection* c
 
 	qDebug() << "Connecting: " << handle << " on " << runnable << " with " << connection;
 
-	connection->moveToThread(QThread::currentThread());
+	if (!GetThread())
+	{
+		AbortConnection(handle);
+		connection->deleteLater();
+		return;
+	}
+
+	if (!CheckHandshakes(handle))
+	{
+		connection->deleteLater();
+		return;
+	}
+
+	// This object live on server thread, so connection must be moved to thread of event loop
+	connection->moveToThread(GetThread());
+
+	StartConnection(handle, connection);
+}
+
+void TcpThread::incoming(qintptr handle)
+{
+	// Called on thread of event loop by own listener
+	TcpServer* pServer = gEnv->pServer;
+
+	if (pServer->GetClientCount() >= pServer->GetMaxClientCount())
+	{
+		qCritical() << "Can't accept new client, because server have limit" << pServer->GetMaxClientCount();
+		AbortConnection(handle);
+		return;
+	}
+
+	if (!CheckHandshakes(handle))
+		return;
+
+	StartConnection(handle, CreateConnection());
+}
+
+bool TcpThread::CheckHandshakes(qintptr handle)
+{
+	// Too many clients in handshake on this thread (reconnect storm) - drop new ones at once
+	int maxHandshakes = gEnv->pSettings->GetVariable("net_max_handshakes_per_thread").toInt();
+
+	if (maxHandshakes > 0 && GetHandshakes() >= maxHandshakes)
+	{
+		qWarning() << this << "have" << GetHandshakes() << "handshakes in progress. Rejecting connection" << handle;
+
+		AbortConnection(handle);
+		m_Counters.handshakesRejected.fetchAndAddRelaxed(1);
+
+		return false;
+	}
+
+	return true;
+}
+
+void TcpThread::AbortConnection(qintptr handle)
+{
+	QTcpSocket socket;
+	socket.setSocketDescriptor(handle);
+	socket.abort();
+}
+
+void TcpThread::StartConnection(qintptr handle, TcpConnection * connection)
+{
+	connection->SetCounters(&m_Counters);
+
+	{
+		QWriteLocker locker(&m_lock);
+		m_connections.append(connection);
+		connection->SetRoute(AttachSlot(connection));
+	}
 
-	m_connections.append(connection);
 	AddSignals(connection);
-	connection->accept(handle);
+
+	m_Handshakes.ref();
+	QMetaObject::invokeMethod(connection, "accept", Qt::QueuedConnection, Q_ARG(qint64, handle));
 }
 
 void TcpThread::closing()
@@ -74,7 +561,7 @@ void TcpThread::opened()
 	// Block very fast connection
 	if (!gEnv->pSettings->GetVariable("stress_mode").toBool() && gEnv->pServer->GetClientCount() > gEnv->pSettings->GetVariable("sv_max_players").toInt())
 	{
-		connection->quit();
+		QMetaObject::invokeMethod(connection, "quit", Qt::QueuedConnection);
 	}
 
 	qDebug() << connection << "opened";
@@ -87,13 +574,59 @@ void TcpThread::closed()
 	if (!connection) return;
 
 	qDebug() << connection << "closed";
-	m_connections.removeAll(connection);
+
+	// Connection can be closed right after moving to other thread
+	if (!Forget(connection))
+		gEnv->pServer->ForgetConnection(connection);
 
 	qDebug() << this << "deleting" << connection;
 
 	connection->deleteLater();
 }
 
+void TcpThread::handshakeFinished(bool success, qint64 time)
+{
+	m_Handshakes.deref();
+
+	if (success)
+	{
+		gEnv->m_HandshakesCount++;
+		gEnv->m_HandshakesTotalTime += time;
+
+		if (time > gEnv->m_HandshakesMaxTime.load())
+			gEnv->m_HandshakesMaxTime = time;
+	}
+	else
+	{
+		gEnv->m_HandshakesFailed++;
+	}
+}
+
+void TcpThread::moved(TcpThread * target)
+{
+	TcpConnection *connection = static_cast<TcpConnection*>(sender());
+	if (!connection || !target)
+		return;
+
+	// Chat subscriptions follow the connection
+	QStringList channels = TakeChannels(connection);
+
+	disconnect(connection, nullptr, this, nullptr);
+	disconnect(this, nullptr, connection, nullptr);
+	disconnect(connection, nullptr, gEnv->pServer, nullptr);
+
+	// Messages posted to old route are forwarded until slot reused
+	SConnectionRoute route = target->Adopt(connection);
+	Forget(connection, route);
+
+	gEnv->pServer->UpdateRoute(connection->GetSocket(), route);
+
+	for (auto it = channels.constBegin(); it != channels.constEnd(); ++it)
+		target->Subscribe(*it, connection, 0);
+
+	qDebug() << connection << "moved from" << this << "to" << target;
+}
+
 TcpConnection* TcpThread::CreateConnection()
 {
 	TcpConnection *connection = new TcpConnection();
@@ -107,10 +640,7 @@ void TcpThread::AddSignals(TcpConnection * connection)
 {
 	connect(connection, &TcpConnection::opened, this, &TcpThread::opened, Qt::QueuedConnection);
 	connect(connection, &TcpConnection::closed, this, &TcpThread::closed, Qt::QueuedConnection);
+	connect(connection, &TcpConnection::handshakeFinished, this, &TcpThread::handshakeFinished, Qt::QueuedConnection);
+	connect(connection, &TcpConnection::moved, this, &TcpThread::moved, Qt::QueuedConnection);
 	connect(this, &TcpThread::quit, connection, &TcpConnection::quit, Qt::QueuedConnection);
-
-	connect(connection, &TcpConnection::received, gEnv->pServer, &TcpServer::MessageReceived, Qt::QueuedConnection);
-	connect(connection, &TcpConnection::sended, gEnv->pServer, &TcpServer::MessageSended, Qt::QueuedConnection);
-
-	connect(gEnv->pTimer, &QTimer::timeout, connection, &TcpConnection::Update, Qt::QueuedConnection);
 }
\ No newline at end of file
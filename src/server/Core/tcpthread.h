@@ -11,9 +11,19 @@
 #include <QDebug>
 #include <QReadWriteLock>
 #include <QReadLocker>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QHostAddress>
+#include <QMutex>
+#include <QHash>
+#include <QStringList>
+#include <QQueue>
+#include <QVector>
 
 #include "tcpthread.h"
 #include "tcpconnection.h"
+#include "trafficcounters.h"
+#include "mailbox.h"
 
 #include "Workers/Databases/redisconnector.h"
 
@@ -26,15 +36,62 @@ public:
 public:
 	void                  run();
 	int                   Count();
-	void                  SendGlobalMessage(CTcpPacket &packet);
+	// Thread-safe. Data is serialized packet shared by all threads, it's never copied before write
+	void                  Broadcast(const QByteArray &data, int type);
+
+	// Must be called before start
+	void                  SetIndex(int index) { m_Index = index; }
+	// Accept clients on own SO_REUSEPORT socket instead of getting them from TcpServer
+	void                  SetListenAddress(const QHostAddress &address, quint16 port);
+
+	// Thread where event loop of this runnable is running, nullptr before start
+	QThread*              GetThread() { return m_Thread.load(); }
+	// Event loop lag in milliseconds
+	int                   GetLag() { return m_Lag.load(); }
+	int                   GetHandshakes() { return m_Handshakes.load(); }
+	STrafficCounters*     GetCounters() { return &m_Counters; }
+	// Connections + handshakes, weighted by event loop lag
+	int                   GetLoad();
+
+	// Ask up to count idle connections to move to target thread
+	void                  MigrateConnections(TcpThread* target, int count);
+	// Return new route of connection
+	SConnectionRoute      Adopt(TcpConnection* connection);
+	// Messages for connection moved to other thread go to forward route
+	bool                  Forget(TcpConnection* connection, const SConnectionRoute &forward = SConnectionRoute());
+
+	// Thread-safe, without locks. Message delivered to connection on thread of event loop
+	bool                  Post(const SMailboxMessage &message);
+
+	// Chat channel subscribers of this thread, global channel include all connections
+	bool                  Subscribe(const QString &channel, TcpConnection* connection, int maxChannels);
+	bool                  Unsubscribe(const QString &channel, TcpConnection* connection);
+	bool                  IsSubscribed(const QString &channel, TcpConnection* connection);
+	// Thread-safe. Messages posted before next event loop iteration are delivered in one batch
+	void                  PostChat(const QString &channel, const QByteArray &data, int type);
+private:
+	void                  FlushChat();
+	QStringList           TakeChannels(TcpConnection* connection);
+
+	// Must be called with write lock
+	SConnectionRoute      AttachSlot(TcpConnection* connection);
+	void                  DetachSlot(TcpConnection* connection, const SConnectionRoute &forward);
+	void                  Deliver(const SMailboxMessage &message);
 private:
 	TcpConnection*        CreateConnection();
 	void                  AddSignals(TcpConnection* connection);
+	bool                  CheckHandshakes(qintptr handle);
+	void                  StartConnection(qintptr handle, TcpConnection* connection);
+	void                  AbortConnection(qintptr handle);
+	void                  incoming(qintptr handle);
+	void                  PinToCore();
 public slots:
 	void                  connecting(qintptr handle, TcpThread *runnable, TcpConnection* connection);
 	void                  closing();
 	void                  opened();
 	void                  closed();
+	void                  handshakeFinished(bool success, qint64 time);
+	void                  moved(TcpThread* target);
 signals:
 	void                  started();
 	void                  finished();
@@ -43,6 +100,49 @@ private:
 	QEventLoop*           m_loop;
 	QReadWriteLock        m_lock;
 	QList<TcpConnection*> m_connections;
+	int                   m_MigrateCursor;
+
+	// Connection table for routes, guarded by m_lock
+	struct SSlot
+	{
+		SSlot() : connection(nullptr), generation(0) {}
+
+		TcpConnection*    connection;
+		quint32           generation;
+		SConnectionRoute  forward;
+	};
+
+	QVector<SSlot>        m_Slots;
+	// Oldest freed slot reused first, so forward routes live longer
+	QQueue<int>           m_FreeSlots;
+	QHash<TcpConnection*, int> m_SlotByConnection;
+	ConnectionMailbox*    m_Mailbox;
+	int                   m_Index;
+
+	QHostAddress          m_ListenAddress;
+	quint16               m_ListenPort;
+
+	QAtomicPointer<QThread> m_Thread;
+	QAtomicInt            m_Lag;
+
+	// TLS handshakes in progress on this thread
+	QAtomicInt            m_Handshakes;
+
+	STrafficCounters      m_Counters;
+
+	// Chat
+	struct SChatPost
+	{
+		QString           channel;
+		QByteArray        data;
+		int               type;
+	};
+
+	QMutex                m_ChatLock;
+	QHash<QString, QList<TcpConnection*>> m_ChatSubscribers;
+	QHash<TcpConnection*, QStringList> m_ChatChannels;
+	QList<SChatPost>      m_ChatPending;
+	bool                  bChatFlushScheduled;
 };
 
 #endif // TCPTHREAD_H
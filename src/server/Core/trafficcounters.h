@@ -0,0 +1,42 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef TRAFFICCOUNTERS_H
+#define TRAFFICCOUNTERS_H
+
+#include <QAtomicInteger>
+
+#include <FireNetCore/IFireNetTcpPacket.h>
+
+// Traffic statistic of one server thread.
+// Connections add to counters of own thread with relaxed atomics, TcpServer take and reset
+// them once a second. Counters are padded by cache line from both sides, so counting don't
+// slow down other threads. Padding used instead of alignas, objects with counters created by plain new.
+struct STrafficCounters
+{
+	enum { QUERY_TYPES = static_cast<int>(EFireNetTcpQuery::SetChatMember) + 1 };
+	enum { CACHE_LINE = 64 };
+
+	void                   AddQuery(EFireNetTcpQuery query)
+	{
+		int index = static_cast<int>(query);
+
+		if (index >= 0 && index < QUERY_TYPES)
+			queries[index].fetchAndAddRelaxed(1);
+	}
+
+	char                   padFront[CACHE_LINE];
+
+	QAtomicInteger<qint64> inputPackets;
+	QAtomicInteger<qint64> outputPackets;
+	QAtomicInteger<qint64> inputBytes;
+	QAtomicInteger<qint64> outputBytes;
+	QAtomicInt             badPackets;
+	QAtomicInt             rateLimited;
+	QAtomicInt             handshakesRejected;
+	QAtomicInt             queries[QUERY_TYPES];
+
+	char                   padBack[CACHE_LINE];
+};
+
+#endif // TRAFFICCOUNTERS_H
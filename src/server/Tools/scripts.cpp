@@ -6,10 +6,15 @@
 
 #include <QXmlStreamReader>
 #include <QFile>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include "Core/tcppacket.h"
 
 Scripts::Scripts(QObject *parent) : QObject(parent)
 {
-
+	connect(&m_ShopWatcher, &QFileSystemWatcher::fileChanged, this, &Scripts::shopFileChanged);
 }
 
 Scripts::~Scripts()
@@ -19,7 +24,14 @@ Scripts::~Scripts()
 
 void Scripts::Clear()
 {
-	m_shop.clear();
+	{
+		QMutexLocker locker(&m_ShopMutex);
+		m_shop.clear();
+	}
+
+	if (!m_ShopWatcher.files().isEmpty())
+		m_ShopWatcher.removePaths(m_ShopWatcher.files());
+
 	m_trustedServers.clear();
 }
 
@@ -27,7 +39,8 @@ void Scripts::LoadShopScript()
 {
 	qDebug() << "Loading shop...";
 
-	QFile shop("scripts/shop.xml");
+	const QString path = "scripts/shop.xml";
+	QFile shop(path);
 
 	if (!shop.open(QIODevice::ReadOnly))
 	{
@@ -37,7 +50,12 @@ void Scripts::LoadShopScript()
 
 	QByteArray data = shop.readAll();
 	shop.close();
-	shop.deleteLater();
+
+	// Watch file for reload without restart
+	if (!m_ShopWatcher.files().contains(path))
+		m_ShopWatcher.addPath(path);
+
+	QSharedPointer<SShopCatalog> catalog(new SShopCatalog);
 	QXmlStreamReader xml(data);
 
 	xml.readNext();
@@ -55,20 +73,75 @@ void Scripts::LoadShopScript()
 
 			if (!name.isEmpty())
 			{
+				if (catalog->byName.contains(name))
+				{
+					qWarning() << "Item <" << name << "> alredy added to shop. Item skipped";
+					continue;
+				}
+
 				SShopItem item;
 				item.name = name;
 				item.cost = cost;
 				item.minLnl = minLvl;
 				item.canBuy = canBuy;
 
-				m_shop.push_back(item);
+				catalog->byName.insert(name, catalog->items.size());
+				catalog->items.push_back(item);
 
 				qDebug() << "Adding <" << name << "> item to shop";
 			}
 		}
 	}
 
-	qDebug() << "Loaded" << m_shop.size() << "shop items.";
+	// File can be readed while editor still write it, old shop stay until next change
+	if (xml.hasError())
+	{
+		qCritical() << "Can't parse shop.xml! Reason =" << xml.errorString() << ". Shop not changed";
+		return;
+	}
+
+	QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+	catalog->version = qMax(1, static_cast<int>(qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(hash.constData())) & 0x7FFFFFFF));
+	catalog->packet = EncodeShop(*catalog);
+
+	{
+		QMutexLocker locker(&m_ShopMutex);
+		m_shop = catalog;
+	}
+
+	qDebug() << "Loaded" << catalog->items.size() << "shop items. Shop version" << catalog->version;
+}
+
+QByteArray Scripts::EncodeShop(const SShopCatalog & catalog)
+{
+	QStringList shopList;
+
+	for (auto it = catalog.items.begin(); it != catalog.items.end(); ++it)
+	{
+		// name-cost-minLvl-canBuy
+		shopList.append(it->name + "-" +
+			QString::number(it->cost) + "-" +
+			QString::number(it->minLnl) + "-" +
+			QString::number(it->canBuy ? 1 : 0));
+	}
+
+	CTcpPacket packet(EFireNetTcpPacketType::Result);
+	packet.WriteResult(EFireNetTcpResult::GetShopComplete);
+	packet.WriteString(shopList.join(",").toStdString());
+	packet.WriteInt(catalog.version);
+
+	const char* data = packet.toString();
+	return QByteArray(data, static_cast<int>(packet.getLength()));
+}
+
+void Scripts::shopFileChanged(const QString & path)
+{
+	// Editors often replace file, then it removed from watcher
+	if (!m_ShopWatcher.files().contains(path) && QFile::exists(path))
+		m_ShopWatcher.addPath(path);
+
+	qInfo() << "Shop file changed. Reloading shop...";
+	LoadShopScript();
 }
 
 void Scripts::LoadTrustedServerList()
@@ -117,11 +190,31 @@ void Scripts::LoadTrustedServerList()
 	qDebug() << "Loaded" << m_trustedServers.size() << "trusted servers.";
 }
 
-QVector<SShopItem> Scripts::GetShop()
+SShopCatalogPtr Scripts::GetShop()
 {
+	QMutexLocker locker(&m_ShopMutex);
 	return m_shop;
 }
 
+SShopItem Scripts::GetShopItem(const QString & name)
+{
+	SShopCatalogPtr shop = GetShop();
+
+	if (shop)
+	{
+		auto it = shop->byName.constFind(name);
+		if (it != shop->byName.constEnd())
+			return shop->items[it.value()];
+	}
+
+	SShopItem item;
+	item.cost = 0;
+	item.minLnl = 0;
+	item.canBuy = false;
+
+	return item;
+}
+
 QVector<STrustedServer> Scripts::GetTrustedList()
 {
 	return m_trustedServers;
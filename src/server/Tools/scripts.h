@@ -5,8 +5,26 @@
 #define SCRIPTS_H
 
 #include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QFileSystemWatcher>
+
 #include "global.h"
 
+// Shop from scripts/shop.xml. Catalog never changed after it published, reload publish new one,
+// so readers can hold old catalog as long as they need
+struct SShopCatalog
+{
+	// Hash of shop content, same shop have same version on all servers and after restart
+	int                     version;
+	QVector<SShopItem>      items;
+	QHash<QString, int>     byName;
+	// Ready GetShopComplete packet
+	QByteArray              packet;
+};
+
+typedef QSharedPointer<const SShopCatalog> SShopCatalogPtr;
+
 class Scripts : public QObject
 {
     Q_OBJECT
@@ -18,10 +36,18 @@ public:
 	void                    LoadShopScript();
 	void                    LoadTrustedServerList();
 public:
-	QVector<SShopItem>      GetShop();
+	SShopCatalogPtr         GetShop();
+	// Item with empty name if not found
+	SShopItem               GetShopItem(const QString &name);
 	QVector<STrustedServer> GetTrustedList();
+private slots:
+	void                    shopFileChanged(const QString &path);
+private:
+	static QByteArray       EncodeShop(const SShopCatalog &catalog);
 private:
-	QVector<SShopItem>      m_shop;
+	QMutex                  m_ShopMutex;
+	SShopCatalogPtr         m_shop;
+	QFileSystemWatcher      m_ShopWatcher;
 	QVector<STrustedServer> m_trustedServers;
 };
 
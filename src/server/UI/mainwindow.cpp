@@ -8,6 +8,7 @@
 
 #include "Core/tcpserver.h"
 #include "Core/remoteserver.h"
+#include "Core/sslcontext.h"
 
 #include "Workers/Databases/dbworker.h"
 #include "Workers/Databases/mysqlconnector.h"
@@ -148,10 +149,10 @@ void MainWindow::UpdateServerStatus()
 		" | RClients : " + QString::number(gsCount) + "/" + QString::number(maxGsCount) +
 		" | DBMode : " + gEnv->m_ServerStatus.m_DBMode +
 		" | DBStatus : " + gEnv->m_ServerStatus.m_DBStatus +	
-		" | IPackets : " + QString::number(gEnv->m_InputPacketsCount) +
-		" | OPackets : " + QString::number(gEnv->m_OutputPacketsCount) + 
-		" | ISpeed : " + QString::number(gEnv->m_InputSpeed) + 
-		" | OSpeed : " + QString::number(gEnv->m_OutputSpeed);
+		" | IPackets : " + QString::number(gEnv->m_InputPacketsCount.load()) +
+		" | OPackets : " + QString::number(gEnv->m_OutputPacketsCount.load()) + 
+		" | ISpeed : " + QString::number(gEnv->m_InputSpeed.load()) + 
+		" | OSpeed : " + QString::number(gEnv->m_OutputSpeed.load());
 
 	ui->Status->addItem(status);
 
@@ -214,18 +215,49 @@ void MainWindow::on_Input_returnPressed()
 		qWarning() << "Server version :" << gEnv->m_serverFullName.toStdString().c_str();
 		qWarning() << "Main server (" << gEnv->pSettings->GetVariable("sv_ip").toString().toStdString().c_str() << ":" << gEnv->pSettings->GetVariable("sv_port").toInt() << ") - " << gEnv->m_ServerStatus.m_MainServerStatus.toStdString().c_str();
 		qWarning() << "Clients count :" << gEnv->pServer->GetClientCount() << "/" << gEnv->pServer->GetMaxClientCount();
-		qWarning() << "Maximum active clients count :" << gEnv->m_MaxClientCount;
+		qWarning() << "Maximum active clients count :" << gEnv->m_MaxClientCount.load();
 		qWarning() << "Thread count :" << gEnv->pSettings->GetVariable("sv_thread_count").toInt();
 		qWarning() << "Server tickrate :" << gEnv->pSettings->GetVariable("sv_tickrate").toInt() << "per/sec.";
 
+		// Threads info
+		QStringList threads = gEnv->pServer->GetThreadsStats();
+
+		for (int i = 0; i < threads.size(); i++)
+		{
+			qWarning() << "Thread" << i << ":" << threads[i].toStdString().c_str();
+		}
+
 		// Packets info
-		qWarning() << "Input packets count :" << gEnv->m_InputPacketsCount;
-		qWarning() << "Input packets current speed :" << gEnv->m_InputSpeed << "packets/sec.";
-		qWarning() << "Input packets max speed :" << gEnv->m_InputMaxSpeed << "packets/sec.";
+		qWarning() << "Input packets count :" << gEnv->m_InputPacketsCount.load();
+		qWarning() << "Input packets current speed :" << gEnv->m_InputSpeed.load() << "packets/sec.";
+		qWarning() << "Input packets max speed :" << gEnv->m_InputMaxSpeed.load() << "packets/sec.";
 
-		qWarning() << "Output packets :" << gEnv->m_OutputPacketsCount;
-		qWarning() << "Output packets current speed :" << gEnv->m_OutputSpeed << "packets/sec.";
-		qWarning() << "Output packets max speed :" << gEnv->m_OutputMaxSpeed << "packets/sec.";
+		qWarning() << "Output packets :" << gEnv->m_OutputPacketsCount.load();
+		qWarning() << "Output packets current speed :" << gEnv->m_OutputSpeed.load() << "packets/sec.";
+		qWarning() << "Output packets max speed :" << gEnv->m_OutputMaxSpeed.load() << "packets/sec.";
+
+		// Traffic info
+		qWarning() << "Input traffic :" << gEnv->m_InputBytes.load() << "bytes. Current speed :" << gEnv->m_InputBytesSpeed.load() << "bytes/sec.";
+		qWarning() << "Output traffic :" << gEnv->m_OutputBytes.load() << "bytes. Current speed :" << gEnv->m_OutputBytesSpeed.load() << "bytes/sec.";
+		qWarning() << "Bad packets :" << gEnv->m_BadPacketsCount.load();
+		qWarning() << "Rate limited packets :" << gEnv->m_RateLimitedCount.load();
+
+		// Queries info
+		QStringList queries = gEnv->pServer->GetQueriesStats();
+
+		for (int i = 0; i < queries.size(); i++)
+		{
+			qWarning() << "Query" << queries[i].toStdString().c_str();
+		}
+
+		// Handshakes info
+		qint64 handshakeAvgTime = gEnv->m_HandshakesCount.load() > 0 ? gEnv->m_HandshakesTotalTime.load() / gEnv->m_HandshakesCount.load() : 0;
+
+		qWarning() << "Handshakes completed :" << gEnv->m_HandshakesCount.load();
+		qWarning() << "Handshakes failed :" << gEnv->m_HandshakesFailed.load();
+		qWarning() << "Handshakes rejected :" << gEnv->m_HandshakesRejected.load();
+		qWarning() << "Handshake average time :" << handshakeAvgTime << "ms.";
+		qWarning() << "Handshake max time :" << gEnv->m_HandshakesMaxTime.load() << "ms.";
 
 		// Remote server status
 		QString remoteAdminStatus = gEnv->pRemoteServer->IsHaveAdmin() ? "online" : "offline";
@@ -241,9 +273,9 @@ void MainWindow::on_Input_returnPressed()
 		qWarning() << "Database status :" << gEnv->m_ServerStatus.m_DBStatus.toStdString().c_str();
 
 		// Debug messages
-		qWarning() << "Debug messages :" << gEnv->m_DebugsCount;
-		qWarning() << "Warning messages :" << gEnv->m_WarningsCount;
-		qWarning() << "Error messages :" << gEnv->m_ErrorsCount;
+		qWarning() << "Debug messages :" << gEnv->m_DebugsCount.load();
+		qWarning() << "Warning messages :" << gEnv->m_WarningsCount.load();
+		qWarning() << "Error messages :" << gEnv->m_ErrorsCount.load();
 	}
 	else if (input.contains("send_message")) // TODO
 	{
@@ -297,6 +329,13 @@ void MainWindow::on_Input_returnPressed()
 			qInfo() << servers[i];
 		}
 	}
+	else if (input == "reload_ssl")
+	{
+		if (gEnv->pSslContext && gEnv->pSslContext->Reload())
+			qInfo() << "SSL certificate reloaded. New connections will use it";
+		else
+			qWarning() << "Can't reload SSL certificate";
+	}
 	else if (input == "clear")
 	{
 		ClearOutput();
@@ -312,6 +351,7 @@ void MainWindow::on_Input_returnPressed()
 		qInfo() << "send_command ... - send console command to all connected clients";
 		qInfo() << "servers - get connected game servers list";
 		qInfo() << "players - get connected players list";
+		qInfo() << "reload_ssl - reload SSL certificate and key from disk";
 		qInfo() << "quit - full server shutdown";
 	}
 	else
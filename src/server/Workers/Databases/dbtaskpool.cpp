@@ -0,0 +1,88 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QRunnable>
+#include <QMutexLocker>
+
+#include "global.h"
+#include "dbtaskpool.h"
+
+// Run all tasks of one key, only one runnable exist for key at time
+class CDBTaskRunnable : public QRunnable
+{
+public:
+	CDBTaskRunnable(DBTaskPool* pool, quint64 key) : pPool(pool), m_Key(key) {}
+public:
+	virtual void run() { pPool->RunQueue(m_Key); }
+private:
+	DBTaskPool* pPool;
+	quint64     m_Key;
+};
+
+DBTaskPool::DBTaskPool(QObject *parent) : QObject(parent)
+{
+	// Threads never expire, else their Redis and MySql connections with prepared statements die after quiet time
+	m_Pool.setExpiryTimeout(-1);
+}
+
+DBTaskPool::~DBTaskPool()
+{
+	qDebug() << "~DBTaskPool";
+	Clear();
+}
+
+void DBTaskPool::SetMaxThreads(int count)
+{
+	qDebug() << "Setting database worker threads to" << count;
+	m_Pool.setMaxThreadCount(qMax(1, count));
+}
+
+void DBTaskPool::Post(quint64 key, const std::function<void()> &task)
+{
+	m_Queued.ref();
+
+	QMutexLocker locker(&m_Mutex);
+
+	auto it = m_Queues.find(key);
+	if (it != m_Queues.end())
+	{
+		// Runnable of this key alredy working, task will be taken by it
+		it->enqueue(task);
+		return;
+	}
+
+	m_Queues[key].enqueue(task);
+	m_Pool.start(new CDBTaskRunnable(this, key));
+}
+
+void DBTaskPool::Clear()
+{
+	m_Pool.waitForDone();
+}
+
+void DBTaskPool::RunQueue(quint64 key)
+{
+	for (;;)
+	{
+		std::function<void()> task;
+
+		{
+			QMutexLocker locker(&m_Mutex);
+
+			auto it = m_Queues.find(key);
+			if (it == m_Queues.end())
+				return;
+
+			if (it->isEmpty())
+			{
+				m_Queues.erase(it);
+				return;
+			}
+
+			task = it->dequeue();
+		}
+
+		task();
+		m_Queued.deref();
+	}
+}
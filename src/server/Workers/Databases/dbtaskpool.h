@@ -0,0 +1,42 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef DBTASKPOOL_H
+#define DBTASKPOOL_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QQueue>
+#include <QAtomicInt>
+
+#include <functional>
+
+// Runs database work outside of network threads.
+// Tasks with same key (player uid) run one by one in posting order,
+// tasks with different keys run in parallel.
+class DBTaskPool : public QObject
+{
+	Q_OBJECT
+public:
+	explicit DBTaskPool(QObject *parent = nullptr);
+	~DBTaskPool();
+public:
+	void                  SetMaxThreads(int count);
+	void                  Post(quint64 key, const std::function<void()> &task);
+	// Wait until all posted tasks done
+	void                  Clear();
+
+	int                   GetQueuedCount() { return m_Queued.load(); }
+private:
+	friend class CDBTaskRunnable;
+	void                  RunQueue(quint64 key);
+private:
+	QThreadPool           m_Pool;
+	QMutex                m_Mutex;
+	QHash<quint64, QQueue<std::function<void()>>> m_Queues;
+	QAtomicInt            m_Queued;
+};
+
+#endif // DBTASKPOOL_H
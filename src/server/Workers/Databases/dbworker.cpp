@@ -5,17 +5,66 @@
 #include "dbworker.h"
 #include "redisconnector.h"
 #include "mysqlconnector.h"
+#include "dbtaskpool.h"
+#include "profilecache.h"
+#include "nicknameindex.h"
 
 #include "Workers/Packets/clientquerys.h"
 #include "Tools/settings.h"
 
 #include <QRegExp>
+#include <QMutexLocker>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QStringList>
+
+// Same names used for Redis hash fields and MySql columns.
+// Items and friends stored as Redis sets and MySql tables, see WriteProfileLists
+static const struct
+{
+	int         field;
+	const char* name;
+} s_ProfileColumns[] =
+{
+	{ ProfileNickname, "nickname" },
+	{ ProfileFileModel, "fileModel" },
+	{ ProfileLvl, "lvl" },
+	{ ProfileXp, "xp" },
+	{ ProfileMoney, "money" },
+};
+
+static const int PROFILE_COLUMNS_COUNT = sizeof(s_ProfileColumns) / sizeof(s_ProfileColumns[0]);
+
+static QVariant ProfileValue(const SProfile &profile, int field)
+{
+	switch (field)
+	{
+	case ProfileNickname: return profile.nickname;
+	case ProfileFileModel: return profile.fileModel;
+	case ProfileLvl: return profile.lvl;
+	case ProfileXp: return profile.xp;
+	case ProfileMoney: return profile.money;
+	default: return QVariant();
+	}
+}
+
+// First uid of new database
+static const int FIRST_UID = 100001;
+
+static QString ItemsKey(int uid) { return "profiles:" + QString::number(uid) + ":items"; }
+static QString FriendsKey(int uid) { return "profiles:" + QString::number(uid) + ":friends"; }
 
 DBWorker::DBWorker(QObject *parent) : QObject(parent),
 	pRedis(nullptr),
-	pMySql(nullptr)
+	pMySql(nullptr),
+	m_NextUid(0),
+	m_LastUid(0),
+	bOldProfileColumns(false)
 {
+	pTaskPool = new DBTaskPool(this);
+	pProfileCache = new ProfileCache(this);
+	pNicknameIndex = new NicknameIndex;
 }
 
 DBWorker::~DBWorker()
@@ -23,10 +72,15 @@ DBWorker::~DBWorker()
 	qDebug() << "~DBWorker";
 	SAFE_RELEASE(pRedis);
 	SAFE_RELEASE(pMySql);
+	SAFE_DELETE(pNicknameIndex);
 }
 
 void DBWorker::Clear()
 {
+	// Write all profile changes and let started queries finish before connections closed
+	pProfileCache->Flush();
+	pTaskPool->Clear();
+
 	if (pRedis != nullptr)
 	{
 		pRedis->Disconnect();
@@ -41,6 +95,8 @@ void DBWorker::Init()
 {
 	gEnv->m_ServerStatus.m_DBStatus = "init";
 
+	pTaskPool->SetMaxThreads(gEnv->pSettings->GetVariable("db_worker_threads").toInt());
+
 	// Create Redis connection
 	if (gEnv->pSettings->GetVariable("bUseRedis").toBool())
 	{
@@ -57,6 +113,87 @@ void DBWorker::Init()
 		pMySql = new MySqlConnector;
 		pMySql->run();
 	}
+
+	MigrateProfileLists();
+	CreateNicknameKey();
+	LoadNicknames();
+	pProfileCache->Init();
+}
+
+void DBWorker::LoadNicknames()
+{
+	QHash<QString, int> nicknames;
+
+	// Redis
+	if (pRedis)
+	{
+		if (!pRedis->IsConnected())
+		{
+			qCritical() << "Failed load nicknames from Redis DB because Redis DB not connected! Nicknames will be searched in DB";
+			return;
+		}
+
+		const QByteArray prefix = "nicknames:";
+		QByteArray cursor = "0";
+
+		do
+		{
+			QVector<SRedisReply> scan = pRedis->Pipeline({ { "SCAN", cursor, "MATCH", prefix + "*", "COUNT", "1000" } });
+
+			if (scan.size() != 1 || scan[0].type != SRedisReply::Array || scan[0].elements.size() != 2)
+			{
+				qCritical() << "Failed scan nicknames in Redis DB! Nicknames will be searched in DB";
+				return;
+			}
+
+			cursor = scan[0].elements[0].string;
+			const QVector<SRedisReply> &keys = scan[0].elements[1].elements;
+
+			if (keys.isEmpty())
+				continue;
+
+			QList<QByteArray> mget;
+			mget.push_back("MGET");
+
+			for (auto it = keys.begin(); it != keys.end(); ++it)
+				mget.push_back(it->string);
+
+			QVector<SRedisReply> uids = pRedis->Pipeline({ mget });
+
+			if (uids.size() != 1 || uids[0].elements.size() != keys.size())
+			{
+				qCritical() << "Failed read nicknames from Redis DB! Nicknames will be searched in DB";
+				return;
+			}
+
+			for (int i = 0; i < keys.size(); ++i)
+			{
+				const int uid = uids[0].elements[i].string.toInt();
+
+				if (uid > 0)
+					nicknames.insert(QString::fromUtf8(keys[i].string.mid(prefix.size())), uid);
+			}
+		} while (cursor != "0");
+	}
+	// MySql
+	else if (pMySql)
+	{
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT uid, nickname FROM profiles") : nullptr;
+
+		if (!query || !pConnection->Exec(query))
+		{
+			qCritical() << "Failed load nicknames from MySql DB! Nicknames will be searched in DB";
+			return;
+		}
+
+		while (query->next())
+			nicknames.insert(query->value(1).toString(), query->value(0).toInt());
+	}
+	else
+		return;
+
+	pNicknameIndex->Reset(nicknames, gEnv->pSettings->GetVariable("db_nickname_filter_bits").toInt());
 }
 
 bool DBWorker::UserExists(const QString &login)
@@ -81,13 +218,14 @@ bool DBWorker::UserExists(const QString &login)
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT * FROM users WHERE login=:login") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM users WHERE login=:login");
 			query->bindValue(":login", login);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				if (query->next())
 				{
@@ -139,13 +277,14 @@ bool DBWorker::ProfileExists(int uid)
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT * FROM profiles WHERE uid=:uid") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM profiles WHERE uid=:uid");
 			query->bindValue(":uid", uid);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				if (query->next())
 				{
@@ -176,6 +315,10 @@ bool DBWorker::ProfileExists(int uid)
 
 bool DBWorker::NicknameExists(const QString &nickname)
 {
+	// Index know only nicknames of this node, other nodes can add more, so miss checked in DB
+	if (pNicknameIndex->IsReady() && pNicknameIndex->Contains(nickname))
+		return true;
+
 	bool result = false;
 
 	// Redis
@@ -207,13 +350,14 @@ bool DBWorker::NicknameExists(const QString &nickname)
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT * FROM profiles WHERE nickname=:nickname") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM profiles WHERE nickname=:nickname");
 			query->bindValue(":nickname", nickname);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				if (query->next())
 				{
@@ -244,101 +388,110 @@ bool DBWorker::NicknameExists(const QString &nickname)
 
 int DBWorker::GetFreeUID()
 {
-	int uid = -1;
+	// Uids given from reserved block, database asked only when block ends
+	QMutexLocker locker(&m_Mutex);
+
+	if (m_NextUid <= 0 || m_NextUid > m_LastUid)
+	{
+		if (!ReserveUIDBlock())
+			return -1;
+	}
+
+	int uid = m_NextUid++;
+	qDebug() << "New uid created =" << uid;
+
+	return uid;
+}
+
+bool DBWorker::ReserveUIDBlock()
+{
+	const int blockSize = qMax(1, gEnv->pSettings->GetVariable("db_uid_block_size").toInt());
 
 	// Redis
 	if (pRedis)
 	{
 		if (pRedis->IsConnected())
 		{
-			// Get uids row and create new uid if uids row are empty
-			QString buff = pRedis->GET("uids");
+			// Counter created on first use, INCRBY is atomic for all server nodes
+			QVector<SRedisReply> replies = pRedis->Pipeline({
+				{ "SET", "uids", QByteArray::number(FIRST_UID - 1), "NX" },
+				{ "INCRBY", "uids", QByteArray::number(blockSize) } });
 
-			if (buff.isEmpty())
+			if (replies.size() != 2 || replies[1].type != SRedisReply::Integer)
 			{
-				qDebug() << "Key 'uids' not found! Creating key 'uids'...";
-
-				if (pRedis->SET("uids", "100001"))
-				{
-					uid = 100001;
-					return uid;
-				}
-				else
-				{
-					qCritical() << "Error creating key 'uids'!!!";
-					return uid;
-				}
+				qCritical() << "Error reserving uids in Redis DB -" << (replies.size() == 2 ? replies[1].string : QByteArray());
+				return false;
 			}
-			else
-			{
-				int tmp = buff.toInt() + 1;
 
-				qDebug() << "Key 'uids' found! Creating new uid = " << tmp;
+			m_LastUid = static_cast<int>(replies[1].integer);
+			m_NextUid = m_LastUid - blockSize + 1;
 
-				if (pRedis->SET("uids", QString::number(tmp)))
-				{
-					uid = tmp;
-					qDebug() << "New uid created =" << uid;
-					return uid;
-				}
-				else
-				{
-					qCritical() << "Error creating uid!";
-					return uid;
-				}
-			}
+			qDebug() << "Reserved uids" << m_NextUid << "-" << m_LastUid << "in Redis DB";
+			return true;
 		}
 		else
 		{
-			qCritical() << "Failed found free uid in Redis DB because Redis DB not opened!";
-			return uid;
+			qCritical() << "Failed reserve uids in Redis DB because Redis DB not opened!";
+			return false;
 		}
 	}
-	
+
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+
+		if (!pConnection)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM users WHERE uid=(SELECT MAX(uid) FROM users)");
+			qCritical() << "Failed reserve uids in MySql DB because MySql DB not opened!";
+			return false;
+		}
 
-			if (query->exec())
-			{
-				if (query->next())
-				{
-					int last_uid = query->value(0).toInt();
+		// Sequence row started from last existing uid, LAST_INSERT_ID keep reserved value for this connection
+		QSqlQuery* create = pConnection->Prepare("CREATE TABLE IF NOT EXISTS uid_sequence (id INT PRIMARY KEY, last_uid INT NOT NULL)");
+		QSqlQuery* init = pConnection->Prepare("INSERT IGNORE INTO uid_sequence (id, last_uid) "
+			"SELECT 1, GREATEST(COALESCE(MAX(uid), 0), :first) FROM users");
+		QSqlQuery* reserve = pConnection->Prepare("UPDATE uid_sequence SET last_uid = LAST_INSERT_ID(last_uid + :block) WHERE id = 1");
+		QSqlQuery* select = pConnection->Prepare("SELECT LAST_INSERT_ID()");
 
-					qDebug() << "Last uid from table = " << last_uid;
-					uid = last_uid + 1;
-					return uid;
-				}
-				else
-				{
-					qDebug() << "Not any users in table, get first uid";
-					uid = 100001;
-					return uid;
-				}
-			}
-			else
-			{
-				qWarning() << "Failed send query to MySql DB";
-				return uid;
-			}
+		if (!create || !init || !reserve || !select)
+		{
+			qWarning() << "Failed prepare uid queries for MySql DB";
+			return false;
 		}
-		else
+
+		init->bindValue(":first", FIRST_UID - 1);
+		reserve->bindValue(":block", blockSize);
+
+		if (!pConnection->Exec(create) || !pConnection->Exec(init) || !pConnection->Exec(reserve) || !pConnection->Exec(select))
 		{
-			qCritical() << "Failed found free uid in MySql DB because MySql DB not opened!";
-			return uid;
+			qWarning() << "Failed send query to MySql DB";
+			return false;
+		}
+
+		if (reserve->numRowsAffected() != 1 || !select->next())
+		{
+			qCritical() << "Error reserving uids in MySql DB";
+			return false;
 		}
+
+		m_LastUid = select->value(0).toInt();
+		m_NextUid = m_LastUid - blockSize + 1;
+
+		qDebug() << "Reserved uids" << m_NextUid << "-" << m_LastUid << "in MySql DB";
+		return true;
 	}
-	
-	return uid;
+
+	return false;
 }
 
 int DBWorker::GetUIDbyNick(const QString &nickname)
 {
-	int uid = -1;
+	// Index know only nicknames of this node, other nodes can add more, so miss checked in DB
+	int uid = pNicknameIndex->IsReady() ? pNicknameIndex->GetUid(nickname) : -1;
+
+	if (uid > 0)
+		return uid;
 
 	// Redis
 	if (pRedis)
@@ -353,6 +506,7 @@ int DBWorker::GetUIDbyNick(const QString &nickname)
 				qDebug() << "UID for" << nickname << "found in Redis DB";
 
 				uid = buff.toInt();
+				pNicknameIndex->Add(nickname, uid);
 				return uid;
 			}
 			else
@@ -371,18 +525,20 @@ int DBWorker::GetUIDbyNick(const QString &nickname)
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT * FROM profiles WHERE nickname=:nickname") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM profiles WHERE nickname=:nickname");
 			query->bindValue(":nickname", nickname);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				if (query->next())
 				{
 					qDebug() << "UID for" << nickname << "found in MySql DB";
 					uid = query->value(0).toInt();
+					pNicknameIndex->Add(nickname, uid);
 					return uid;
 				}
 				else
@@ -407,10 +563,104 @@ int DBWorker::GetUIDbyNick(const QString &nickname)
 	return uid;
 }
 
-SUser* DBWorker::GetUserData(const QString &login)
+bool DBWorker::ReadUser(const QVector<std::pair<std::string, std::string>> &fields, SUser &user)
+{
+	user.uid = 0;
+	user.login = QString();
+	user.password = QString();
+	user.bBanStatus = false;
+
+	for (auto it = fields.begin(); it != fields.end(); ++it)
+	{
+		if (it->first == "uid")
+			user.uid = std::atoi(it->second.c_str());
+		else if (it->first == "login")
+			user.login = it->second.c_str();
+		else if (it->first == "password")
+			user.password = it->second.c_str();
+		else if (it->first == "ban")
+			user.bBanStatus = std::atoi(it->second.c_str()) > 0;
+	}
+
+	return user.uid > 0 && !user.login.isEmpty() && !user.password.isEmpty();
+}
+
+bool DBWorker::ReadProfile(const QVector<std::pair<std::string, std::string>> &fields, SProfile &profile)
+{
+	profile.uid = 0;
+	profile.nickname = QString();
+	profile.fileModel = QString();
+	profile.lvl = 0;
+	profile.xp = 0;
+	profile.money = 0;
+	profile.items.clear();
+	profile.friends.clear();
+
+	for (auto it = fields.begin(); it != fields.end(); ++it)
+	{
+		if (it->first == "uid")
+			profile.uid = std::atoi(it->second.c_str());
+		else if (it->first == "nickname")
+			profile.nickname = it->second.c_str();
+		else if (it->first == "fileModel")
+			profile.fileModel = it->second.c_str();
+		else if (it->first == "lvl")
+			profile.lvl = std::atoi(it->second.c_str());
+		else if (it->first == "xp")
+			profile.xp = std::atoi(it->second.c_str());
+		else if (it->first == "money")
+			profile.money = std::atoi(it->second.c_str());
+	}
+
+	return profile.uid > 0 && !profile.nickname.isEmpty() && !profile.fileModel.isEmpty();
+}
+
+void DBWorker::ReadProfile(const QSqlQuery &query, SProfile &profile)
+{
+	profile.uid = query.value("uid").toInt();
+	profile.nickname = query.value("nickname").toString();
+	profile.fileModel = query.value("fileModel").toString();
+	profile.lvl = query.value("lvl").toInt();
+	profile.xp = query.value("xp").toInt();
+	profile.money = query.value("money").toInt();
+	profile.items.clear();
+	profile.friends.clear();
+}
+
+void DBWorker::ReadProfileLists(const SRedisReply &items, const SRedisReply &friends, SProfile &profile)
+{
+	for (auto it = items.elements.begin(); it != items.elements.end(); ++it)
+		profile.items.insert(QString::fromUtf8(it->string));
+
+	for (auto it = friends.elements.begin(); it != friends.elements.end(); ++it)
+		profile.friends.insert(it->string.toInt());
+}
+
+bool DBWorker::ReadProfileLists(MySqlConnection *pConnection, SProfile &profile)
 {
-	SUser *dbUser = new SUser;
+	QSqlQuery* items = pConnection->Prepare("SELECT item FROM profile_items WHERE uid=:uid");
+	QSqlQuery* friends = pConnection->Prepare("SELECT friend_uid FROM profile_friends WHERE uid=:uid");
+
+	if (!items || !friends)
+		return false;
+
+	items->bindValue(":uid", profile.uid);
+	friends->bindValue(":uid", profile.uid);
 
+	if (!pConnection->Exec(items) || !pConnection->Exec(friends))
+		return false;
+
+	while (items->next())
+		profile.items.insert(items->value(0).toString());
+
+	while (friends->next())
+		profile.friends.insert(friends->value(0).toInt());
+
+	return true;
+}
+
+bool DBWorker::GetUserData(const QString &login, SUser &user)
+{
 	// Redis
 	if (pRedis)
 	{
@@ -419,308 +669,388 @@ SUser* DBWorker::GetUserData(const QString &login)
 			QString key = "users:" + login;
 			QVector<std::pair<std::string, std::string>> result = pRedis->HGETALL(key);
 
-			int dbUid = 0;
-			QString dbLogin = QString();
-			QString dbPassword = QString();
-			int dbBanStatus = 0;
-
 			if (result.size() > 0)
 			{
-				for (auto it = result.begin(); it!= result.end(); ++it)
-				{
-					if (it->first == "uid")
-						dbUid = std::atoi(it->second.c_str());
-					else if (it->first == "login")
-						dbLogin = it->second.c_str();
-					else if (it->first == "password")
-						dbPassword = it->second.c_str();
-					else if (it->first == "ban")
-					{
-						dbBanStatus = std::atoi(it->second.c_str());
-						break;
-					}
-				}
-
-				if (dbUid > 0 && !dbLogin.isEmpty() && !dbPassword.isEmpty())
+				if (ReadUser(result, user))
 				{
 					qDebug() << "User data for" << login << "is found in Redis DB";
-
-					dbUser->uid = dbUid;
-					dbUser->login = dbLogin;
-					dbUser->password = dbPassword;
-
-					if (dbBanStatus > 0)
-						dbUser->bBanStatus = true;
-					else
-						dbUser->bBanStatus = false;
-
-					return dbUser;
+					return true;
 				}
 				else
 				{
 					qWarning() << "Wrong user data for" << login;
-					return nullptr;
+					return false;
 				}
 			}
 			else
 			{
 				qDebug() << "User data for" << login << "not found in Redis DB";
-				return nullptr;
+				return false;
 			}		
 		}
 		else
 		{
 			qCritical() << "Failed found login" << login << "in Redis DB because Redis DB not opened!";
-			return nullptr;
+			return false;
 		}
 	}
 	
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT * FROM users WHERE login=:login") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM users WHERE login=:login");
 			query->bindValue(":login", login);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				if (query->next())
 				{
 					qDebug() << "User data for" << login << "is found in MySql DB";
-					dbUser->uid = query->value("uid").toInt(); // uid
-					dbUser->login = query->value("login").toString(); // login
-					dbUser->password = query->value("password").toString(); // password
-					int dbBanStatus = query->value("ban").toInt(); // ban status
+					user.uid = query->value("uid").toInt();
+					user.login = query->value("login").toString();
+					user.password = query->value("password").toString();
+					user.bBanStatus = query->value("ban").toInt() > 0;
 
-					if (dbBanStatus > 0)
-						dbUser->bBanStatus = true;
-					else
-						dbUser->bBanStatus = false;
-
-					return dbUser;
+					return true;
 				}
 				else
 				{
 					qDebug() << "User data for" << login << "not found in MySql DB";
-					return nullptr;
+					return false;
 				}
 			}
 			else
 			{
 				qWarning() << "Failed send query to MySql DB";
-				return nullptr;
+				return false;
 			}
 		}
 		else
 		{
 			qCritical() << "Failed found login" << login << "in MySql DB because MySql DB not opened!";
-			return nullptr;
+			return false;
 		}
 	}
 	
-	return nullptr;
+	return false;
 }
 
-SProfile* DBWorker::GetUserProfile(int uid)
+SProfilePtr DBWorker::GetUserProfile(int uid)
 {
-	SProfile *dbProfile = new SProfile;
+	SProfilePtr profile = LoadUserProfile(uid);
 
+	if (profile)
+		pProfileCache->Apply(*profile);
+
+	return profile;
+}
+
+SProfilePtr DBWorker::LoadUserProfile(int uid)
+{
 	// Redis
 	if (pRedis)
 	{
 		if (pRedis->IsConnected())
 		{
 			QString key = "profiles:" + QString::number(uid);
-			QVector<std::pair<std::string, std::string>> result = pRedis->HGETALL(key);
 
-			int dbUid = 0;
-			QString dbNickname = QString();
-			QString dbModel = QString();
-			int dbLvl = 0;
-			int dbXp = 0;
-			int dbMoney = 0;
-			QString dbItems = QString();
-			QString dbFriends = QString();
+			// Profile and his lists readed in one round trip
+			QVector<SRedisReply> replies = pRedis->Pipeline({
+				{ "HGETALL", key.toUtf8() },
+				{ "SMEMBERS", ItemsKey(uid).toUtf8() },
+				{ "SMEMBERS", FriendsKey(uid).toUtf8() } });
 
+			QVector<std::pair<std::string, std::string>> result = replies.size() == 3 ? RedisConnector::ToPairs(replies[0]) : QVector<std::pair<std::string, std::string>>();
 
 			if (result.size() > 0)
 			{
-				for (auto it = result.begin(); it != result.end(); ++it)
-				{
-					if (it->first == "uid")
-						dbUid = std::atoi(it->second.c_str());
-					else if (it->first == "nickname")
-						dbNickname = it->second.c_str();
-					else if (it->first == "fileModel")
-						dbModel = it->second.c_str();
-					else if (it->first == "lvl")
-						dbLvl = std::atoi(it->second.c_str());
-					else if (it->first == "xp")
-						dbXp = std::atoi(it->second.c_str());
-					else if (it->first == "money")
-						dbMoney = std::atoi(it->second.c_str());
-					else if (it->first == "items")
-						dbItems = it->second.c_str();
-					else if (it->first == "friends")
-					{
-						dbFriends = it->second.c_str();
-						break;
-					}
-				}
+				SProfilePtr dbProfile(new SProfile);
 
-				if (dbUid > 0 && !dbNickname.isEmpty() && !dbModel.isEmpty())
+				if (ReadProfile(result, *dbProfile))
 				{
-					qDebug() << "Profile" << uid << "is found in Redis DB";
-
-					dbProfile->uid = dbUid;
-					dbProfile->nickname = dbNickname;
-					dbProfile->fileModel = dbModel;
-					dbProfile->lvl = dbLvl;
-					dbProfile->xp = dbXp;
-					dbProfile->money = dbMoney;
-					dbProfile->items = dbItems;
-					dbProfile->friends = dbFriends;
+					ReadProfileLists(replies[1], replies[2], *dbProfile);
 
+					qDebug() << "Profile" << uid << "is found in Redis DB";
 					return dbProfile;
 				}
 				else
 				{
 					qWarning() << "Wrong profile data for" << uid;
-					return nullptr;
+					return SProfilePtr();
 				}
 			}
 			else
 			{
 				qDebug() << "Profile" << uid << "not found in Redis DB";
-				return nullptr;
+				return SProfilePtr();
 			}		
 		}
 		else
 		{
 			qCritical() << "Failed found profile" << uid << "in Redis DB because Redis DB not connected!";
-			return nullptr;
+			return SProfilePtr();
 		}
 	}
 
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT * FROM profiles WHERE uid=:uid") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("SELECT * FROM profiles WHERE uid=:uid");
 			query->bindValue(":uid", uid);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				if (query->next())
 				{
 					qDebug() << "Profile" << uid << "is found in MySql DB";
 
-					dbProfile->uid = query->value("uid").toInt();
-					dbProfile->nickname = query->value("nickname").toString();
-					dbProfile->fileModel = query->value("fileModel").toString();
-					dbProfile->lvl = query->value("lvl").toInt();
-					dbProfile->xp = query->value("xp").toInt();
-					dbProfile->money = query->value("money").toInt();
-					dbProfile->items = query->value("items").toString();
-					dbProfile->friends = query->value("friends").toString();
+					SProfilePtr dbProfile(new SProfile);
+					ReadProfile(*query, *dbProfile);
+
+					if (!ReadProfileLists(pConnection, *dbProfile))
+					{
+						qWarning() << "Failed read items and friends of profile" << uid << "from MySql DB";
+						return SProfilePtr();
+					}
 
 					return dbProfile;
 				}
 				else
 				{
 					qDebug() << "Profile" << uid << "not found in MySql DB";
-					return nullptr;
+					return SProfilePtr();
 				}
 			}
 			else
 			{
 				qWarning() << "Failed send query to MySql DB";
-				return nullptr;
+				return SProfilePtr();
 			}
 		}
 		else
 		{
 			qCritical() << "Failed found profile" << uid << "in MySql DB because MySql DB not opened!";
-			return nullptr;
+			return SProfilePtr();
 		}
 	}
 	
-	return nullptr;
+	return SProfilePtr();
 }
 
-bool DBWorker::CreateUser(int uid, const QString &login, const QString &password)
+// User and his profile are readed together. Profile stay nullptr if user don't create it yet
+bool DBWorker::GetLoginData(const QString &login, SUser &user, SProfilePtr &profile)
 {
-	SettingsManager* pSettings = gEnv->pSettings;
-	bool result = false;
+	if (!LoadLoginData(login, user, profile))
+		return false;
+
+	if (profile)
+		pProfileCache->Apply(*profile);
+
+	return true;
+}
+
+bool DBWorker::LoadLoginData(const QString &login, SUser &user, SProfilePtr &profile)
+{
+	profile.clear();
 
 	// Redis
 	if (pRedis)
 	{
 		if (pRedis->IsConnected())
 		{
+			// Profile key known only after user readed, so both reads done by server script
+			static const QByteArray script =
+				"local user = redis.call('HGETALL', KEYS[1]) "
+				"local uid = nil "
+				"for i = 1, #user, 2 do if user[i] == 'uid' then uid = user[i + 1] end end "
+				"if not uid then return { user, {}, {}, {} } end "
+				"local key = 'profiles:' .. uid "
+				"return { user, redis.call('HGETALL', key), redis.call('SMEMBERS', key .. ':items'), redis.call('SMEMBERS', key .. ':friends') }";
+
 			QString key = "users:" + login;
-			std::vector<std::pair<std::string, std::string>> field;
+			SRedisReply reply = pRedis->EVAL(script, { key.toUtf8() });
 
-			std::pair<std::string, std::string> row_uid;
-			row_uid.first = "uid";
-			row_uid.second = std::to_string(uid);
+			if (reply.type != SRedisReply::Array || reply.elements.size() != 4)
+			{
+				qWarning() << "Failed get login data for" << login << "from Redis DB -" << reply.string;
+				return false;
+			}
 
-			std::pair<std::string, std::string> row_login;
-			row_login.first = "login";
-			row_login.second = login.toStdString();
-			
-			std::pair<std::string, std::string> row_password;
-			row_password.first = "password";
-			row_password.second = password.toStdString();
+			QVector<std::pair<std::string, std::string>> userFields = RedisConnector::ToPairs(reply.elements[0]);
+			QVector<std::pair<std::string, std::string>> profileFields = RedisConnector::ToPairs(reply.elements[1]);
 
-			std::pair<std::string, std::string> row_ban;
-			row_ban.first = "ban";
-			row_ban.second = "0";
+			if (userFields.isEmpty())
+			{
+				qDebug() << "User data for" << login << "not found in Redis DB";
+				return false;
+			}
 
-			field.push_back(row_uid);
-			field.push_back(row_login);
-			field.push_back(row_password);
-			field.push_back(row_ban);
+			if (!ReadUser(userFields, user))
+			{
+				qWarning() << "Wrong user data for" << login;
+				return false;
+			}
 
-			result = pRedis->HMSET(key, field);
+			if (!profileFields.isEmpty())
+			{
+				SProfilePtr dbProfile(new SProfile);
+
+				if (ReadProfile(profileFields, *dbProfile))
+				{
+					ReadProfileLists(reply.elements[2], reply.elements[3], *dbProfile);
+					profile = dbProfile;
+				}
+				else
+					qWarning() << "Wrong profile data for" << user.uid;
+			}
+
+			qDebug() << "Login data for" << login << "is found in Redis DB";
+			return true;
 		}
 		else
 		{
-			qCritical() << "Failed create user" << login << "in Redis DB because Redis DB not connected!";
+			qCritical() << "Failed found login" << login << "in Redis DB because Redis DB not opened!";
 			return false;
 		}
 	}
-	
+
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("SELECT users.uid, users.login, users.password, users.ban, "
+			"profiles.nickname, profiles.fileModel, profiles.lvl, profiles.xp, profiles.money "
+			"FROM users LEFT JOIN profiles ON profiles.uid = users.uid WHERE users.login=:login") : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("INSERT INTO users (uid, login, password, ban) VALUES (:uid, :login, :password, :ban)");
-			query->bindValue(":uid", uid);
 			query->bindValue(":login", login);
-			query->bindValue(":password", password);
-			query->bindValue(":ban", 0);
 
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
-				qDebug() << "User" << login << "created in MySql DB";
-				result = true;
+				if (query->next())
+				{
+					qDebug() << "Login data for" << login << "is found in MySql DB";
+
+					user.uid = query->value("uid").toInt();
+					user.login = query->value("login").toString();
+					user.password = query->value("password").toString();
+					user.bBanStatus = query->value("ban").toInt() > 0;
+
+					if (!query->value("nickname").isNull())
+					{
+						profile = SProfilePtr(new SProfile);
+						ReadProfile(*query, *profile);
+
+						if (!ReadProfileLists(pConnection, *profile))
+						{
+							qWarning() << "Failed read items and friends of profile" << user.uid << "from MySql DB";
+							return false;
+						}
+					}
+
+					return true;
+				}
+				else
+				{
+					qDebug() << "User data for" << login << "not found in MySql DB";
+					return false;
+				}
 			}
 			else
 			{
-				qWarning() << "Failed create user" << login << "in MySql DB";
+				qWarning() << "Failed send query to MySql DB";
 				return false;
 			}
 		}
 		else
 		{
-			qCritical() << "Failed create user" << login << "in MySql DB because MySql DB not opened!";
+			qCritical() << "Failed found login" << login << "in MySql DB because MySql DB not opened!";
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool DBWorker::CreateUser(int uid, const QString &login, const QString &password)
+{
+	SettingsManager* pSettings = gEnv->pSettings;
+	bool result = false;
+
+	// Redis
+	if (pRedis)
+	{
+		if (pRedis->IsConnected())
+		{
+			QString key = "users:" + login;
+			std::vector<std::pair<std::string, std::string>> field;
+
+			std::pair<std::string, std::string> row_uid;
+			row_uid.first = "uid";
+			row_uid.second = std::to_string(uid);
+
+			std::pair<std::string, std::string> row_login;
+			row_login.first = "login";
+			row_login.second = login.toStdString();
+			
+			std::pair<std::string, std::string> row_password;
+			row_password.first = "password";
+			row_password.second = password.toStdString();
+
+			std::pair<std::string, std::string> row_ban;
+			row_ban.first = "ban";
+			row_ban.second = "0";
+
+			field.push_back(row_uid);
+			field.push_back(row_login);
+			field.push_back(row_password);
+			field.push_back(row_ban);
+
+			result = pRedis->HMSET(key, field);
+		}
+		else
+		{
+			qCritical() << "Failed create user" << login << "in Redis DB because Redis DB not connected!";
+			return false;
+		}
+	}
+	
+	// MySql
+	if (pMySql)
+	{
+		MySqlConnection* pConnection = pMySql->GetConnection();
+		QSqlQuery* query = pConnection ? pConnection->Prepare("INSERT INTO users (uid, login, password, ban) VALUES (:uid, :login, :password, :ban)") : nullptr;
+
+		if (query)
+		{
+			query->bindValue(":uid", uid);
+			query->bindValue(":login", login);
+			query->bindValue(":password", password);
+			query->bindValue(":ban", 0);
+
+			if (pConnection->Exec(query))
+			{
+				qDebug() << "User" << login << "created in MySql DB";
+				result = true;
+			}
+			else
+			{
+				qWarning() << "Failed create user" << login << "in MySql DB";
+				return false;
+			}
+		}
+		else
+		{
+			qCritical() << "Failed create user" << login << "in MySql DB because MySql DB not opened!";
 			return false;
 		}
 	}
@@ -766,14 +1096,6 @@ bool DBWorker::CreateProfile(SProfile *profile)
 			row_money.first = "money";
 			row_money.second = std::to_string(profile->money);
 
-			std::pair<std::string, std::string> row_items;
-			row_items.first = "items";
-			row_items.second = profile->items.toStdString();
-
-			std::pair<std::string, std::string> row_friends;
-			row_friends.first = "friends";
-			row_friends.second = profile->friends.toStdString();
-
 			QString key = "profiles:" + QString::number(profile->uid);
 			QString key2 = "nicknames:" + profile->nickname;
 
@@ -785,10 +1107,19 @@ bool DBWorker::CreateProfile(SProfile *profile)
 			field.push_back(row_lvl);
 			field.push_back(row_xp);
 			field.push_back(row_money);
-			field.push_back(row_items);
-			field.push_back(row_friends);
 
-			if (pRedis->HMSET(key, field) && pRedis->SET(key2, QString::number(profile->uid)))
+			// Nickname taken atomically, other server nodes can create same nickname at same time
+			QVector<SRedisReply> reserved = pRedis->Pipeline({ { "SET", key2.toUtf8(), QByteArray::number(profile->uid), "NX" } });
+
+			if (reserved.size() != 1 || !reserved[0].IsOk())
+			{
+				qDebug() << "Failed create" << profile->nickname << "profile in Redis DB. Nickname alredy taken";
+				return false;
+			}
+
+			QVector<SRedisReply> replies = pRedis->Pipeline({ RedisConnector::MakeHMSET(key, field) });
+
+			if (replies.size() == 1 && replies[0].IsOk())
 			{
 				qDebug() << "Profile" << profile->nickname << "created in Redis DB";
 				result = true;
@@ -796,6 +1127,7 @@ bool DBWorker::CreateProfile(SProfile *profile)
 			else
 			{
 				qDebug() << "Failed create" << profile->nickname << " profile in Redis DB";
+				pRedis->Pipeline({ { "DEL", key2.toUtf8() } });
 				return false;
 			}
 		}
@@ -809,22 +1141,27 @@ bool DBWorker::CreateProfile(SProfile *profile)
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+
+		// Old list columns can be NOT NULL without default, they get empty lists. Real lists are in own tables
+		QString sql = bOldProfileColumns ?
+			"INSERT INTO profiles (uid, nickname, fileModel, lvl, xp, money, items, friends) "
+			"VALUES (:uid, :nickname, :fileModel, :lvl, :xp, :money, '', '')" :
+			"INSERT INTO profiles (uid, nickname, fileModel, lvl, xp, money) "
+			"VALUES (:uid, :nickname, :fileModel, :lvl, :xp, :money)";
+
+		QSqlQuery* query = pConnection ? pConnection->Prepare(sql) : nullptr;
+
+		if (query)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("INSERT INTO profiles (uid, nickname, fileModel, lvl, xp, money, items, friends) "
-				"VALUES (:uid, :nickname, :fileModel, :lvl, :xp, :money, :items, :friends)");
 			query->bindValue(":uid", profile->uid);
 			query->bindValue(":nickname", profile->nickname);
 			query->bindValue(":fileModel", profile->fileModel);
 			query->bindValue(":lvl", profile->lvl);
 			query->bindValue(":xp", profile->xp);
 			query->bindValue(":money", profile->money);
-			query->bindValue(":items", profile->items);
-			query->bindValue(":friends", profile->friends);
 
-
-			if (query->exec())
+			if (pConnection->Exec(query))
 			{
 				qDebug() << "Profile" << profile->nickname << "created in MySql DB";
 				result = true;
@@ -842,6 +1179,9 @@ bool DBWorker::CreateProfile(SProfile *profile)
 		}
 	}
 	
+	if (result)
+		pNicknameIndex->Add(profile->nickname, profile->uid);
+
 	// Redis background saving
 	if (pRedis && pSettings->GetVariable("redis_bg_saving").toBool() && result)
 		pRedis->BGSAVE();
@@ -849,9 +1189,11 @@ bool DBWorker::CreateProfile(SProfile *profile)
 	return result;
 }
 
-bool DBWorker::UpdateProfile(SProfile *profile)
+bool DBWorker::WriteProfiles(const QVector<SProfileWrite> &batch)
 {
-	SettingsManager* pSettings = gEnv->pSettings;
+	if (batch.isEmpty())
+		return true;
+
 	bool result = false;
 
 	// Redis
@@ -859,107 +1201,492 @@ bool DBWorker::UpdateProfile(SProfile *profile)
 	{
 		if (pRedis->IsConnected())
 		{
-			std::pair<std::string, std::string> row_uid;
-			row_uid.first = "uid";
-			row_uid.second = std::to_string(profile->uid);
-
-			std::pair<std::string, std::string> row_nickname;
-			row_nickname.first = "nickname";
-			row_nickname.second = profile->nickname.toStdString();
-
-			std::pair<std::string, std::string> row_filemodel;
-			row_filemodel.first = "fileModel";
-			row_filemodel.second = profile->fileModel.toStdString();
-
-			std::pair<std::string, std::string> row_lvl;
-			row_lvl.first = "lvl";
-			row_lvl.second = std::to_string(profile->lvl);
-
-			std::pair<std::string, std::string> row_xp;
-			row_xp.first = "xp";
-			row_xp.second = std::to_string(profile->xp);
-
-			std::pair<std::string, std::string> row_money;
-			row_money.first = "money";
-			row_money.second = std::to_string(profile->money);
+			QVector<QList<QByteArray>> commands;
+			commands.reserve(batch.size());
 
-			std::pair<std::string, std::string> row_items;
-			row_items.first = "items";
-			row_items.second = profile->items.toStdString();
+			for (auto it = batch.begin(); it != batch.end(); ++it)
+			{
+				std::vector<std::pair<std::string, std::string>> field;
 
-			std::pair<std::string, std::string> row_friends;
-			row_friends.first = "friends";
-			row_friends.second = profile->friends.toStdString();
+				for (int i = 0; i < PROFILE_COLUMNS_COUNT; ++i)
+				{
+					if (it->fields & s_ProfileColumns[i].field)
+						field.push_back(std::make_pair(std::string(s_ProfileColumns[i].name), ProfileValue(it->profile, s_ProfileColumns[i].field).toString().toStdString()));
+				}
 
-			QString key = "profiles:" + QString::number(profile->uid);
-			QString key2 = "nicknames:" + profile->nickname;
+				if (!field.empty())
+					commands.push_back(RedisConnector::MakeHMSET("profiles:" + QString::number(it->profile.uid), field));
 
-			std::vector<std::pair<std::string, std::string>> field;
+				AppendListCommands(*it, commands);
+			}
 
-			field.push_back(row_uid);
-			field.push_back(row_nickname);
-			field.push_back(row_filemodel);
-			field.push_back(row_lvl);
-			field.push_back(row_xp);
-			field.push_back(row_money);
-			field.push_back(row_items);
-			field.push_back(row_friends);
+			// All changed profiles written in one round trip
+			QVector<SRedisReply> replies = pRedis->Pipeline(commands);
 
-			if (pRedis->HMSET(key, field))
+			if (replies.size() != commands.size())
 			{
-				qDebug() << "Profile" << profile->nickname << "updated in Redis DB";
-				result = true;
+				qWarning() << "Failed update profiles in Redis DB";
+				return false;
 			}
-			else
+
+			for (auto it = replies.begin(); it != replies.end(); ++it)
 			{
-				qDebug() << "Failed update profile" << profile->nickname << " in Redis DB";
-				return false;
+				if (it->IsError())
+				{
+					qWarning() << "Failed update profiles in Redis DB -" << it->string;
+					return false;
+				}
 			}
+
+			qDebug() << batch.size() << "profiles updated in Redis DB";
+			result = true;
 		}
 		else
 		{
-			qCritical() << "Failed update profile" << profile->nickname << "in Redis DB because Redis DB not connected!";
+			qCritical() << "Failed update profiles in Redis DB because Redis DB not connected!";
 			return false;
 		}
 	}
-	
+
 	// MySql
 	if (pMySql)
 	{
-		if (pMySql->IsConnected())
+		MySqlConnection* pConnection = pMySql->GetConnection();
+
+		if (pConnection)
 		{
-			QSqlQuery *query = new QSqlQuery(pMySql->GetDatabase());
-			query->prepare("UPDATE profiles SET nickname=:nickname, fileModel=:fileModel, lvl=:lvl, xp=:xp, money=:money, items=:items, friends=:friends WHERE uid=:uid");
-			query->bindValue(":uid", profile->uid);
-			query->bindValue(":nickname", profile->nickname);
-			query->bindValue(":fileModel", profile->fileModel);
-			query->bindValue(":lvl", profile->lvl);
-			query->bindValue(":xp", profile->xp);
-			query->bindValue(":money", profile->money);
-			query->bindValue(":items", profile->items);
-			query->bindValue(":friends", profile->friends);
+			for (auto it = batch.begin(); it != batch.end(); ++it)
+			{
+				// Only changed columns updated, statement for every set of columns cached by connection
+				QStringList columns;
+
+				for (int i = 0; i < PROFILE_COLUMNS_COUNT; ++i)
+				{
+					if (it->fields & s_ProfileColumns[i].field)
+						columns.push_back(QString("%1=:%1").arg(s_ProfileColumns[i].name));
+				}
+
+				if (!columns.isEmpty())
+				{
+					QSqlQuery* query = pConnection->Prepare("UPDATE profiles SET " + columns.join(", ") + " WHERE uid=:uid");
+
+					if (!query)
+					{
+						qWarning() << "Failed prepare profile update query for MySql DB";
+						return false;
+					}
+
+					query->bindValue(":uid", it->profile.uid);
 
-			if (query->exec())
+					for (int i = 0; i < PROFILE_COLUMNS_COUNT; ++i)
+					{
+						if (it->fields & s_ProfileColumns[i].field)
+							query->bindValue(QString(":") + s_ProfileColumns[i].name, ProfileValue(it->profile, s_ProfileColumns[i].field));
+					}
+
+					if (!pConnection->Exec(query))
+					{
+						qWarning() << "Failed update profile" << it->profile.uid << "in MySql DB";
+						return false;
+					}
+				}
+
+				if (!WriteProfileLists(pConnection, *it))
+				{
+					qWarning() << "Failed update items and friends of profile" << it->profile.uid << "in MySql DB";
+					return false;
+				}
+			}
+
+			qDebug() << batch.size() << "profiles updated in MySql DB";
+			result = true;
+		}
+		else
+		{
+			qCritical() << "Failed update profiles in MySql DB because MySql DB not opened!";
+			return false;
+		}
+	}
+
+	return result;
+}
+
+void DBWorker::AppendListCommands(const SProfileWrite &write, QVector<QList<QByteArray>> &commands)
+{
+	const SProfileDelta &delta = write.delta;
+
+	if (write.fields & ProfileItems)
+	{
+		const QByteArray key = ItemsKey(write.profile.uid).toUtf8();
+		const QSet<QString> &add = delta.bReplaceItems ? write.profile.items : delta.addItems;
+
+		if (delta.bReplaceItems)
+			commands.push_back({ "DEL", key });
+
+		if (!add.isEmpty())
+		{
+			QList<QByteArray> sadd = { "SADD", key };
+			for (auto it = add.begin(); it != add.end(); ++it)
+				sadd.push_back(it->toUtf8());
+			commands.push_back(sadd);
+		}
+
+		if (!delta.bReplaceItems && !delta.removeItems.isEmpty())
+		{
+			QList<QByteArray> srem = { "SREM", key };
+			for (auto it = delta.removeItems.begin(); it != delta.removeItems.end(); ++it)
+				srem.push_back(it->toUtf8());
+			commands.push_back(srem);
+		}
+	}
+
+	if (write.fields & ProfileFriends)
+	{
+		const QByteArray key = FriendsKey(write.profile.uid).toUtf8();
+		const QSet<int> &add = delta.bReplaceFriends ? write.profile.friends : delta.addFriends;
+
+		if (delta.bReplaceFriends)
+			commands.push_back({ "DEL", key });
+
+		// Small integer sets kept by Redis in compact intset encoding
+		if (!add.isEmpty())
+		{
+			QList<QByteArray> sadd = { "SADD", key };
+			for (auto it = add.begin(); it != add.end(); ++it)
+				sadd.push_back(QByteArray::number(*it));
+			commands.push_back(sadd);
+		}
+
+		if (!delta.bReplaceFriends && !delta.removeFriends.isEmpty())
+		{
+			QList<QByteArray> srem = { "SREM", key };
+			for (auto it = delta.removeFriends.begin(); it != delta.removeFriends.end(); ++it)
+				srem.push_back(QByteArray::number(*it));
+			commands.push_back(srem);
+		}
+	}
+}
+
+bool DBWorker::WriteProfileLists(MySqlConnection *pConnection, const SProfileWrite &write)
+{
+	const SProfileDelta &delta = write.delta;
+	const int uid = write.profile.uid;
+
+	if (write.fields & ProfileItems)
+	{
+		QSqlQuery* clear = pConnection->Prepare("DELETE FROM profile_items WHERE uid=:uid");
+		QSqlQuery* insert = pConnection->Prepare("INSERT IGNORE INTO profile_items (uid, item) VALUES (:uid, :item)");
+		QSqlQuery* remove = pConnection->Prepare("DELETE FROM profile_items WHERE uid=:uid AND item=:item");
+
+		if (!clear || !insert || !remove)
+			return false;
+
+		if (delta.bReplaceItems)
+		{
+			clear->bindValue(":uid", uid);
+			if (!pConnection->Exec(clear))
+				return false;
+		}
+
+		const QSet<QString> &add = delta.bReplaceItems ? write.profile.items : delta.addItems;
+
+		for (auto it = add.begin(); it != add.end(); ++it)
+		{
+			insert->bindValue(":uid", uid);
+			insert->bindValue(":item", *it);
+			if (!pConnection->Exec(insert))
+				return false;
+		}
+
+		for (auto it = delta.removeItems.begin(); it != delta.removeItems.end() && !delta.bReplaceItems; ++it)
+		{
+			remove->bindValue(":uid", uid);
+			remove->bindValue(":item", *it);
+			if (!pConnection->Exec(remove))
+				return false;
+		}
+	}
+
+	if (write.fields & ProfileFriends)
+	{
+		QSqlQuery* clear = pConnection->Prepare("DELETE FROM profile_friends WHERE uid=:uid");
+		QSqlQuery* insert = pConnection->Prepare("INSERT IGNORE INTO profile_friends (uid, friend_uid) VALUES (:uid, :friend)");
+		QSqlQuery* remove = pConnection->Prepare("DELETE FROM profile_friends WHERE uid=:uid AND friend_uid=:friend");
+
+		if (!clear || !insert || !remove)
+			return false;
+
+		if (delta.bReplaceFriends)
+		{
+			clear->bindValue(":uid", uid);
+			if (!pConnection->Exec(clear))
+				return false;
+		}
+
+		const QSet<int> &add = delta.bReplaceFriends ? write.profile.friends : delta.addFriends;
+
+		for (auto it = add.begin(); it != add.end(); ++it)
+		{
+			insert->bindValue(":uid", uid);
+			insert->bindValue(":friend", *it);
+			if (!pConnection->Exec(insert))
+				return false;
+		}
+
+		for (auto it = delta.removeFriends.begin(); it != delta.removeFriends.end() && !delta.bReplaceFriends; ++it)
+		{
+			remove->bindValue(":uid", uid);
+			remove->bindValue(":friend", *it);
+			if (!pConnection->Exec(remove))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Items and friends was comma separated strings inside profile, move them to sets and tables once
+void DBWorker::MigrateProfileLists()
+{
+	// Redis
+	if (pRedis && pRedis->IsConnected())
+	{
+		const QByteArray prefix = "profiles:";
+		QByteArray cursor = "0";
+		int migrated = 0;
+
+		do
+		{
+			QVector<SRedisReply> scan = pRedis->Pipeline({ { "SCAN", cursor, "MATCH", prefix + "*", "COUNT", "1000" } });
+
+			if (scan.size() != 1 || scan[0].type != SRedisReply::Array || scan[0].elements.size() != 2)
 			{
-				qDebug() << "Profile" << profile->nickname << "updated in MySql DB";
-				result = true;
+				qCritical() << "Failed scan profiles in Redis DB for migration!";
+				return;
 			}
-			else
+
+			cursor = scan[0].elements[0].string;
+
+			// Only profile hashes, not lists of them
+			QList<QByteArray> keys;
+			const QVector<SRedisReply> &found = scan[0].elements[1].elements;
+
+			for (auto it = found.begin(); it != found.end(); ++it)
 			{
-				qWarning() << "Failed update profile" << profile->nickname << "in MySql DB";
-				return false;
+				if (it->string.count(':') == 1)
+					keys.push_back(it->string);
 			}
+
+			if (keys.isEmpty())
+				continue;
+
+			QVector<QList<QByteArray>> reads;
+			for (auto it = keys.begin(); it != keys.end(); ++it)
+				reads.push_back({ "HMGET", *it, "uid", "items", "friends" });
+
+			QVector<SRedisReply> values = pRedis->Pipeline(reads);
+
+			if (values.size() != reads.size())
+			{
+				qCritical() << "Failed read profiles from Redis DB for migration!";
+				return;
+			}
+
+			QVector<QList<QByteArray>> writes;
+			// Commands of every profile, old fields removed only if all of them succeed
+			QVector<QPair<int, int>> ranges;
+			QList<QByteArray> written;
+
+			for (int i = 0; i < values.size(); ++i)
+			{
+				if (values[i].elements.size() != 3 || (values[i].elements[1].IsNull() && values[i].elements[2].IsNull()))
+					continue;
+
+				SProfileWrite write;
+				write.profile.uid = values[i].elements[0].string.toInt();
+				write.profile.items = ItemsFromString(QString::fromUtf8(values[i].elements[1].string));
+				write.profile.friends = FriendsFromString(QString::fromUtf8(values[i].elements[2].string));
+				write.fields = ProfileItems | ProfileFriends;
+				write.delta.bReplaceItems = true;
+				write.delta.bReplaceFriends = true;
+				write.version = 0;
+
+				if (write.profile.uid <= 0)
+					continue;
+
+				const int first = writes.size();
+				AppendListCommands(write, writes);
+				ranges.push_back(qMakePair(first, writes.size()));
+				written.push_back(keys[i]);
+			}
+
+			if (writes.isEmpty())
+				continue;
+
+			QVector<SRedisReply> replies = pRedis->Pipeline(writes);
+
+			if (replies.size() != writes.size())
+			{
+				qCritical() << "Failed write items and friends sets in Redis DB for migration!";
+				return;
+			}
+
+			QVector<QList<QByteArray>> removes;
+
+			for (int i = 0; i < ranges.size(); ++i)
+			{
+				bool bWritten = true;
+
+				for (int j = ranges[i].first; j < ranges[i].second; ++j)
+				{
+					if (replies[j].IsError())
+					{
+						qCritical() << "Failed migrate items and friends of" << written[i] << "in Redis DB -" << replies[j].string;
+						bWritten = false;
+						break;
+					}
+				}
+
+				if (bWritten)
+					removes.push_back({ "HDEL", written[i], "items", "friends" });
+			}
+
+			if (removes.isEmpty())
+				continue;
+
+			if (pRedis->Pipeline(removes).size() != removes.size())
+			{
+				qCritical() << "Failed remove old items and friends fields in Redis DB!";
+				return;
+			}
+
+			migrated += removes.size();
+		} while (cursor != "0");
+
+		if (migrated > 0)
+			qInfo() << "Items and friends of" << migrated << "profiles moved to sets in Redis DB";
+	}
+
+	// MySql
+	if (pMySql)
+	{
+		MySqlConnection* pConnection = pMySql->GetConnection();
+
+		if (!pConnection)
+		{
+			qCritical() << "Failed migrate profiles in MySql DB because MySql DB not opened!";
+			return;
+		}
+
+		// Lists copied only once, when tables created. Later they are newer than old columns
+		const QStringList tables = pConnection->GetDatabase().tables();
+		const bool bNewTables = !tables.contains("profile_items") || !tables.contains("profile_friends");
+
+		QSqlQuery* items = pConnection->Prepare("CREATE TABLE IF NOT EXISTS profile_items (uid INT NOT NULL, item VARCHAR(128) NOT NULL, PRIMARY KEY (uid, item))");
+		QSqlQuery* friends = pConnection->Prepare("CREATE TABLE IF NOT EXISTS profile_friends (uid INT NOT NULL, friend_uid INT NOT NULL, PRIMARY KEY (uid, friend_uid))");
+
+		if (!items || !friends || !pConnection->Exec(items) || !pConnection->Exec(friends))
+		{
+			qCritical() << "Failed create profile_items and profile_friends tables in MySql DB!";
+			return;
+		}
+
+		const QSqlRecord columns = pConnection->GetDatabase().record("profiles");
+
+		if (!columns.contains("items") || !columns.contains("friends"))
+			return;
+
+		bOldProfileColumns = true;
+
+		if (bNewTables && !MigrateMySqlProfileLists(pConnection))
+		{
+			// Next start try again from old columns
+			QSqlQuery drop(pConnection->GetDatabase());
+			drop.exec("DROP TABLE IF EXISTS profile_items, profile_friends");
+			return;
+		}
+
+		// Old columns stay until admin decide to remove them
+		if (!gEnv->pSettings->GetVariable("mysql_drop_old_profile_columns").toBool())
+			return;
+
+		QSqlQuery drop(pConnection->GetDatabase());
+
+		if (drop.exec("ALTER TABLE profiles DROP COLUMN items, DROP COLUMN friends"))
+		{
+			qInfo() << "Old items and friends columns removed from profiles table in MySql DB";
+			bOldProfileColumns = false;
 		}
 		else
+			qCritical() << "Failed remove old items and friends columns in MySql DB!";
+	}
+}
+
+// Server nodes sharing database can create same nickname at same time, only database can refuse it
+void DBWorker::CreateNicknameKey()
+{
+	if (!pMySql)
+		return;
+
+	MySqlConnection* pConnection = pMySql->GetConnection();
+
+	if (!pConnection)
+	{
+		qCritical() << "Failed check nicknames key in MySql DB because MySql DB not opened!";
+		return;
+	}
+
+	QSqlQuery check(pConnection->GetDatabase());
+
+	if (!check.exec("SHOW INDEX FROM profiles WHERE Column_name = 'nickname' AND Non_unique = 0"))
+	{
+		qCritical() << "Failed check nicknames key in MySql DB!";
+		return;
+	}
+
+	if (check.next())
+		return;
+
+	QSqlQuery create(pConnection->GetDatabase());
+
+	if (create.exec("ALTER TABLE profiles ADD UNIQUE KEY nickname_unique (nickname)"))
+		qInfo() << "Unique key for nicknames created in MySql DB";
+	else
+		qCritical() << "Failed create unique key for nicknames in MySql DB! Same nicknames must be renamed. Reason =" << create.lastError().text();
+}
+
+bool DBWorker::MigrateMySqlProfileLists(MySqlConnection *pConnection)
+{
+	QSqlQuery old(pConnection->GetDatabase());
+
+	if (!old.exec("SELECT uid, items, friends FROM profiles"))
+	{
+		qCritical() << "Failed read old items and friends columns in MySql DB!";
+		return false;
+	}
+
+	int migrated = 0;
+
+	while (old.next())
+	{
+		SProfileWrite write;
+		write.profile.uid = old.value(0).toInt();
+		write.profile.items = ItemsFromString(old.value(1).toString());
+		write.profile.friends = FriendsFromString(old.value(2).toString());
+		write.fields = ProfileItems | ProfileFriends;
+		write.delta.bReplaceItems = true;
+		write.delta.bReplaceFriends = true;
+		write.version = 0;
+
+		if (!WriteProfileLists(pConnection, write))
 		{
-			qCritical() << "Failed update profile" << profile->nickname << "in MySql DB because MySql DB not opened!";
+			qCritical() << "Failed migrate items and friends of profile" << write.profile.uid << "in MySql DB!";
 			return false;
 		}
+
+		migrated++;
 	}
-	
-	// Redis background saving
-	if (pRedis && pSettings->GetVariable("redis_bg_saving").toBool() && result)
-		pRedis->BGSAVE();
 
-	return result;
-}
\ No newline at end of file
+	qInfo() << "Items and friends of" << migrated << "profiles moved to tables in MySql DB";
+	return true;
+}
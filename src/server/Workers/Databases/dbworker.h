@@ -5,11 +5,22 @@
 #define DBWORKER_H
 
 #include <QObject>
+#include <QMutex>
+#include <QVector>
+
+#include <string>
 
 #include "global.h"
 
 class RedisConnector;
 class MySqlConnector;
+class MySqlConnection;
+struct SRedisReply;
+class DBTaskPool;
+class ProfileCache;
+class NicknameIndex;
+struct SProfileWrite;
+class QSqlQuery;
 
 class DBWorker : public QObject
 {
@@ -20,6 +31,12 @@ public:
 public:
 	void            Init();
 	void            Clear();
+	// Database work of client queries run here, not in network threads
+	DBTaskPool*     GetTaskPool() { return pTaskPool; }
+	// Profile changes go here, not to database
+	ProfileCache*   GetProfileCache() { return pProfileCache; }
+	// Nickname to uid of all players, answers without database when loaded
+	NicknameIndex*  GetNicknameIndex() { return pNicknameIndex; }
 public:
 	bool            UserExists(const QString &login);
 	bool            ProfileExists(int uid);
@@ -27,15 +44,47 @@ public:
 public:
 	int             GetFreeUID();
 	int             GetUIDbyNick(const QString &nickname);
-	SUser*          GetUserData(const QString &login);
-	SProfile*       GetUserProfile(int uid);
+	bool            GetUserData(const QString &login, SUser &user);
+	SProfilePtr     GetUserProfile(int uid);
+	// User data and profile for login in one database request
+	bool            GetLoginData(const QString &login, SUser &user, SProfilePtr &profile);
 public:
 	bool            CreateUser(int uid, const QString &login, const QString &password);
 	bool            CreateProfile(SProfile *profile);
-	bool            UpdateProfile(SProfile *profile);
+	// Write changed fields of profiles, used by profile cache
+	bool            WriteProfiles(const QVector<SProfileWrite> &batch);
+private:
+	// Take next uids block from shared counter, other server nodes get other blocks
+	bool            ReserveUIDBlock();
+	void            LoadNicknames();
+	void            MigrateProfileLists();
+	bool            MigrateMySqlProfileLists(MySqlConnection *pConnection);
+	void            CreateNicknameKey();
+
+	SProfilePtr     LoadUserProfile(int uid);
+	bool            LoadLoginData(const QString &login, SUser &user, SProfilePtr &profile);
+
+	static bool     ReadUser(const QVector<std::pair<std::string, std::string>> &fields, SUser &user);
+	static bool     ReadProfile(const QVector<std::pair<std::string, std::string>> &fields, SProfile &profile);
+	static void     ReadProfile(const QSqlQuery &query, SProfile &profile);
+	// Items and friends kept apart from profile: Redis sets and MySql tables
+	static void     ReadProfileLists(const SRedisReply &items, const SRedisReply &friends, SProfile &profile);
+	static bool     ReadProfileLists(MySqlConnection *pConnection, SProfile &profile);
+	static void     AppendListCommands(const SProfileWrite &write, QVector<QList<QByteArray>> &commands);
+	static bool     WriteProfileLists(MySqlConnection *pConnection, const SProfileWrite &write);
 public:
 	RedisConnector* pRedis;
 	MySqlConnector* pMySql;
+private:
+	// Guard reserved uids block, database connections are per thread
+	QMutex          m_Mutex;
+	int             m_NextUid;
+	int             m_LastUid;
+	DBTaskPool*     pTaskPool;
+	ProfileCache*   pProfileCache;
+	NicknameIndex*  pNicknameIndex;
+	// Old items and friends columns still in MySql profiles table, set on init
+	bool            bOldProfileColumns;
 };
 
 #endif // DBWORKER_H
\ No newline at end of file
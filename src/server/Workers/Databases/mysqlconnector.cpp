@@ -2,6 +2,7 @@
 // License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
 
 #include <QThread>
+#include <QSqlError>
 
 #include "global.h"
 #include "mysqlconnector.h"
@@ -9,9 +10,137 @@
 
 #include "Tools/settings.h"
 
+MySqlConnection::MySqlConnection(const QString &name, const QSharedPointer<QSemaphore> &permits) :
+	m_Name(name),
+	m_Permits(permits)
+{
+}
+
+MySqlConnection::~MySqlConnection()
+{
+	qDebug() << "~MySqlConnection" << m_Name;
+
+	Close();
+
+	// Database can be removed only when no one object use it
+	m_db = QSqlDatabase();
+	QSqlDatabase::removeDatabase(m_Name);
+
+	m_Permits->release();
+}
+
+bool MySqlConnection::Open(const SMySqlOptions &options)
+{
+	if (IsOpen())
+		return true;
+
+	// Don't block every query while MySql is down
+	if (m_LastConnectTry.isValid() && m_LastConnectTry.elapsed() < 1000)
+		return false;
+
+	m_LastConnectTry.start();
+
+	qDebug() << "Connecting to MySql host...(" << options.host << ":" << options.port << ")" << m_Name;
+
+	if (!m_db.isValid())
+		m_db = QSqlDatabase::addDatabase("QMYSQL", m_Name);
+
+	m_db.setHostName(options.host);
+	m_db.setPort(options.port);
+	m_db.setDatabaseName(options.dbName);
+	m_db.setUserName(options.userName);
+	m_db.setPassword(options.password);
+
+	if (!m_db.open())
+	{
+		qWarning() << "Can't connect to MySql. Reason =" << m_db.lastError().text();
+		return false;
+	}
+
+	m_LastUsed.start();
+	return true;
+}
+
+void MySqlConnection::Close()
+{
+	// Prepared statements belong to connection and die with it
+	qDeleteAll(m_Statements);
+	m_Statements.clear();
+
+	if (m_db.isOpen())
+		m_db.close();
+}
+
+bool MySqlConnection::Check(const SMySqlOptions &options)
+{
+	if (IsOpen() && m_LastUsed.isValid() && m_LastUsed.elapsed() >= options.checkInterval * 1000)
+	{
+		QSqlQuery ping(m_db);
+
+		if (!ping.exec("SELECT 1"))
+		{
+			qWarning() << "MySql connection" << m_Name << "broken. Reconnecting...";
+			Close();
+			m_LastConnectTry.invalidate();
+		}
+		else
+			m_LastUsed.start();
+	}
+
+	return Open(options);
+}
+
+QSqlQuery * MySqlConnection::Prepare(const QString &sql)
+{
+	auto it = m_Statements.find(sql);
+
+	if (it != m_Statements.end())
+	{
+		// Free result of previous call
+		(*it)->finish();
+		return *it;
+	}
+
+	QSqlQuery* query = new QSqlQuery(m_db);
+
+	if (!query->prepare(sql))
+	{
+		qWarning() << "Can't prepare MySql query. Reason =" << query->lastError().text();
+		bool bConnectionError = query->lastError().type() == QSqlError::ConnectionError;
+		delete query;
+
+		if (bConnectionError)
+			Close();
+
+		return nullptr;
+	}
+
+	m_Statements.insert(sql, query);
+	return query;
+}
+
+bool MySqlConnection::Exec(QSqlQuery * query)
+{
+	if (query->exec())
+	{
+		m_LastUsed.start();
+		return true;
+	}
+
+	qWarning() << "MySql query failed. Reason =" << query->lastError().text();
+
+	if (query->lastError().type() == QSqlError::ConnectionError)
+		Close();
+
+	return false;
+}
+
 MySqlConnector::MySqlConnector(QObject *parent) : QObject(parent),
-bConnectStatus(false)
+	m_WaitTimeout(0),
+	bConnectStatus(false)
 {
+	m_Options.port = 0;
+	m_Options.checkInterval = 0;
 }
 
 MySqlConnector::~MySqlConnector()
@@ -23,15 +152,31 @@ void MySqlConnector::run()
 {
 	gEnv->m_ServerStatus.m_DBStatus = "connecting";
 
-	if (Connect())
+	m_Options.host = gEnv->pSettings->GetVariable("mysql_host").toString();
+	m_Options.port = gEnv->pSettings->GetVariable("mysql_port").toInt();
+	m_Options.dbName = gEnv->pSettings->GetVariable("mysql_db_name").toString();
+	m_Options.userName = gEnv->pSettings->GetVariable("mysql_username").toString();
+	m_Options.password = gEnv->pSettings->GetVariable("mysql_password").toString();
+	m_Options.checkInterval = gEnv->pSettings->GetVariable("mysql_check_interval").toInt();
+	m_WaitTimeout = gEnv->pSettings->GetVariable("mysql_wait_timeout").toInt();
+
+	m_Permits = QSharedPointer<QSemaphore>(new QSemaphore(qMax(1, gEnv->pSettings->GetVariable("mysql_max_connections").toInt())));
+
+	bConnectStatus = true;
+
+	// First connection only check that database available, slot returned to database threads after it
+	bool bConnected = GetConnection() != nullptr;
+	m_Connections.setLocalData(nullptr);
+
+	if (bConnected)
 	{
 		qInfo() << "MySQL connected. Work on" << QThread::currentThread();
-		bConnectStatus = true;
 		gEnv->m_ServerStatus.m_DBStatus = "online";
 	}
 	else
 	{
 		qCritical() << "Failed connect to MySQL! MySQL functions not be work!";
+		bConnectStatus = false;
 		gEnv->m_ServerStatus.m_DBStatus = "offline";
 		return;
 	}
@@ -44,27 +189,32 @@ void MySqlConnector::Disconnect()
 	if (bConnectStatus)
 	{
 		qInfo() << "Disconnecting...";
-		m_db.close();
+		bConnectStatus = false;
+
+		// Connections of database threads closed with their threads
+		if (m_Connections.hasLocalData() && m_Connections.localData())
+			m_Connections.localData()->Close();
 	}
 }
 
-bool MySqlConnector::Connect()
+MySqlConnection * MySqlConnector::GetConnection()
 {
-	qDebug() << "Connecting to MySql host...(" << gEnv->pSettings->GetVariable("mysql_host").toString() << ":" << gEnv->pSettings->GetVariable("mysql_port").toInt() << ")";
-
-	m_db = QSqlDatabase::addDatabase("QMYSQL", "mySqlDatabase");
-	m_db.setHostName(gEnv->pSettings->GetVariable("mysql_host").toString());
-	m_db.setPort(gEnv->pSettings->GetVariable("mysql_port").toInt());
-	m_db.setDatabaseName(gEnv->pSettings->GetVariable("mysql_db_name").toString());
-	m_db.setUserName(gEnv->pSettings->GetVariable("mysql_username").toString());
-	m_db.setPassword(gEnv->pSettings->GetVariable("mysql_password").toString());
+	if (!m_Permits || !bConnectStatus)
+		return nullptr;
 
-	return m_db.open();
-}
+	if (!m_Connections.hasLocalData() || !m_Connections.localData())
+	{
+		if (!m_Permits->tryAcquire(1, m_WaitTimeout))
+		{
+			qWarning() << "No free MySql connections in" << m_WaitTimeout << "ms. Increase mysql_max_connections";
+			return nullptr;
+		}
 
-QSqlDatabase MySqlConnector::GetDatabase()
-{
-	return m_db;
-}
+		QString name = "mySqlDatabase_" + QString::number(m_ConnectionId.fetchAndAddRelaxed(1));
+		m_Connections.setLocalData(new MySqlConnection(name, m_Permits));
+	}
 
+	MySqlConnection* pConnection = m_Connections.localData();
 
+	return pConnection->Check(m_Options) ? pConnection : nullptr;
+}
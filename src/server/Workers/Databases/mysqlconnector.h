@@ -6,7 +6,56 @@
 
 #include <QObject>
 #include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QThreadStorage>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QAtomicInt>
 
+struct SMySqlOptions
+{
+	QString host;
+	int     port;
+	QString dbName;
+	QString userName;
+	QString password;
+	// Seconds without queries before connection checked by ping
+	int     checkInterval;
+};
+
+// Connection of one thread. Qt allow use database connection only in thread who created it.
+// Prepared statements live as long as connection, so every query prepared only once
+class MySqlConnection
+{
+public:
+	MySqlConnection(const QString &name, const QSharedPointer<QSemaphore> &permits);
+	~MySqlConnection();
+public:
+	bool                         Open(const SMySqlOptions &options);
+	bool                         IsOpen() { return m_db.isOpen(); }
+	void                         Close();
+	// Check connection when it was idle too long, reconnect if it broken
+	bool                         Check(const SMySqlOptions &options);
+
+	// Return cached prepared query or nullptr if query can't be prepared
+	QSqlQuery*                   Prepare(const QString &sql);
+	// Close connection on connection errors, so next query reconnect
+	bool                         Exec(QSqlQuery* query);
+	// For one-time queries not worth caching
+	QSqlDatabase&                GetDatabase() { return m_db; }
+private:
+	QString                      m_Name;
+	QSqlDatabase                 m_db;
+	QHash<QString, QSqlQuery*>   m_Statements;
+	QElapsedTimer                m_LastUsed;
+	QElapsedTimer                m_LastConnectTry;
+	QSharedPointer<QSemaphore>   m_Permits;
+};
+
+// Give every database thread own MySql connection.
+// Connections count limited by mysql_max_connections, thread wait free slot not longer than mysql_wait_timeout
 class MySqlConnector : public QObject
 {
 	Q_OBJECT
@@ -14,15 +63,18 @@ public:
 	explicit MySqlConnector(QObject *parent = nullptr);
 	~MySqlConnector();
 public:
-	void         run();
-	void         Disconnect();
-	QSqlDatabase GetDatabase();
-	bool         IsConnected() { return bConnectStatus; }
-private:
-	bool	     Connect();
+	void                         run();
+	void                         Disconnect();
+	// Connection of calling thread or nullptr if database unavailable
+	MySqlConnection*             GetConnection();
+	bool                         IsConnected() { return bConnectStatus; }
 private:
-	QSqlDatabase m_db;
-	bool         bConnectStatus;
+	QThreadStorage<MySqlConnection*> m_Connections;
+	QSharedPointer<QSemaphore>   m_Permits;
+	SMySqlOptions                m_Options;
+	int                          m_WaitTimeout;
+	QAtomicInt                   m_ConnectionId;
+	bool                         bConnectStatus;
 };
 
 #endif // MYSQLCONNECTOR_H
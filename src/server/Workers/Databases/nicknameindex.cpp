@@ -0,0 +1,110 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "global.h"
+#include "nicknameindex.h"
+
+// Bits set for every nickname and bits per nickname in filter, gives ~1% false positives
+static const int FILTER_HASHES = 7;
+static const int FILTER_BITS_PER_NICKNAME = 10;
+
+NicknameIndex::NicknameIndex() :
+	m_FilterBits(0)
+{
+}
+
+NicknameIndex::~NicknameIndex()
+{
+	qDebug() << "~NicknameIndex";
+}
+
+void NicknameIndex::Reset(const QHash<QString, int>& nicknames, int minFilterBits)
+{
+	QWriteLocker locker(&m_Lock);
+
+	// Room for twice more nicknames than now, rounded to whole words
+	int bits = qMax(minFilterBits, nicknames.size() * FILTER_BITS_PER_NICKNAME * 2);
+	bits = (qMax(bits, 32) + 31) / 32 * 32;
+
+	m_Filter.reset(new QAtomicInt[bits / 32]);
+	m_FilterBits = bits;
+	m_Uids = nicknames;
+
+	for (auto it = m_Uids.constBegin(); it != m_Uids.constEnd(); ++it)
+		SetBits(it.key());
+
+	bReady.store(1);
+
+	qInfo() << "Nickname index loaded." << m_Uids.size() << "nicknames, filter size" << bits / 8 / 1024 << "KB";
+}
+
+void NicknameIndex::Add(const QString & nickname, int uid)
+{
+	if (nickname.isEmpty() || uid <= 0)
+		return;
+
+	QWriteLocker locker(&m_Lock);
+
+	m_Uids.insert(nickname, uid);
+
+	if (m_FilterBits > 0)
+		SetBits(nickname);
+}
+
+int NicknameIndex::GetUid(const QString & nickname)
+{
+	if (nickname.isEmpty() || !MayContain(nickname))
+		return -1;
+
+	QReadLocker locker(&m_Lock);
+	return m_Uids.value(nickname, -1);
+}
+
+int NicknameIndex::Count()
+{
+	QReadLocker locker(&m_Lock);
+	return m_Uids.size();
+}
+
+bool NicknameIndex::MayContain(const QString & nickname) const
+{
+	if (!IsReady())
+		return true;
+
+	uint h1 = 0, h2 = 0;
+	GetHashes(nickname, h1, h2);
+
+	for (int i = 0; i < FILTER_HASHES; ++i)
+	{
+		const uint bit = (h1 + i * h2) % m_FilterBits;
+
+		if ((m_Filter[bit / 32].load() & static_cast<int>(1u << (bit % 32))) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+void NicknameIndex::SetBits(const QString & nickname)
+{
+	uint h1 = 0, h2 = 0;
+	GetHashes(nickname, h1, h2);
+
+	for (int i = 0; i < FILTER_HASHES; ++i)
+	{
+		const uint bit = (h1 + i * h2) % m_FilterBits;
+
+		// Bits only set, so lock-free readers see nickname or not yet
+		m_Filter[bit / 32].fetchAndOrOrdered(static_cast<int>(1u << (bit % 32)));
+	}
+}
+
+void NicknameIndex::GetHashes(const QString & nickname, uint & h1, uint & h2) const
+{
+	// Two independent hashes combined give all others
+	h1 = qHash(nickname, 0);
+	h2 = qHash(nickname, 0x9e3779b9) | 1;
+}
@@ -0,0 +1,46 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef NICKNAMEINDEX_H
+#define NICKNAMEINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <QScopedArrayPointer>
+
+// All nicknames of this server with their uids, loaded from database on start.
+// Only fast path for found nicknames : other server nodes add nicknames without it, so miss is checked in database.
+// Bloom filter before the hash answers "no such nickname" without taking the lock.
+// Filter size chosen on load, nicknames added later only raise false positive rate.
+class NicknameIndex
+{
+public:
+	NicknameIndex();
+	~NicknameIndex();
+public:
+	// Load index content, after that found nicknames answered without database.
+	// Filter read without lock, so called once on start before clients served
+	void                      Reset(const QHash<QString, int> &nicknames, int minFilterBits);
+	void                      Add(const QString &nickname, int uid);
+
+	bool                      IsReady() const { return bReady.load() != 0; }
+	// -1 if nickname not found
+	int                       GetUid(const QString &nickname);
+	bool                      Contains(const QString &nickname) { return GetUid(nickname) > 0; }
+	int                       Count();
+private:
+	bool                      MayContain(const QString &nickname) const;
+	void                      SetBits(const QString &nickname);
+	void                      GetHashes(const QString &nickname, uint &h1, uint &h2) const;
+private:
+	QReadWriteLock            m_Lock;
+	QHash<QString, int>       m_Uids;
+
+	QScopedArrayPointer<QAtomicInt> m_Filter;
+	int                       m_FilterBits;
+	QAtomicInt                bReady;
+};
+
+#endif // NICKNAMEINDEX_H
@@ -0,0 +1,618 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "global.h"
+#include "profilecache.h"
+#include "dbworker.h"
+#include "dbtaskpool.h"
+
+#include "Tools/settings.h"
+
+// All batches written one by one, so older batch can't overwrite newer
+static const quint64 FLUSH_TASK_KEY = Q_UINT64_C(1) << 62;
+
+void ProfileCache::CopyFields(const SProfile &from, SProfile &to, int fields)
+{
+	if (fields & ProfileNickname)
+		to.nickname = from.nickname;
+	if (fields & ProfileFileModel)
+		to.fileModel = from.fileModel;
+	if (fields & ProfileLvl)
+		to.lvl = from.lvl;
+	if (fields & ProfileXp)
+		to.xp = from.xp;
+	if (fields & ProfileMoney)
+		to.money = from.money;
+	if (fields & ProfileItems)
+		to.items = from.items;
+	if (fields & ProfileFriends)
+		to.friends = from.friends;
+}
+
+void SProfileDelta::AddItem(const QString & item)
+{
+	removeItems.remove(item);
+	addItems.insert(item);
+}
+
+void SProfileDelta::RemoveItem(const QString & item)
+{
+	addItems.remove(item);
+	removeItems.insert(item);
+}
+
+void SProfileDelta::AddFriend(int uid)
+{
+	removeFriends.remove(uid);
+	addFriends.insert(uid);
+}
+
+void SProfileDelta::RemoveFriend(int uid)
+{
+	addFriends.remove(uid);
+	removeFriends.insert(uid);
+}
+
+void SProfileDelta::ApplyTo(SProfile & profile, int fields) const
+{
+	if (fields & ProfileItems)
+	{
+		for (auto it = addItems.begin(); it != addItems.end(); ++it)
+			profile.items.insert(*it);
+		for (auto it = removeItems.begin(); it != removeItems.end(); ++it)
+			profile.items.remove(*it);
+	}
+
+	if (fields & ProfileFriends)
+	{
+		for (auto it = addFriends.begin(); it != addFriends.end(); ++it)
+			profile.friends.insert(*it);
+		for (auto it = removeFriends.begin(); it != removeFriends.end(); ++it)
+			profile.friends.remove(*it);
+	}
+}
+
+void SProfileDelta::Merge(const SProfileDelta & newer)
+{
+	// Whole list written anyway, so single changes not needed
+	if (newer.bReplaceItems || bReplaceItems)
+	{
+		addItems.clear();
+		removeItems.clear();
+		bReplaceItems = true;
+	}
+	else
+	{
+		for (auto it = newer.addItems.begin(); it != newer.addItems.end(); ++it)
+			AddItem(*it);
+		for (auto it = newer.removeItems.begin(); it != newer.removeItems.end(); ++it)
+			RemoveItem(*it);
+	}
+
+	if (newer.bReplaceFriends || bReplaceFriends)
+	{
+		addFriends.clear();
+		removeFriends.clear();
+		bReplaceFriends = true;
+	}
+	else
+	{
+		for (auto it = newer.addFriends.begin(); it != newer.addFriends.end(); ++it)
+			AddFriend(*it);
+		for (auto it = newer.removeFriends.begin(); it != newer.removeFriends.end(); ++it)
+			RemoveFriend(*it);
+	}
+}
+
+// Delta only for changed lists, changed list without delta replaced whole
+static SProfileDelta NormalizeDelta(int fields, const SProfileDelta &delta)
+{
+	SProfileDelta result;
+
+	if (fields & ProfileItems)
+	{
+		result.addItems = delta.addItems;
+		result.removeItems = delta.removeItems;
+		result.bReplaceItems = delta.bReplaceItems || !delta.HasItems();
+	}
+
+	if (fields & ProfileFriends)
+	{
+		result.addFriends = delta.addFriends;
+		result.removeFriends = delta.removeFriends;
+		result.bReplaceFriends = delta.bReplaceFriends || !delta.HasFriends();
+	}
+
+	return result;
+}
+
+static QJsonArray UidsToJson(const QSet<int> &uids)
+{
+	QJsonArray array;
+	for (auto it = uids.begin(); it != uids.end(); ++it)
+		array.append(*it);
+	return array;
+}
+
+static QSet<int> UidsFromJson(const QJsonValue &value)
+{
+	QSet<int> uids;
+	QJsonArray array = value.toArray();
+	for (auto it = array.begin(); it != array.end(); ++it)
+		uids.insert((*it).toInt());
+	return uids;
+}
+
+static QSet<QString> StringsFromJson(const QJsonValue &value)
+{
+	QSet<QString> strings;
+	QJsonArray array = value.toArray();
+	for (auto it = array.begin(); it != array.end(); ++it)
+		strings.insert((*it).toString());
+	return strings;
+}
+
+ProfileCache::ProfileCache(QObject *parent) : QObject(parent),
+	m_Version(0),
+	bWriteBehind(false),
+	bJournalSync(false),
+	bJournalEnabled(false)
+{
+	connect(&m_Timer, &QTimer::timeout, this, &ProfileCache::update);
+}
+
+ProfileCache::~ProfileCache()
+{
+	qDebug() << "~ProfileCache";
+
+	m_Timer.stop();
+
+	if (m_Journal.isOpen())
+		m_Journal.close();
+}
+
+void ProfileCache::Init()
+{
+	bWriteBehind = gEnv->pSettings->GetVariable("db_write_behind").toBool();
+	bJournalSync = gEnv->pSettings->GetVariable("db_journal_sync").toBool();
+
+	if (!bWriteBehind)
+	{
+		qInfo() << "Profiles written to database on every change";
+		return;
+	}
+
+	QString journal = gEnv->pSettings->GetVariable("db_journal").toString();
+
+	if (!journal.isEmpty())
+	{
+		bJournalEnabled = true;
+		OpenJournal(journal);
+	}
+	else
+		qWarning() << "Profile journal disabled. Not written profile changes will be lost on crash";
+
+	m_Timer.start(qMax(100, gEnv->pSettings->GetVariable("db_flush_interval").toInt()));
+
+	// Changes left in journal after crash. Lists can be replayed only as deltas,
+	// so they written before clients read profiles
+	Flush();
+	gEnv->pDBWorker->GetTaskPool()->Clear();
+}
+
+bool ProfileCache::Update(const SProfile & profile, int fields, const SProfileDelta & delta)
+{
+	if (profile.uid <= 0)
+	{
+		qWarning() << "Can't update profile" << profile.nickname << ". Wrong uid" << profile.uid;
+		return false;
+	}
+
+	if (fields == 0)
+		return true;
+
+	if (!bWriteBehind)
+	{
+		SProfileWrite write;
+		write.profile = profile;
+		write.fields = fields;
+		write.delta = NormalizeDelta(fields, delta);
+		write.version = 0;
+
+		return gEnv->pDBWorker->WriteProfiles(QVector<SProfileWrite>() << write);
+	}
+
+	const SProfileDelta normalized = NormalizeDelta(fields, delta);
+
+	// Only changed fields and list deltas go to journal, line made before lock
+	QByteArray line;
+	if (bJournalEnabled)
+		line = ToJournalLine(profile, fields, normalized);
+
+	QMutexLocker locker(&m_Mutex);
+
+	Merge(profile, fields, normalized, fields);
+
+	if (line.isEmpty())
+		return true;
+
+	// Journal locked before cache unlocked, so lines go to file in order of changes
+	QMutexLocker journalLocker(&m_JournalMutex);
+	locker.unlock();
+
+	AppendJournal(line);
+
+	return true;
+}
+
+void ProfileCache::Apply(SProfile & profile)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	// List replayed from journal delta is unknown until written, database value used
+	auto it = m_Entries.constFind(profile.uid);
+	if (it != m_Entries.constEnd())
+		CopyFields(it->profile, profile, it->dirty & it->known);
+}
+
+void ProfileCache::FlushProfile(int uid)
+{
+	if (!bWriteBehind || uid <= 0)
+		return;
+
+	Write(Take(uid));
+}
+
+void ProfileCache::Flush()
+{
+	if (!bWriteBehind)
+		return;
+
+	Write(Take(0));
+}
+
+int ProfileCache::GetDirtyCount()
+{
+	QMutexLocker locker(&m_Mutex);
+	return m_Entries.size();
+}
+
+void ProfileCache::update()
+{
+	Flush();
+}
+
+void ProfileCache::Merge(const SProfile & profile, int fields, const SProfileDelta & delta, int known)
+{
+	auto it = m_Entries.find(profile.uid);
+
+	if (it == m_Entries.end())
+	{
+		SEntry entry;
+		entry.profile = profile;
+		entry.fields = fields;
+		entry.dirty = fields;
+		entry.known = known;
+		entry.delta = delta;
+		entry.version = ++m_Version;
+
+		m_Entries.insert(profile.uid, entry);
+		return;
+	}
+
+	// Only changed fields are fresh, other can be older than ours.
+	// Changed list without whole value updates only list known before
+	CopyFields(profile, it->profile, known);
+	delta.ApplyTo(it->profile, fields & ~known & it->known);
+	it->known |= known;
+	it->fields |= fields;
+	it->dirty |= fields;
+	it->delta.Merge(delta);
+	it->version = ++m_Version;
+}
+
+QVector<SProfileWrite> ProfileCache::Take(int uid)
+{
+	QVector<SProfileWrite> batch;
+
+	QMutexLocker locker(&m_Mutex);
+
+	for (auto it = m_Entries.begin(); it != m_Entries.end(); ++it)
+	{
+		if (it->fields == 0 || (uid > 0 && it.key() != uid))
+			continue;
+
+		SProfileWrite write;
+		write.profile = it->profile;
+		write.fields = it->fields;
+		write.delta = it->delta;
+		write.version = it->version;
+
+		batch.push_back(write);
+		it->fields = 0;
+		it->delta = SProfileDelta();
+	}
+
+	return batch;
+}
+
+void ProfileCache::Write(const QVector<SProfileWrite>& batch)
+{
+	if (batch.isEmpty())
+		return;
+
+	gEnv->pDBWorker->GetTaskPool()->Post(FLUSH_TASK_KEY, [this, batch]()
+	{
+		Finished(batch, gEnv->pDBWorker->WriteProfiles(batch));
+	});
+}
+
+void ProfileCache::Finished(const QVector<SProfileWrite>& batch, bool success)
+{
+	QMutexLocker locker(&m_Mutex);
+
+	for (auto write = batch.begin(); write != batch.end(); ++write)
+	{
+		auto it = m_Entries.find(write->profile.uid);
+		if (it == m_Entries.end())
+			continue;
+
+		// Try again on next flush, changes made after this write go on top
+		if (!success)
+		{
+			SProfileDelta delta = write->delta;
+			delta.Merge(it->delta);
+
+			it->fields |= write->fields;
+			it->delta = delta;
+		}
+		// Profile not changed after this write
+		else if (it->version == write->version && it->fields == 0)
+			m_Entries.erase(it);
+	}
+
+	if (!success)
+		qWarning() << "Failed write" << batch.size() << "profiles to database." << m_Entries.size() << "profiles wait for writing";
+	else
+		qDebug() << batch.size() << "profiles written to database";
+
+	if (!bJournalEnabled)
+		return;
+
+	// Journal keep only changes not written yet
+	QByteArray content = GetJournalContent();
+
+	QMutexLocker journalLocker(&m_JournalMutex);
+	locker.unlock();
+
+	RewriteJournal(content);
+}
+
+void ProfileCache::OpenJournal(const QString & path)
+{
+	m_Journal.setFileName(path);
+
+	if (m_Journal.exists() && m_Journal.open(QIODevice::ReadOnly))
+	{
+		int count = 0;
+
+		while (!m_Journal.atEnd())
+		{
+			QByteArray line = m_Journal.readLine().trimmed();
+
+			if (line.isEmpty())
+				continue;
+
+			SProfile profile;
+			SProfileDelta delta;
+			int fields = 0;
+
+			// Last line can be cut by crash
+			if (!FromJournalLine(line, profile, fields, delta))
+			{
+				qWarning() << "Wrong line in profile journal" << path << ". Line skipped";
+				continue;
+			}
+
+			// Added and removed values can be written again, whole list known only if line has it
+			int known = fields;
+			if (!delta.bReplaceItems)
+				known &= ~ProfileItems;
+			if (!delta.bReplaceFriends)
+				known &= ~ProfileFriends;
+
+			QMutexLocker locker(&m_Mutex);
+			Merge(profile, fields, delta, known);
+			count++;
+		}
+
+		m_Journal.close();
+
+		if (count > 0)
+			qInfo() << "Replayed" << count << "profile changes from journal" << path;
+	}
+
+	if (!m_Journal.open(QIODevice::WriteOnly | QIODevice::Append))
+		qCritical() << "Can't open profile journal" << path << ". Reason =" << m_Journal.errorString();
+}
+
+void ProfileCache::AppendJournal(const QByteArray & line)
+{
+	if (!m_Journal.isOpen())
+		return;
+
+	m_Journal.write(line);
+	m_Journal.flush();
+
+	if (bJournalSync)
+	{
+#if defined(Q_OS_WIN)
+		_commit(m_Journal.handle());
+#else
+		fsync(m_Journal.handle());
+#endif
+	}
+}
+
+QByteArray ProfileCache::GetJournalContent()
+{
+	QByteArray content;
+
+	for (auto it = m_Entries.constBegin(); it != m_Entries.constEnd(); ++it)
+	{
+		// Known lists written whole, unknown only with deltas waiting for writing
+		SProfileDelta delta = it->delta;
+		int fields = it->dirty;
+
+		if (it->known & ProfileItems)
+			delta.bReplaceItems = true;
+		else if (!delta.HasItems())
+			fields &= ~ProfileItems;
+
+		if (it->known & ProfileFriends)
+			delta.bReplaceFriends = true;
+		else if (!delta.HasFriends())
+			fields &= ~ProfileFriends;
+
+		if (fields != 0)
+			content.append(ToJournalLine(it->profile, fields, delta));
+	}
+
+	return content;
+}
+
+void ProfileCache::RewriteJournal(const QByteArray & content)
+{
+	if (!m_Journal.isOpen())
+		return;
+
+	QString path = m_Journal.fileName();
+	m_Journal.close();
+
+	QSaveFile file(path);
+
+	if (file.open(QIODevice::WriteOnly))
+	{
+		file.write(content);
+
+		if (!file.commit())
+			qWarning() << "Can't rewrite profile journal" << path << ". Reason =" << file.errorString();
+	}
+
+	if (!m_Journal.open(QIODevice::WriteOnly | QIODevice::Append))
+		qCritical() << "Can't open profile journal" << path << ". Reason =" << m_Journal.errorString();
+}
+
+QByteArray ProfileCache::ToJournalLine(const SProfile & profile, int fields, const SProfileDelta & delta)
+{
+	QJsonObject object;
+	object["uid"] = profile.uid;
+	object["fields"] = fields;
+
+	if (fields & ProfileNickname)
+		object["nickname"] = profile.nickname;
+	if (fields & ProfileFileModel)
+		object["fileModel"] = profile.fileModel;
+	if (fields & ProfileLvl)
+		object["lvl"] = profile.lvl;
+	if (fields & ProfileXp)
+		object["xp"] = profile.xp;
+	if (fields & ProfileMoney)
+		object["money"] = profile.money;
+
+	// Whole list only when it replaced, else added and removed values
+	if (fields & ProfileItems)
+	{
+		if (delta.bReplaceItems)
+			object["items"] = QJsonArray::fromStringList(profile.items.toList());
+		else
+		{
+			object["addItems"] = QJsonArray::fromStringList(delta.addItems.toList());
+			object["removeItems"] = QJsonArray::fromStringList(delta.removeItems.toList());
+		}
+	}
+
+	if (fields & ProfileFriends)
+	{
+		if (delta.bReplaceFriends)
+			object["friends"] = UidsToJson(profile.friends);
+		else
+		{
+			object["addFriends"] = UidsToJson(delta.addFriends);
+			object["removeFriends"] = UidsToJson(delta.removeFriends);
+		}
+	}
+
+	return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool ProfileCache::FromJournalLine(const QByteArray & line, SProfile & profile, int & fields, SProfileDelta & delta)
+{
+	QJsonParseError error;
+	QJsonDocument document = QJsonDocument::fromJson(line, &error);
+
+	if (error.error != QJsonParseError::NoError || !document.isObject())
+		return false;
+
+	QJsonObject object = document.object();
+
+	fields = object["fields"].toInt() & ProfileAll;
+
+	profile.uid = object["uid"].toInt();
+	profile.nickname = object["nickname"].toString();
+	profile.fileModel = object["fileModel"].toString();
+	profile.lvl = object["lvl"].toInt();
+	profile.xp = object["xp"].toInt();
+	profile.money = object["money"].toInt();
+	profile.items.clear();
+	profile.friends.clear();
+
+	// Lines of old format always have whole lists
+	if (fields & ProfileItems)
+	{
+		if (object.contains("items"))
+		{
+			profile.items = StringsFromJson(object["items"]);
+			delta.bReplaceItems = true;
+		}
+		else
+		{
+			delta.addItems = StringsFromJson(object["addItems"]);
+			delta.removeItems = StringsFromJson(object["removeItems"]);
+
+			if (!delta.HasItems())
+				fields &= ~ProfileItems;
+		}
+	}
+
+	if (fields & ProfileFriends)
+	{
+		if (object.contains("friends"))
+		{
+			profile.friends = UidsFromJson(object["friends"]);
+			delta.bReplaceFriends = true;
+		}
+		else
+		{
+			delta.addFriends = UidsFromJson(object["addFriends"]);
+			delta.removeFriends = UidsFromJson(object["removeFriends"]);
+
+			if (!delta.HasFriends())
+				fields &= ~ProfileFriends;
+		}
+	}
+
+	return profile.uid > 0 && fields != 0;
+}
@@ -0,0 +1,128 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef PROFILECACHE_H
+#define PROFILECACHE_H
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QFile>
+
+#include "global.h"
+
+enum EProfileField
+{
+	ProfileNickname  = 1 << 0,
+	ProfileFileModel = 1 << 1,
+	ProfileLvl       = 1 << 2,
+	ProfileXp        = 1 << 3,
+	ProfileMoney     = 1 << 4,
+	ProfileItems     = 1 << 5,
+	ProfileFriends   = 1 << 6,
+	ProfileAll       = (1 << 7) - 1,
+};
+
+// Added and removed items and friends. Database change only them, not whole lists.
+// Changed list without delta written whole
+struct SProfileDelta
+{
+	SProfileDelta() : bReplaceItems(false), bReplaceFriends(false) {}
+
+	void          AddItem(const QString &item);
+	void          RemoveItem(const QString &item);
+	void          AddFriend(int uid);
+	void          RemoveFriend(int uid);
+
+	bool          HasItems() const { return !addItems.isEmpty() || !removeItems.isEmpty(); }
+	bool          HasFriends() const { return !addFriends.isEmpty() || !removeFriends.isEmpty(); }
+	// Change lists of profile by added and removed values
+	void          ApplyTo(SProfile &profile, int fields) const;
+	// Put newer changes on top of this
+	void          Merge(const SProfileDelta &newer);
+
+	QSet<QString> addItems;
+	QSet<QString> removeItems;
+	QSet<int>     addFriends;
+	QSet<int>     removeFriends;
+	bool          bReplaceItems;
+	bool          bReplaceFriends;
+};
+
+struct SProfileWrite
+{
+	SProfile      profile;
+	int           fields;
+	SProfileDelta delta;
+	quint64       version;
+};
+
+// Profile changes waiting for database.
+// Handlers put changed fields here and go on, changes of all players written by one batch on timer
+// and on player logout. Until change written, profile readed from here, so database never seen stale.
+// Changed fields and list deltas also appended to journal, after crash journal replayed on start
+class ProfileCache : public QObject
+{
+	Q_OBJECT
+public:
+	explicit ProfileCache(QObject *parent = nullptr);
+	~ProfileCache();
+public:
+	// Must be called after databases connected
+	void                   Init();
+	// In write-through mode change written before return
+	bool                   Update(const SProfile &profile, int fields, const SProfileDelta &delta = SProfileDelta());
+	// Put changes not written yet on top of profile readed from database
+	void                   Apply(SProfile &profile);
+
+	void                   FlushProfile(int uid);
+	void                   Flush();
+
+	int                    GetDirtyCount();
+
+	static void            CopyFields(const SProfile &from, SProfile &to, int fields);
+public slots:
+	void                   update();
+private:
+	struct SEntry
+	{
+		SProfile           profile;
+		// Changed fields not taken for writing
+		int                fields;
+		// All fields changed since entry created
+		int                dirty;
+		// Fields with whole value in profile. Lists replayed from journal deltas are unknown
+		int                known;
+		SProfileDelta      delta;
+		quint64            version;
+	};
+
+	void                   Merge(const SProfile &profile, int fields, const SProfileDelta &delta, int known);
+	QVector<SProfileWrite> Take(int uid);
+	void                   Write(const QVector<SProfileWrite> &batch);
+	void                   Finished(const QVector<SProfileWrite> &batch, bool success);
+
+	// Journal file used only under m_JournalMutex, m_Mutex not held while writing
+	void                   OpenJournal(const QString &path);
+	void                   AppendJournal(const QByteArray &line);
+	void                   RewriteJournal(const QByteArray &content);
+	QByteArray             GetJournalContent();
+	static QByteArray      ToJournalLine(const SProfile &profile, int fields, const SProfileDelta &delta);
+	static bool            FromJournalLine(const QByteArray &line, SProfile &profile, int &fields, SProfileDelta &delta);
+private:
+	QMutex                 m_Mutex;
+	QMutex                 m_JournalMutex;
+	QHash<int, SEntry>     m_Entries;
+	quint64                m_Version;
+
+	QTimer                 m_Timer;
+	QFile                  m_Journal;
+
+	bool                   bWriteBehind;
+	bool                   bJournalSync;
+	bool                   bJournalEnabled;
+};
+
+#endif // PROFILECACHE_H
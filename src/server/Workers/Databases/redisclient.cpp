@@ -0,0 +1,342 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <QThread>
+
+#include "global.h"
+#include "redisclient.h"
+
+RedisClient::RedisClient(QObject *parent) : QObject(parent),
+	m_Socket(nullptr),
+	m_ReadPos(0)
+{
+}
+
+RedisClient::~RedisClient()
+{
+	qDebug() << "~RedisClient";
+	Disconnect();
+}
+
+bool RedisClient::Connect(const QString & host, quint16 port, int timeout)
+{
+	if (IsConnected())
+		return true;
+
+	// Don't block every query while Redis is down
+	if (m_LastConnectTry.isValid() && m_LastConnectTry.elapsed() < 1000)
+		return false;
+
+	m_LastConnectTry.start();
+
+	if (!m_Socket)
+	{
+		m_Socket = new QTcpSocket(this);
+		connect(m_Socket, &QTcpSocket::readyRead, this, &RedisClient::readyRead);
+		connect(m_Socket, &QTcpSocket::disconnected, this, &RedisClient::socketDisconnected);
+	}
+
+	m_Socket->abort();
+	m_ReadBuffer.clear();
+	m_ReadPos = 0;
+
+	qDebug() << "Connecting to redis" << host << port;
+
+	m_Socket->connectToHost(host, port);
+
+	if (!m_Socket->waitForConnected(timeout))
+	{
+		qWarning() << "Can't connect to Redis" << host << port << ". Reason =" << m_Socket->errorString();
+		m_Socket->abort();
+		return false;
+	}
+
+	// Pipelined commands must go without Nagle delay
+	m_Socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+	qDebug() << "Redis connected. Thread" << QThread::currentThread();
+	return true;
+}
+
+bool RedisClient::IsConnected()
+{
+	return m_Socket && m_Socket->state() == QAbstractSocket::ConnectedState;
+}
+
+void RedisClient::Disconnect()
+{
+	if (!m_Socket)
+		return;
+
+	FailPending("ERR client disconnected");
+
+	if (m_Socket->state() != QAbstractSocket::UnconnectedState)
+		m_Socket->disconnectFromHost();
+}
+
+void RedisClient::Command(const QList<QByteArray>& args, const TCallback & callback)
+{
+	m_WriteBuffer.append('*');
+	m_WriteBuffer.append(QByteArray::number(args.size()));
+	m_WriteBuffer.append("\r\n");
+
+	for (auto it = args.begin(); it != args.end(); ++it)
+	{
+		m_WriteBuffer.append('$');
+		m_WriteBuffer.append(QByteArray::number(it->size()));
+		m_WriteBuffer.append("\r\n");
+		m_WriteBuffer.append(*it);
+		m_WriteBuffer.append("\r\n");
+	}
+
+	m_Callbacks.enqueue(callback);
+}
+
+void RedisClient::Flush()
+{
+	if (m_WriteBuffer.isEmpty())
+		return;
+
+	if (!IsConnected())
+	{
+		FailPending("ERR not connected");
+		return;
+	}
+
+	m_Socket->write(m_WriteBuffer);
+	m_WriteBuffer.clear();
+}
+
+bool RedisClient::Commit(int timeout)
+{
+	Flush();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	while (!m_Callbacks.isEmpty())
+	{
+		if (!IsConnected())
+		{
+			FailPending("ERR connection lost");
+			return false;
+		}
+
+		int remaining = timeout - static_cast<int>(timer.elapsed());
+
+		if (remaining <= 0 || !m_Socket->waitForReadyRead(remaining))
+		{
+			qWarning() << "Redis not answered in" << timeout << "ms. Connection will be closed";
+
+			// Late replies can't be matched with commands anymore
+			FailPending("ERR timeout");
+			m_Socket->abort();
+			return false;
+		}
+
+		ReadReplies();
+	}
+
+	return true;
+}
+
+SRedisReply RedisClient::Execute(const QList<QByteArray>& args, int timeout)
+{
+	SRedisReply result;
+
+	Command(args, [&result](const SRedisReply &reply)
+	{
+		result = reply;
+	});
+
+	Commit(timeout);
+
+	return result;
+}
+
+void RedisClient::readyRead()
+{
+	ReadReplies();
+}
+
+void RedisClient::socketDisconnected()
+{
+	FailPending("ERR connection lost");
+	emit disconnected();
+}
+
+void RedisClient::ReadReplies()
+{
+	if (!m_Socket)
+		return;
+
+	if (m_Socket->bytesAvailable() > 0)
+		m_ReadBuffer.append(m_Socket->readAll());
+
+	while (m_ReadPos < m_ReadBuffer.size())
+	{
+		if (m_Callbacks.isEmpty())
+		{
+			qWarning() << "Redis send reply without command. Reply dropped";
+			m_ReadBuffer.clear();
+			m_ReadPos = 0;
+			return;
+		}
+
+		SRedisReply reply;
+		int pos = m_ReadPos;
+		int result = ParseReply(pos, reply);
+
+		if (result == 0)
+			break;
+
+		if (result < 0)
+		{
+			qCritical() << "Can't parse reply from Redis. Connection will be closed";
+			FailPending("ERR protocol error");
+			m_Socket->abort();
+			return;
+		}
+
+		m_ReadPos = pos;
+
+		TCallback callback = m_Callbacks.dequeue();
+		if (callback)
+			callback(reply);
+	}
+
+	if (m_ReadPos >= m_ReadBuffer.size())
+	{
+		m_ReadBuffer.clear();
+		m_ReadPos = 0;
+	}
+	else if (m_ReadPos > 4096)
+	{
+		m_ReadBuffer.remove(0, m_ReadPos);
+		m_ReadPos = 0;
+	}
+}
+
+int RedisClient::ParseLine(int pos, QByteArray & line)
+{
+	int end = m_ReadBuffer.indexOf("\r\n", pos);
+	if (end < 0)
+		return -1;
+
+	line = m_ReadBuffer.mid(pos, end - pos);
+	return end + 2;
+}
+
+int RedisClient::ParseReply(int & pos, SRedisReply & reply)
+{
+	if (pos >= m_ReadBuffer.size())
+		return 0;
+
+	const char type = m_ReadBuffer.at(pos);
+
+	QByteArray line;
+	int next = ParseLine(pos + 1, line);
+	if (next < 0)
+		return 0;
+
+	bool ok = false;
+
+	switch (type)
+	{
+	case '+':
+	{
+		reply.type = SRedisReply::Status;
+		reply.string = line;
+		pos = next;
+		return 1;
+	}
+	case '-':
+	{
+		reply.type = SRedisReply::Error;
+		reply.string = line;
+		pos = next;
+		return 1;
+	}
+	case ':':
+	{
+		reply.type = SRedisReply::Integer;
+		reply.integer = line.toLongLong(&ok);
+		pos = next;
+		return ok ? 1 : -1;
+	}
+	case '$':
+	{
+		int size = line.toInt(&ok);
+		if (!ok)
+			return -1;
+
+		if (size < 0)
+		{
+			reply.type = SRedisReply::Null;
+			pos = next;
+			return 1;
+		}
+
+		if (m_ReadBuffer.size() < next + size + 2)
+			return 0;
+
+		if (m_ReadBuffer.at(next + size) != '\r' || m_ReadBuffer.at(next + size + 1) != '\n')
+			return -1;
+
+		reply.type = SRedisReply::Bulk;
+		reply.string = m_ReadBuffer.mid(next, size);
+		pos = next + size + 2;
+		return 1;
+	}
+	case '*':
+	{
+		int count = line.toInt(&ok);
+		if (!ok)
+			return -1;
+
+		if (count < 0)
+		{
+			reply.type = SRedisReply::Null;
+			pos = next;
+			return 1;
+		}
+
+		reply.type = SRedisReply::Array;
+		reply.elements.reserve(count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			SRedisReply element;
+			int result = ParseReply(next, element);
+
+			if (result <= 0)
+				return result;
+
+			reply.elements.push_back(element);
+		}
+
+		pos = next;
+		return 1;
+	}
+	default:
+		return -1;
+	}
+}
+
+void RedisClient::FailPending(const QByteArray & error)
+{
+	SRedisReply reply;
+	reply.type = SRedisReply::Error;
+	reply.string = error;
+
+	m_WriteBuffer.clear();
+	m_ReadBuffer.clear();
+	m_ReadPos = 0;
+
+	while (!m_Callbacks.isEmpty())
+	{
+		TCallback callback = m_Callbacks.dequeue();
+		if (callback)
+			callback(reply);
+	}
+}
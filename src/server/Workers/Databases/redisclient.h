@@ -0,0 +1,89 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef REDISCLIENT_H
+#define REDISCLIENT_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QByteArray>
+#include <QVector>
+#include <QQueue>
+#include <QList>
+#include <QElapsedTimer>
+
+#include <functional>
+
+struct SRedisReply
+{
+	enum EType
+	{
+		Null,
+		Status,
+		Error,
+		Integer,
+		Bulk,
+		Array,
+	};
+
+	SRedisReply() : type(Null), integer(0) {}
+
+	bool                 IsNull() const { return type == Null; }
+	bool                 IsError() const { return type == Error; }
+	bool                 IsOk() const { return type == Status && string == "OK"; }
+
+	EType                type;
+	QByteArray           string;
+	qint64               integer;
+	QVector<SRedisReply> elements;
+};
+
+// Minimal RESP client on Qt socket.
+// Commands are only queued by Command() and go to server together on Flush() or Commit(),
+// so several commands cost one round trip. Replies come in same order and call callbacks.
+// In thread with event loop use Flush() and callbacks called from readyRead.
+// In thread without event loop (database task pool) use Commit(), it wait all replies.
+// Client isn't thread-safe, every thread use own client.
+class RedisClient : public QObject
+{
+	Q_OBJECT
+public:
+	typedef std::function<void(const SRedisReply&)> TCallback;
+
+	explicit RedisClient(QObject *parent = nullptr);
+	~RedisClient();
+public:
+	bool                  Connect(const QString &host, quint16 port, int timeout);
+	bool                  IsConnected();
+	void                  Disconnect();
+
+	void                  Command(const QList<QByteArray> &args, const TCallback &callback = TCallback());
+	// Blocking : write queued commands and wait replies for all of them
+	bool                  Commit(int timeout);
+	// Blocking : one command, one round trip
+	SRedisReply           Execute(const QList<QByteArray> &args, int timeout);
+
+	int                   GetPendingCount() { return m_Callbacks.size(); }
+private:
+	void                  ReadReplies();
+	// Return 1 if reply parsed, 0 if need more data, -1 if stream corrupted
+	int                   ParseReply(int &pos, SRedisReply &reply);
+	int                   ParseLine(int pos, QByteArray &line);
+	void                  FailPending(const QByteArray &error);
+public slots:
+	void                  Flush();
+private slots:
+	void                  readyRead();
+	void                  socketDisconnected();
+signals:
+	void                  disconnected();
+private:
+	QTcpSocket*           m_Socket;
+	QByteArray            m_WriteBuffer;
+	QByteArray            m_ReadBuffer;
+	int                   m_ReadPos;
+	QQueue<TCallback>     m_Callbacks;
+	QElapsedTimer         m_LastConnectTry;
+};
+
+#endif // REDISCLIENT_H
@@ -4,7 +4,6 @@
 #include <QThread>
 #include <QEventLoop>
 #include <QTimer>
-#include <cpp_redis/cpp_redis>
 
 #include "global.h"
 #include "redisconnector.h"
@@ -13,7 +12,9 @@
 #include "Tools/settings.h"
 
 RedisConnector::RedisConnector(QObject *parent) : QObject(parent),
-	pClient(nullptr)
+	m_Port(0),
+	m_Timeout(0),
+	bPingPending(false)
 {
 	connect(&m_Timer, &QTimer::timeout, this, &RedisConnector::update);
 }
@@ -23,11 +24,7 @@ RedisConnector::~RedisConnector()
 	qDebug() << "~RedisConnector";
 
 	m_Timer.stop();
-
-	if (IsConnected())
-		Disconnect();
-
-	SAFE_DELETE(pClient);
+	Disconnect();
 }
 
 void RedisConnector::run()
@@ -49,22 +46,14 @@ void RedisConnector::run()
 
 bool RedisConnector::Connect()
 {
-	pClient = new cpp_redis::redis_client();
-
-	std::string ip = gEnv->pSettings->GetVariable("redis_ip").toString().toStdString();
-	int port = gEnv->pSettings->GetVariable("redis_port").toInt();
+	m_Host = gEnv->pSettings->GetVariable("redis_ip").toString();
+	m_Port = static_cast<quint16>(gEnv->pSettings->GetVariable("redis_port").toInt());
+	m_Timeout = gEnv->pSettings->GetVariable("redis_timeout").toInt();
 
-	try
-	{
-		qDebug() << "Connecting to redis...";
+	qDebug() << "Connecting to redis...";
 
-		pClient->connect(ip, port);
-	}
-	catch (const cpp_redis::redis_error& error)
-	{
-		qDebug() << "ERROR" << error.what();
+	if (!GetClient()->IsConnected())
 		return false;
-	}
 
 	qDebug() << "Redis connected";
 	m_Timer.start(1000);
@@ -74,208 +63,221 @@ bool RedisConnector::Connect()
 
 bool RedisConnector::IsConnected()
 {
-	return pClient && pClient->is_connected() ? true : false;
+	return GetClient()->IsConnected();
 }
 
 void RedisConnector::Disconnect()
 {
 	gEnv->m_ServerStatus.m_DBStatus = "offline";
 
-	if (IsConnected())
-		pClient->disconnect();
+	// Connections of database threads closed with their threads
+	if (m_Clients.hasLocalData())
+		m_Clients.localData()->Disconnect();
 }
 
-bool RedisConnector::HEXISTS(const QString & key, const QString & field)
+RedisClient * RedisConnector::GetClient()
+{
+	if (!m_Clients.hasLocalData())
+		m_Clients.setLocalData(new RedisClient);
+
+	RedisClient* pClient = m_Clients.localData();
+
+	if (!pClient->IsConnected())
+		pClient->Connect(m_Host, m_Port, m_Timeout);
+
+	return pClient;
+}
+
+SRedisReply RedisConnector::Execute(const QList<QByteArray>& args)
+{
+	return GetClient()->Execute(args, m_Timeout);
+}
+
+QVector<SRedisReply> RedisConnector::Pipeline(const QVector<QList<QByteArray>>& commands)
 {
-	bool result = false;
+	QVector<SRedisReply> replies(commands.size());
+	RedisClient* pClient = GetClient();
 
-	if (pClient->is_connected())
+	for (int i = 0; i < commands.size(); ++i)
 	{
-		try
-		{			
-			pClient->hexists(key.toStdString(), field.toStdString(), [&](cpp_redis::reply& reply)
-			{
-				qDebug() << "HEXISTS success. Result" << reply.as_integer();			
-
-				result = reply.as_integer() == 1 ? true : false;
-			});		
-
-			pClient->sync_commit();
-		}
-		catch (const cpp_redis::redis_error& error)
+		SRedisReply* pReply = &replies[i];
+
+		pClient->Command(commands[i], [pReply](const SRedisReply &reply)
 		{
-			qWarning() << "HEXISTS error - " << error.what();
-			result = false;
-		}
+			*pReply = reply;
+		});
 	}
-	else
-		qCritical() << "Redis not connected";
 
-	return result;
+	pClient->Commit(m_Timeout);
+
+	return replies;
 }
 
-bool RedisConnector::HMSET(const QString & key, const std::vector<std::pair<std::string, std::string>>& field_val)
+QList<QByteArray> RedisConnector::MakeHMSET(const QString & key, const std::vector<std::pair<std::string, std::string>>& field_val)
+{
+	QList<QByteArray> args;
+	args.reserve(2 + static_cast<int>(field_val.size()) * 2);
+
+	args << "HMSET" << key.toUtf8();
+
+	for (auto it = field_val.begin(); it != field_val.end(); ++it)
+		args << QByteArray::fromStdString(it->first) << QByteArray::fromStdString(it->second);
+
+	return args;
+}
+
+QVector<std::pair<std::string, std::string>> RedisConnector::ToPairs(const SRedisReply & reply)
+{
+	QVector<std::pair<std::string, std::string>> pairs;
+
+	if (reply.type != SRedisReply::Array)
+		return pairs;
+
+	pairs.reserve(reply.elements.size() / 2);
+
+	for (int i = 0; i + 1 < reply.elements.size(); i += 2)
+		pairs.push_back(std::make_pair(reply.elements[i].string.toStdString(), reply.elements[i + 1].string.toStdString()));
+
+	return pairs;
+}
+
+SRedisReply RedisConnector::EVAL(const QByteArray & script, const QList<QByteArray>& keys)
+{
+	QList<QByteArray> args;
+	args << "EVAL" << script << QByteArray::number(keys.size()) << keys;
+
+	SRedisReply reply = Execute(args);
+
+	if (reply.IsError())
+		qWarning() << "EVAL error - " << reply.string;
+
+	return reply;
+}
+
+bool RedisConnector::HEXISTS(const QString & key, const QString & field)
 {
-	bool result = false;
+	SRedisReply reply = Execute({ "HEXISTS", key.toUtf8(), field.toUtf8() });
 
-	if (pClient->is_connected())
+	if (reply.IsError())
 	{
-		try
-		{
-			pClient->hmset(key.toStdString(), field_val, [&](cpp_redis::reply & reply)
-			{
-				qDebug() << "HMSET success. Result" << reply.as_string().c_str();
+		qWarning() << "HEXISTS error - " << reply.string;
+		return false;
+	}
 
-				result = reply.as_string() == "OK" ? true : false;
-			});
+	qDebug() << "HEXISTS success. Result" << reply.integer;
 
-			pClient->sync_commit();
-		}
-		catch (const cpp_redis::redis_error& error)
-		{
-			qWarning() << "HMSET error - " << error.what();
-		}
+	return reply.integer == 1 ? true : false;
+}
+
+bool RedisConnector::HMSET(const QString & key, const std::vector<std::pair<std::string, std::string>>& field_val)
+{
+	SRedisReply reply = Execute(MakeHMSET(key, field_val));
+
+	if (reply.IsError())
+	{
+		qWarning() << "HMSET error - " << reply.string;
+		return false;
 	}
-	else
-		qWarning() << "Redis not connected";
 
-	return result;
+	qDebug() << "HMSET success. Result" << reply.string;
+
+	return reply.IsOk();
 }
 
 QVector<std::pair<std::string, std::string>> RedisConnector::HGETALL(const QString & key)
 {
 	QVector<std::pair<std::string, std::string>> m_Result;
 
-	if (pClient->is_connected())
+	SRedisReply reply = Execute({ "HGETALL", key.toUtf8() });
+
+	if (reply.IsError())
 	{
-		try
-		{
-			pClient->hgetall(key.toStdString(), [&](cpp_redis::reply & reply)
-			{
-				if (reply.is_array())
-				{
-					std::vector<cpp_redis::reply> replyArray = reply.as_array();
-					qDebug() << "HGETALL success. Array size" << replyArray.size();
-
-					if (replyArray.size() > 0)
-					{
-						for (int i = 0; i < replyArray.size() - 1; i++)
-						{
-							std::pair<std::string, std::string> m_KeyValue;
-							m_KeyValue.first = replyArray[i].as_string();
-							m_KeyValue.second = replyArray[++i].as_string();
-
-							qDebug() << "Key (" << m_KeyValue.first.c_str() << ") Value (" << m_KeyValue.second.c_str() << ")";
-
-							m_Result.push_back(m_KeyValue);
-						}
-					}
-				}
-			});
-
-			pClient->sync_commit();
-
-		}
-		catch (const cpp_redis::redis_error& error)
-		{
-			qWarning() << "HGETALL error - " << error.what();
-		}
+		qWarning() << "HGETALL error - " << reply.string;
+		return m_Result;
 	}
-	else
-		qWarning() << "Redis not connected";
+
+	m_Result = ToPairs(reply);
+	qDebug() << "HGETALL success. Fields count" << m_Result.size();
 
 	return m_Result;
 }
 
 bool RedisConnector::SET(const QString & key, const QString & value)
 {
-	bool result = false;
+	SRedisReply reply = Execute({ "SET", key.toUtf8(), value.toUtf8() });
 
-	if (pClient->is_connected())
+	if (reply.IsError())
 	{
-		try
-		{
-			pClient->set(key.toStdString(), value.toStdString(), [&](cpp_redis::reply & reply)
-			{
-				qDebug() << "SET success. Result" << reply.as_string().c_str();
-
-				result = reply.as_string() == "OK" ? true : false;
-			});
-
-			pClient->sync_commit();
-
-		}
-		catch (const cpp_redis::redis_error& error)
-		{
-			qWarning() << "SET error - " << error.what();
-		}
+		qWarning() << "SET error - " << reply.string;
+		return false;
 	}
-	else
-		qWarning() << "Redis not connected";
 
-	return result;
+	qDebug() << "SET success. Result" << reply.string;
+
+	return reply.IsOk();
 }
 
 QString RedisConnector::GET(const QString & key)
 {
 	QString result;
 
-	if (pClient->is_connected())
+	SRedisReply reply = Execute({ "GET", key.toUtf8() });
+
+	if (reply.IsError())
 	{
-		try
-		{
-			pClient->get (key.toStdString(), [&](cpp_redis::reply & reply)
-			{
-				if (reply.is_bulk_string())
-				{
-					result = reply.as_string().c_str();
-					qDebug() << "GET success. Result" << result;
-				}
-				else if (reply.is_null())
-				{
-					result = QString();
-					qDebug() << "GET success. Result NULL";
-				}
-			});
-
-			pClient->sync_commit();
-		}
-		catch (const cpp_redis::redis_error& error)
-		{
-			qWarning() << "GET error - " << error.what();
-		}
+		qWarning() << "GET error - " << reply.string;
+	}
+	else if (reply.type == SRedisReply::Bulk)
+	{
+		result = QString::fromUtf8(reply.string);
+		qDebug() << "GET success. Result" << result;
+	}
+	else if (reply.IsNull())
+	{
+		qDebug() << "GET success. Result NULL";
 	}
-	else
-		qWarning() << "Redis not connected";
 
 	return result;
 }
 
 void RedisConnector::BGSAVE()
 {
-	if (pClient->is_connected())
-	{
-		try
-		{
-			pClient->bgsave([](cpp_redis::reply & reply)
-			{
-				qDebug() << "BGSAVE success";
-			});
-			pClient->sync_commit();
-		}
-		catch (const cpp_redis::redis_error& error)
-		{
-			qWarning() << "BGSAVE error - " << error.what();
-		}
-	}
+	SRedisReply reply = Execute({ "BGSAVE" });
+
+	if (reply.IsError())
+		qWarning() << "BGSAVE error - " << reply.string;
 	else
-		qWarning() << "Redis not connected";
+		qDebug() << "BGSAVE success";
 }
 
 void RedisConnector::update()
 {
-	if (!IsConnected())
+	RedisClient* pClient = GetClient();
+
+	if (!pClient->IsConnected())
+	{
 		emit disconnected();
+		return;
+	}
+
+	if (bPingPending)
+	{
+		qWarning() << "Redis not answered on PING";
+		return;
+	}
+
+	// Checked in event loop, server thread don't wait for answer
+	bPingPending = true;
+
+	pClient->Command({ "PING" }, [this](const SRedisReply &reply)
+	{
+		bPingPending = false;
+
+		if (reply.IsError())
+			qWarning() << "PING error - " << reply.string;
+	});
+
+	pClient->Flush();
 }
 
 void RedisConnector::disconnected()
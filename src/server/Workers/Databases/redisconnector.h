@@ -6,12 +6,14 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QThreadStorage>
+#include <QVector>
+#include <QList>
 
-namespace cpp_redis
-{
-	class redis_client;
-}
+#include "redisclient.h"
 
+// Every thread work with Redis by own connection, created on first use.
+// Database tasks don't wait each other and don't share socket
 class RedisConnector : public QObject
 {
     Q_OBJECT
@@ -23,6 +25,8 @@ public:
 	bool                                         Connect();
 	bool                                         IsConnected();
 	void                                         Disconnect();
+	// Connection of calling thread
+	RedisClient*                                 GetClient();
 public:
 	bool                                         HEXISTS(const QString &key, const QString &field);
 	bool                                         HMSET(const QString &key, const std::vector<std::pair<std::string, std::string>>& field_val);
@@ -30,12 +34,26 @@ public:
 	bool                                         SET(const QString &key, const QString &value);
 	QString                                      GET(const QString &key);	
 	void                                         BGSAVE();
+	// Send all commands with one write and wait all replies in one round trip
+	QVector<SRedisReply>                         Pipeline(const QVector<QList<QByteArray>> &commands);
+	// Run Lua script on server, several dependent reads cost one round trip
+	SRedisReply                                  EVAL(const QByteArray &script, const QList<QByteArray> &keys);
+
+	static QList<QByteArray>                     MakeHMSET(const QString &key, const std::vector<std::pair<std::string, std::string>>& field_val);
+	// HGETALL reply to field-value pairs
+	static QVector<std::pair<std::string, std::string>> ToPairs(const SRedisReply &reply);
 public slots:
 	void                                         disconnected();
 	void                                         update();
 private:
-	cpp_redis::redis_client*                     pClient;
+	SRedisReply                                  Execute(const QList<QByteArray> &args);
+private:
+	QThreadStorage<RedisClient*>                 m_Clients;
+	QString                                      m_Host;
+	quint16                                      m_Port;
+	int                                          m_Timeout;
 	QTimer                                       m_Timer;
+	bool                                         bPingPending;
 };
 
 #endif // REDISCONNECTOR_H
@@ -8,6 +8,8 @@
 #include "Core/tcpserver.h"
 
 #include "Workers/Databases/dbworker.h"
+#include "Workers/Databases/nicknameindex.h"
+#include "Workers/Databases/profilecache.h"
 
 #include "Tools/settings.h"
 #include "Tools/scripts.h"
@@ -47,7 +49,11 @@ void ClientQuerys::onLogin(CTcpPacket &packet)
 	TcpServer* pServer = gEnv->pServer;
 	DBWorker* pDataBase = gEnv->pDBWorker;
 
-	if (!(pDataBase->UserExists(login)))
+	// User and profile come in one database request
+	SUser userData;
+	SProfilePtr dbProfile;
+
+	if (!pDataBase->GetLoginData(login, userData, dbProfile))
 	{
 		qDebug() << "-----------------------Login not found------------------------";
 		qDebug() << "---------------------AUTHORIZATION FAILED---------------------";
@@ -60,82 +66,64 @@ void ClientQuerys::onLogin(CTcpPacket &packet)
 
 		return;
 	}
-	else
-	{
-		SUser *userData = pDataBase->GetUserData(login);
-		if (userData == nullptr)
-			return;
-
-		// Check ban status
-		if (userData->bBanStatus)
-		{
-			qDebug() << "-----------------------Account blocked------------------------";
-			qDebug() << "---------------------AUTHORIZATION FAILED---------------------";
 
-			// Auth failed
-			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
-			m_packet.WriteError(EFireNetTcpError::LoginFail);
-			m_packet.WriteInt(1);
-			m_Connection->SendMessage( m_packet);
-			return;
-		}
+	// Check ban status
+	if (userData.bBanStatus)
+	{
+		qDebug() << "-----------------------Account blocked------------------------";
+		qDebug() << "---------------------AUTHORIZATION FAILED---------------------";
 
-		// Check passwords
-		if (password == userData->password)
-		{
-			if (pDataBase->ProfileExists(userData->uid))
-			{
-				SProfile *dbProfile = pDataBase->GetUserProfile(userData->uid);
-				if (dbProfile)
-				{
-					bAuthorizated = true;
-					m_Client->profile = dbProfile;
-					m_Client->status = 1;
-					pServer->UpdateClient(m_Client);
+		// Auth failed
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::LoginFail);
+		m_packet.WriteInt(1);
+		m_Connection->SendMessage( m_packet);
+		return;
+	}
 
-					qDebug() << "-------------------------Profile found--------------------------";
-					qDebug() << "---------------------AUTHORIZATION COMPLETE---------------------";
+	// Check passwords
+	if (password != userData.password)
+	{
+		qDebug() << "----------------------Incorrect password----------------------";
+		qDebug() << "---------------------AUTHORIZATION FAILED---------------------";
 
-					CTcpPacket m_packet(EFireNetTcpPacketType::Result);
-					m_packet.WriteResult(EFireNetTcpResult::LoginCompleteWithProfile);
-					m_Connection->SendMessage(m_packet);
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::LoginFail);
+		m_packet.WriteInt(2);
+		m_Connection->SendMessage( m_packet);
+		return;
+	}
 
-					return;
-				}
-				else
-				{
-					qWarning() << "Profile finded, but can't get it from database!";
-					return;
-				}
-			}
-			else
-			{
-				qDebug() << "-----------------------Profile not found------------------------";
-				qDebug() << "---------------------AUTHORIZATION COMPLETE---------------------";
+	if (dbProfile)
+	{
+		bAuthorizated = true;
+		m_Client->profile = dbProfile;
+		m_Client->status = 1;
+		pServer->UpdateClient(m_Client);
+		pServer->GetPresence()->SetOnline(dbProfile->uid, dbProfile->friends);
 
-				CTcpPacket m_packet(EFireNetTcpPacketType::Result);
-				m_packet.WriteResult(EFireNetTcpResult::LoginComplete);
-				m_Connection->SendMessage(m_packet);
+		qDebug() << "-------------------------Profile found--------------------------";
+		qDebug() << "---------------------AUTHORIZATION COMPLETE---------------------";
 
-				bAuthorizated = true;
-				m_Client->profile->uid = userData->uid;
-				m_Client->status = 0;
-				pServer->UpdateClient(m_Client);
+		// Profile sended with login result, client don't need ask it again
+		CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+		m_packet.WriteResult(EFireNetTcpResult::LoginCompleteWithProfile);
+		WriteProfile(m_packet, *dbProfile);
+		m_Connection->SendMessage(m_packet);
+	}
+	else
+	{
+		qDebug() << "-----------------------Profile not found------------------------";
+		qDebug() << "---------------------AUTHORIZATION COMPLETE---------------------";
 
-				return;
-			}
-		}
-		else
-		{
-			qDebug() << "----------------------Incorrect password----------------------";
-			qDebug() << "---------------------AUTHORIZATION FAILED---------------------";
+		CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+		m_packet.WriteResult(EFireNetTcpResult::LoginComplete);
+		m_Connection->SendMessage(m_packet);
 
-			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
-			m_packet.WriteError(EFireNetTcpError::LoginFail);
-			m_packet.WriteInt(2);
-			m_Connection->SendMessage( m_packet);
-			return;
-		}
+		bAuthorizated = true;
+		m_Client->profile->uid = userData.uid;
+		m_Client->status = 0;
+		pServer->UpdateClient(m_Client);
 	}
 }
 
@@ -261,10 +249,10 @@ void ClientQuerys::onCreateProfile(CTcpPacket &packet)
 		m_Client->profile->money = 10000; // TODO
 		m_Client->profile->xp = 0;
 		m_Client->profile->lvl = 0;
-		m_Client->profile->items = "";
-		m_Client->profile->friends = "";
+		m_Client->profile->items.clear();
+		m_Client->profile->friends.clear();
 
-		if (pDataBase->CreateProfile(m_Client->profile))
+		if (pDataBase->CreateProfile(m_Client->profile.data()))
 		{
 			qDebug() << "---------------------CREATE PROFILE COMPLETE---------------------";
 
@@ -276,14 +264,15 @@ void ClientQuerys::onCreateProfile(CTcpPacket &packet)
 			m_paket.WriteInt(m_Client->profile->lvl);
 			m_paket.WriteInt(m_Client->profile->xp);
 			m_paket.WriteInt(m_Client->profile->money);
-			m_paket.WriteString(m_Client->profile->items.toStdString());
-			m_paket.WriteString(m_Client->profile->friends.toStdString());
+			m_paket.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+			m_paket.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 
 			m_Connection->SendMessage(m_paket);
 
 			bProfileCreated = true;
 			m_Client->status = 1;
 			pServer->UpdateClient(m_Client);
+			pServer->GetPresence()->SetOnline(m_Client->profile->uid, m_Client->profile->friends);
 
 			return;
 		}
@@ -328,14 +317,7 @@ void ClientQuerys::onGetProfile()
 
 		CTcpPacket profile(EFireNetTcpPacketType::Result);
 		profile.WriteResult(EFireNetTcpResult::GetProfileComplete);
-		profile.WriteInt(m_Client->profile->uid);
-		profile.WriteString(m_Client->profile->nickname.toStdString());
-		profile.WriteString(m_Client->profile->fileModel.toStdString());
-		profile.WriteInt(m_Client->profile->lvl);
-		profile.WriteInt(m_Client->profile->xp);
-		profile.WriteInt(m_Client->profile->money);
-		profile.WriteString(m_Client->profile->items.toStdString());
-		profile.WriteString(m_Client->profile->friends.toStdString());
+		WriteProfile(profile, *m_Client->profile);
 		m_Connection->SendMessage( profile);
 		return;
 	}
@@ -352,7 +334,8 @@ void ClientQuerys::onGetProfile()
 }
 
 // Error types : 0 - Can't get shop from shop.xml
-void ClientQuerys::onGetShopItems()
+// Client send version of shop he have, unchanged shop not sended again
+void ClientQuerys::onGetShopItems(CTcpPacket &packet)
 {
 	if (m_Client->profile->uid <= 0)
 	{
@@ -360,34 +343,30 @@ void ClientQuerys::onGetShopItems()
 		return;
 	}
 
-	QVector<SShopItem> m_shop = gEnv->pScripts->GetShop();
+	SShopCatalogPtr shop = gEnv->pScripts->GetShop();
 
-	if (m_shop.size() > 0)
+	if (shop && shop->items.size() > 0)
 	{
-		QStringList m_shopList;
+		// Old clients don't send version
+		int version = packet.CanReadMore() ? packet.ReadInt() : 0;
 
-		for (auto it = m_shop.begin(); it != m_shop.end(); ++it)
+		if (version == shop->version)
 		{
-			int bCanbay;
-			it->canBuy ? bCanbay = 1 : bCanbay = 0;
-
-			// name-cost-minLvl-canBuy
-			m_shopList.append(it->name + "-" + 
-				QString::number(it->cost) + "-" + 
-				QString::number(it->minLnl) + "-" + 
-			    QString::number(bCanbay));
+			CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+			m_packet.WriteResult(EFireNetTcpResult::GetShopNotModified);
+			m_packet.WriteInt(shop->version);
+			m_Connection->SendMessage(m_packet);
+			return;
 		}
 
-		CTcpPacket m_packet(EFireNetTcpPacketType::Result);
-		m_packet.WriteResult(EFireNetTcpResult::GetShopComplete);
-		m_packet.WriteString(m_shopList.join(",").toStdString());
-		m_Connection->SendMessage( m_packet);
+		m_Connection->SendEncoded(shop->packet, EFireNetTcpPacketType::Result);
 	}
 	else
 	{
 		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
 		m_packet.WriteError(EFireNetTcpError::GetShopFail);
 		m_packet.WriteInt(0);
+		m_Connection->SendMessage(m_packet);
 
 		return;
 	}
@@ -412,16 +391,14 @@ void ClientQuerys::onBuyItem(CTcpPacket &packet)
 		return;
 	}
 
-	SShopItem item = GetShopItemByName(itemName);
+	SShopItem item = gEnv->pScripts->GetShopItem(itemName);
 
 	if (!m_Client->profile->nickname.isEmpty())
 	{
 		if (!item.name.isEmpty())
 		{
-			QStringList itemList = m_Client->profile->items.split(",");
-
 			// Check if it is there in inventory
-			if (itemList.contains(item.name))
+			if (m_Client->profile->items.contains(item.name))
 			{
 				qDebug() << "------------------This item alredy purchased------------------";
 				qDebug() << "------------------------BUY ITEM FAILED-----------------------";
@@ -452,11 +429,13 @@ void ClientQuerys::onBuyItem(CTcpPacket &packet)
 
 				// Add item and update money
 				m_Client->profile->money = m_Client->profile->money - item.cost;
-				itemList.append(item.name);
-				m_Client->profile->items = itemList.join(",");
+				m_Client->profile->items.insert(item.name);
+
+				SProfileDelta delta;
+				delta.AddItem(item.name);
 
 				// Update profile
-				if (UpdateProfile(m_Client->profile))
+				if (UpdateProfile(m_Client->profile, ProfileMoney | ProfileItems, delta))
 				{
 					qDebug() << "----------------------Profile updated----------------------";
 					qDebug() << "---------------------BUI ITEM COMPLETE---------------------";
@@ -469,8 +448,8 @@ void ClientQuerys::onBuyItem(CTcpPacket &packet)
 					profile.WriteInt(m_Client->profile->lvl);
 					profile.WriteInt(m_Client->profile->xp);
 					profile.WriteInt(m_Client->profile->money);
-					profile.WriteString(m_Client->profile->items.toStdString());
-					profile.WriteString(m_Client->profile->friends.toStdString());
+					profile.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+					profile.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 					m_Connection->SendMessage( profile);
 					return;
 				}
@@ -545,7 +524,7 @@ void ClientQuerys::onRemoveItem(CTcpPacket &packet)
 	if (!m_Client->profile->nickname.isEmpty())
 	{
 		// Search item in shop list
-		SShopItem item = GetShopItemByName(itemName);
+		SShopItem item = gEnv->pScripts->GetShopItem(itemName);
 		if (item.name.isEmpty())
 		{
 			qDebug() << "-------------------Item not found in shop list-------------------";
@@ -559,9 +538,7 @@ void ClientQuerys::onRemoveItem(CTcpPacket &packet)
 		}
 
 		// Check item if it is there in item list
-		QStringList itemList = m_Client->profile->items.split(",");
-
-		if (!itemList.contains(item.name))
+		if (!m_Client->profile->items.contains(item.name))
 		{
 			qDebug() << "-------------------Item not found in inventory--------------------";
 			qDebug() << "------------------------REMOVE ITEM FAILED-----------------------";
@@ -575,11 +552,13 @@ void ClientQuerys::onRemoveItem(CTcpPacket &packet)
 		else
 		{
 			// Remove item
-			bool result = itemList.removeOne(item.name);
-			m_Client->profile->items = itemList.join(",");
+			m_Client->profile->items.remove(item.name);
+
+			SProfileDelta delta;
+			delta.RemoveItem(item.name);
 
 			// Update profile
-			if (result && UpdateProfile(m_Client->profile))
+			if (UpdateProfile(m_Client->profile, ProfileItems, delta))
 			{
 				qDebug() << "-----------------------Profile updated------------------------";
 				qDebug() << "---------------------REMOVE ITEM COMPLETE---------------------";
@@ -592,8 +571,8 @@ void ClientQuerys::onRemoveItem(CTcpPacket &packet)
 				profile.WriteInt(m_Client->profile->lvl);
 				profile.WriteInt(m_Client->profile->xp);
 				profile.WriteInt(m_Client->profile->money);
-				profile.WriteString(m_Client->profile->items.toStdString());
-				profile.WriteString(m_Client->profile->friends.toStdString());
+				profile.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+				profile.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 				m_Connection->SendMessage( profile);
 				return;
 			}
@@ -643,14 +622,14 @@ void ClientQuerys::onInvite(CTcpPacket &packet)
 	}
 
 	TcpServer* pServer = gEnv->pServer;
-	DBWorker* pDataBase = gEnv->pDBWorker;
 
 	// Friend invite
 	if (inviteType == "friend_invite")
 	{
-		int friendUID = pDataBase->GetUIDbyNick(reciver);
+		// Invite can get only online player, offline player only checked in database
+		SConnectionRoute reciverRoute = pServer->GetRouteByNickname(reciver);
 
-		if (!pDataBase->ProfileExists(friendUID))
+		if (!reciverRoute.IsValid() && !gEnv->pDBWorker->NicknameExists(reciver))
 		{
 			qDebug() << "------------------------User not found------------------------";
 			qDebug() << "---------------------INVITE FRIEND FAILED---------------------";
@@ -662,9 +641,7 @@ void ClientQuerys::onInvite(CTcpPacket &packet)
 			return;
 		}
 
-		QSslSocket* reciverSocket = pServer->GetSocketByUid(friendUID);
-
-		if (reciverSocket != nullptr)
+		if (reciverRoute.IsValid())
 		{
 			// Send result to client
 			CTcpPacket m_packet(EFireNetTcpPacketType::Result);
@@ -676,7 +653,7 @@ void ClientQuerys::onInvite(CTcpPacket &packet)
 			invite.WriteQuery(EFireNetTcpQuery::SendInvite);
 			invite.WriteInt(0); // Friend invite
 			invite.WriteString(m_Client->profile->nickname.toStdString()); // From
-			pServer->sendMessageToClient(reciverSocket, invite);
+			pServer->sendMessageToClient(reciverRoute, invite);
 			return;
 		}
 		else
@@ -723,25 +700,16 @@ void ClientQuerys::onDeclineInvite(CTcpPacket &packet)
 	}
 
 	TcpServer* pServer = gEnv->pServer;
-	DBWorker* pDataBase = gEnv->pDBWorker;
-
-	int friendUID = pDataBase->GetUIDbyNick(reciver);
-
-	if (!pDataBase->ProfileExists(friendUID))
-	{
-		qDebug() << "------------------------User not found-------------------------";
-		qDebug() << "---------------------DECLINE INVITE FAILED---------------------";
-		return;
-	}
 
-	QSslSocket* reciverSocket = pServer->GetSocketByUid(friendUID);
+	// Invite sender must be online, so registry is enough
+	SConnectionRoute reciverRoute = pServer->GetRouteByNickname(reciver);
 
-	if (reciverSocket != nullptr)
+	if (reciverRoute.IsValid())
 	{
 		// Send decline invite to invite sender
 		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
 		m_packet.WriteError(EFireNetTcpError::SendInviteFail);
-		pServer->sendMessageToClient(reciverSocket, m_packet);
+		pServer->sendMessageToClient(reciverRoute, m_packet);
 		return;
 	}
 	else
@@ -777,15 +745,12 @@ void ClientQuerys::onAddFriend(CTcpPacket &packet)
 
 	if (pDataBase->ProfileExists(friendUID))
 	{
-		SProfile *friendProfile = pDataBase->GetUserProfile(friendUID);
+		SProfilePtr friendProfile = pDataBase->GetUserProfile(friendUID);
 
-		if (!m_Client->profile->nickname.isEmpty() && friendProfile != nullptr)
+		if (!m_Client->profile->nickname.isEmpty() && friendProfile)
 		{
-			QStringList friendList = m_Client->profile->friends.split(",");
-			QStringList friendFriendList = friendProfile->friends.split(",");
-
 			// Check friend is there in friends list
-			if (friendList.contains(friendProfile->nickname))
+			if (m_Client->profile->friends.contains(friendProfile->uid))
 			{
 				qDebug() << "--------------------This friend alredy added--------------------";
 				qDebug() << "------------------------ADD FRIEND FAILED-----------------------";
@@ -809,15 +774,26 @@ void ClientQuerys::onAddFriend(CTcpPacket &packet)
 			}
 
 			// Update friend list
-			friendList.append(QString::number(friendProfile->uid));
-			friendFriendList.append(QString::number(m_Client->profile->uid));
-			m_Client->profile->friends = friendList.join(",");
-			friendProfile->friends = friendFriendList.join(",");
+			m_Client->profile->friends.insert(friendProfile->uid);
+			friendProfile->friends.insert(m_Client->profile->uid);
+
+			SProfileDelta delta, friendDelta;
+			delta.AddFriend(friendProfile->uid);
+			friendDelta.AddFriend(m_Client->profile->uid);
 
-			QSslSocket* friendSocket = pServer->GetSocketByUid(friendUID);
+			SConnectionRoute friendRoute = pServer->GetRouteByUid(friendUID);
 
-			if (UpdateProfile(m_Client->profile) && UpdateProfile(friendProfile))
+			if (UpdateProfile(m_Client->profile, ProfileFriends, delta) && UpdateProfile(friendProfile, ProfileFriends, friendDelta))
 			{
+				// Online friend get new friend list on thread of his connection
+				const int uid = m_Client->profile->uid;
+				pServer->ModifyOnlineProfile(friendProfile->uid, [uid](SProfile &onlineProfile)
+				{
+					onlineProfile.friends.insert(uid);
+				});
+
+				pServer->GetPresence()->AddFriends(uid, friendProfile->uid);
+
 				qDebug() << "-----------------------Profile updated-----------------------";
 				qDebug() << "---------------------ADD FRIEND COMPLETE---------------------";
 
@@ -829,13 +805,13 @@ void ClientQuerys::onAddFriend(CTcpPacket &packet)
 				profile.WriteInt(m_Client->profile->lvl);
 				profile.WriteInt(m_Client->profile->xp);
 				profile.WriteInt(m_Client->profile->money);
-				profile.WriteString(m_Client->profile->items.toStdString());
-				profile.WriteString(m_Client->profile->friends.toStdString());
+				profile.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+				profile.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 
 				m_Connection->SendMessage( profile);
 
 				//Send new info to friend here
-				if (friendSocket != nullptr)
+				if (friendRoute.IsValid())
 				{
 					CTcpPacket profile(EFireNetTcpPacketType::Result);
 					profile.WriteResult(EFireNetTcpResult::AcceptInviteComplete);
@@ -845,10 +821,10 @@ void ClientQuerys::onAddFriend(CTcpPacket &packet)
 					profile.WriteInt(m_Client->profile->lvl);
 					profile.WriteInt(m_Client->profile->xp);
 					profile.WriteInt(m_Client->profile->money);
-					profile.WriteString(m_Client->profile->items.toStdString());
-					profile.WriteString(m_Client->profile->friends.toStdString());
+					profile.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+					profile.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 
-					pServer->sendMessageToClient(friendSocket, profile);
+					pServer->sendMessageToClient(friendRoute, profile);
 				}
 
 				return;
@@ -873,7 +849,7 @@ void ClientQuerys::onAddFriend(CTcpPacket &packet)
 			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
 			m_packet.WriteError(EFireNetTcpError::AcceptInviteFail);
 			m_packet.WriteInt(3);
-			m_Connection->SendMessage( packet);
+			m_Connection->SendMessage(m_packet);
 			return;
 		}
 	}
@@ -913,11 +889,12 @@ void ClientQuerys::onRemoveFriend(CTcpPacket &packet)
 
 	if (!m_Client->profile->nickname.isEmpty())
 	{
-		SProfile *friendProfile = pDataBase->GetUserProfile(pDataBase->GetUIDbyNick(friendName));
-		QStringList friendList = m_Client->profile->friends.split(",");
+		int friendUID = pDataBase->GetUIDbyNick(friendName);
+
+		SProfilePtr friendProfile = pDataBase->GetUserProfile(friendUID);
 
 		// Check friend is there in friends list
-		if (!friendProfile || friendList.contains(QString::number(friendProfile->uid)))
+		if (!friendProfile || !m_Client->profile->friends.contains(friendProfile->uid))
 		{
 			qDebug() << "--------------------------Friend not found-------------------------";
 			qDebug() << "------------------------REMOVE FRIEND FAILED-----------------------";
@@ -930,19 +907,28 @@ void ClientQuerys::onRemoveFriend(CTcpPacket &packet)
 		}
 		else
 		{
-			QStringList friendFriendList = friendProfile->friends.split(",");
-
 			// Delete friend from client's profile
-			friendList.removeOne(QString::number(friendProfile->uid));
-			m_Client->profile->friends = friendList.join(",");
+			m_Client->profile->friends.remove(friendProfile->uid);
 			// Delete client from friend's profile
-			friendFriendList.removeOne(QString::number(m_Client->profile->uid));
-			friendProfile->friends = friendFriendList.join(",");
+			friendProfile->friends.remove(m_Client->profile->uid);
 
-			QSslSocket* friendSocket = pServer->GetSocketByUid(friendProfile->uid);
+			SProfileDelta delta, friendDelta;
+			delta.RemoveFriend(friendProfile->uid);
+			friendDelta.RemoveFriend(m_Client->profile->uid);
 
-			if (UpdateProfile(m_Client->profile) && UpdateProfile(friendProfile))
+			SConnectionRoute friendRoute = pServer->GetRouteByUid(friendProfile->uid);
+
+			if (UpdateProfile(m_Client->profile, ProfileFriends, delta) && UpdateProfile(friendProfile, ProfileFriends, friendDelta))
 			{
+				// Online friend get new friend list on thread of his connection
+				const int uid = m_Client->profile->uid;
+				pServer->ModifyOnlineProfile(friendProfile->uid, [uid](SProfile &onlineProfile)
+				{
+					onlineProfile.friends.remove(uid);
+				});
+
+				pServer->GetPresence()->RemoveFriends(uid, friendProfile->uid);
+
 				qDebug() << "------------------------Profile updated-------------------------";
 				qDebug() << "---------------------REMOVE FRIEND COMPLETE---------------------";
 
@@ -954,13 +940,13 @@ void ClientQuerys::onRemoveFriend(CTcpPacket &packet)
 				profile.WriteInt(m_Client->profile->lvl);
 				profile.WriteInt(m_Client->profile->xp);
 				profile.WriteInt(m_Client->profile->money);
-				profile.WriteString(m_Client->profile->items.toStdString());
-				profile.WriteString(m_Client->profile->friends.toStdString());
+				profile.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+				profile.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 
 				m_Connection->SendMessage( profile);
 
 				//Send new info to friend here
-				if (friendSocket != nullptr)
+				if (friendRoute.IsValid())
 				{
 					CTcpPacket profile(EFireNetTcpPacketType::Result);
 					profile.WriteResult(EFireNetTcpResult::RemoveFriendComplete);
@@ -970,10 +956,10 @@ void ClientQuerys::onRemoveFriend(CTcpPacket &packet)
 					profile.WriteInt(m_Client->profile->lvl);
 					profile.WriteInt(m_Client->profile->xp);
 					profile.WriteInt(m_Client->profile->money);
-					profile.WriteString(m_Client->profile->items.toStdString());
-					profile.WriteString(m_Client->profile->friends.toStdString());
+					profile.WriteString(ItemsToString(m_Client->profile->items).toStdString());
+					profile.WriteString(FriendsToString(m_Client->profile->friends).toStdString());
 
-					pServer->sendMessageToClient(friendSocket, profile);
+					pServer->sendMessageToClient(friendRoute, profile);
 				}
 
 				return;
@@ -1004,7 +990,8 @@ void ClientQuerys::onRemoveFriend(CTcpPacket &packet)
 	}
 }
 
-// Error types : 0 - Can't send message to yourself, 1 - Reciver not online
+// Reciver is nickname, "all" for global chat or name of chat channel
+// Error types : 0 - Can't send message to yourself, 1 - Reciver not online, 2 - Channel not joined, not member or disabled, 3 - Channel flooded
 void ClientQuerys::onChatMessage(CTcpPacket &packet)
 {
 	if (m_Client->profile->uid <= 0)
@@ -1024,7 +1011,6 @@ void ClientQuerys::onChatMessage(CTcpPacket &packet)
 	}
 
 	TcpServer* pServer = gEnv->pServer;
-	DBWorker* pDataBase = gEnv->pDBWorker;
 
 	if (reciver == m_Client->profile->nickname)
 	{
@@ -1038,38 +1024,59 @@ void ClientQuerys::onChatMessage(CTcpPacket &packet)
 		return;
 	}
 
-	if (!m_Client->profile->nickname.isEmpty() && reciver == "all")
+	if (reciver == "all")
+		reciver = ChatService::GLOBAL_CHANNEL;
+
+	EChatChannelType channelType = ChatService::GetChannelType(reciver);
+
+	if (!m_Client->profile->nickname.isEmpty() && channelType != EChatChannelType::Unknown)
 	{
-		if (gEnv->pSettings->GetVariable("bUseGlobalChat").toBool())
+		if (channelType == EChatChannelType::Global && !gEnv->pSettings->GetVariable("bUseGlobalChat").toBool())
 		{
-			CTcpPacket msg(EFireNetTcpPacketType::ServerMessage);
-			msg.WriteServerMessage(EFireNetTcpSMessage::GlobalChatMsg);
-			msg.WriteString(m_Client->profile->nickname.toStdString());
-			msg.WriteString(message.toStdString());
-			pServer->sendGlobalMessage(msg);
+			qWarning() << "Client send message to global chat, but global chat now disabled, see server.cfg";
 
+			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+			m_packet.WriteError(EFireNetTcpError::SendChatMsgFail);
+			m_packet.WriteInt(2);
+			m_Connection->SendMessage(m_packet);
 			return;
 		}
-		else
+
+		if (!pServer->IsChatMember(reciver, m_Client->profile->uid))
 		{
-			qWarning() << "Client send message to global chat, but global chat now disabled, see server.cfg";
+			qDebug() << "Client" << m_Client->profile->nickname << "can't send message to" << reciver << ". Not member of channel";
+
+			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+			m_packet.WriteError(EFireNetTcpError::SendChatMsgFail);
+			m_packet.WriteInt(2);
+			m_Connection->SendMessage(m_packet);
 			return;
-		}	
+		}
+
+		qint64 result = pServer->PublishChatMessage(reciver, m_Client->profile->nickname, message, m_Connection);
+
+		if (result != 0)
+		{
+			qDebug() << "Client" << m_Client->profile->nickname << "can't send message to" << reciver << (result > 0 ? ". Channel flooded" : ". Channel not joined");
+
+			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+			m_packet.WriteError(EFireNetTcpError::SendChatMsgFail);
+			m_packet.WriteInt(result > 0 ? 3 : 2);
+			m_Connection->SendMessage(m_packet);
+		}
+
+		return;
 	}
 	else
 	{
-		int reciverUID = pDataBase->GetUIDbyNick(reciver);
+		CTcpPacket msg(EFireNetTcpPacketType::ServerMessage);
+		msg.WriteServerMessage(EFireNetTcpSMessage::PrivateChatMsg);
+		msg.WriteString(m_Client->profile->nickname.toStdString());
+		msg.WriteString(message.toStdString());
 
-		QSslSocket* reciverSocket = pServer->GetSocketByUid(reciverUID);
-
-		if (reciverSocket != nullptr)
+		// Written by thread of reciver connection
+		if (pServer->sendMessageToClient(pServer->GetRouteByNickname(reciver), msg))
 		{
-			CTcpPacket msg(EFireNetTcpPacketType::ServerMessage);
-			msg.WriteServerMessage(EFireNetTcpSMessage::PrivateChatMsg);
-			msg.WriteString(m_Client->profile->nickname.toStdString());
-			msg.WriteString(message.toStdString());
-			pServer->sendMessageToClient(reciverSocket, msg);
-
 			return;
 		}
 		else
@@ -1086,6 +1093,116 @@ void ClientQuerys::onChatMessage(CTcpPacket &packet)
 	}
 }
 
+// Error types : 0 - Wrong channel name, 1 - Too many channels, 2 - Not member of channel
+void ClientQuerys::onJoinChatChannel(CTcpPacket &packet)
+{
+	if (m_Client->profile->uid <= 0 || m_Client->profile->nickname.isEmpty())
+	{
+		qWarning() << "Client can't join chat channel without profile!!!";
+		return;
+	}
+
+	QString channel = packet.ReadString();
+
+	if (ChatService::GetChannelType(channel) == EChatChannelType::Unknown)
+	{
+		qDebug() << "----------------------Wrong chat channel name-----------------------";
+		qDebug() << "---------------------JOIN CHAT CHANNEL FAILED-----------------------";
+
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::JoinChatChannelFail);
+		m_packet.WriteInt(0);
+		m_Connection->SendMessage(m_packet);
+		return;
+	}
+
+	// Clan, party and match members are set by game servers, client can't join foreign channel
+	if (!gEnv->pServer->IsChatMember(channel, m_Client->profile->uid))
+	{
+		qDebug() << "-------------------Client not member of chat channel----------------";
+		qDebug() << "---------------------JOIN CHAT CHANNEL FAILED-----------------------";
+
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::JoinChatChannelFail);
+		m_packet.WriteInt(2);
+		m_Connection->SendMessage(m_packet);
+		return;
+	}
+
+	if (!gEnv->pServer->JoinChatChannel(channel, m_Connection))
+	{
+		qDebug() << "------------------Client have too many chat channels----------------";
+		qDebug() << "---------------------JOIN CHAT CHANNEL FAILED-----------------------";
+
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::JoinChatChannelFail);
+		m_packet.WriteInt(1);
+		m_Connection->SendMessage(m_packet);
+		return;
+	}
+
+	CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+	m_packet.WriteResult(EFireNetTcpResult::JoinChatChannelComplete);
+	m_packet.WriteString(channel.toStdString());
+	m_Connection->SendMessage(m_packet);
+
+	// Late joiner get last messages of channel
+	QList<QByteArray> history = gEnv->pServer->GetChatHistory(channel);
+
+	for (auto it = history.constBegin(); it != history.constEnd(); ++it)
+		m_Connection->SendEncoded(*it, EFireNetTcpPacketType::ServerMessage);
+}
+
+// Error types : 0 - Channel not joined
+void ClientQuerys::onLeaveChatChannel(CTcpPacket &packet)
+{
+	QString channel = packet.ReadString();
+
+	if (gEnv->pServer->LeaveChatChannel(channel, m_Connection))
+	{
+		CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+		m_packet.WriteResult(EFireNetTcpResult::LeaveChatChannelComplete);
+		m_packet.WriteString(channel.toStdString());
+		m_Connection->SendMessage(m_packet);
+	}
+	else
+	{
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::LeaveChatChannelFail);
+		m_packet.WriteInt(0);
+		m_Connection->SendMessage(m_packet);
+	}
+}
+
+// Error types : 0 - Wrong status
+void ClientQuerys::onSetStatus(CTcpPacket &packet)
+{
+	if (m_Client->profile->uid <= 0 || m_Client->status != 1)
+	{
+		qWarning() << "Client can't set status without profile!!!";
+		return;
+	}
+
+	int status = packet.ReadInt();
+
+	if (!gEnv->pServer->GetPresence()->SetStatus(m_Client->profile->uid, status))
+	{
+		qDebug() << "-------------------------Wrong status-------------------------";
+		qDebug() << "---------------------SET STATUS FAILED------------------------";
+
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::SetStatusFail);
+		m_packet.WriteInt(0);
+		m_Connection->SendMessage(m_packet);
+		return;
+	}
+
+	CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+	m_packet.WriteResult(EFireNetTcpResult::SetStatusComplete);
+	m_packet.WriteInt(status);
+	m_Connection->SendMessage(m_packet);
+}
+
 // Error types : 0 - Not any online servers, 1 - Server not found
 void ClientQuerys::onGetGameServer(CTcpPacket &packet)
 {
@@ -1095,10 +1212,9 @@ void ClientQuerys::onGetGameServer(CTcpPacket &packet)
 		return;
 	}
 
-	int gameServersCount = 0;
-	gEnv->pRemoteServer->IsHaveAdmin() ? gameServersCount = gEnv->pRemoteServer->GetClientCount() - 1 : gameServersCount = gEnv->pRemoteServer->GetClientCount();
+	GameServerRegistry* pGameServers = gEnv->pRemoteServer->GetGameServers();
 
-	if (gameServersCount <= 0)
+	if (pGameServers->GetCount() <= 0)
 	{
 		qDebug() << "---------------------Not any online server----------------------";
 		qDebug() << "---------------------GET GAME SERVER FAILED---------------------";
@@ -1115,19 +1231,20 @@ void ClientQuerys::onGetGameServer(CTcpPacket &packet)
 	QString gamerules = packet.ReadString();
 	QString serverName = packet.ReadString();
 
-	SGameServer* pGameServer = gEnv->pRemoteServer->GetGameServer(serverName, map, gamerules);
+	// Slot on found server is reserved for this client for a short time
+	SGameServer server;
 
-	if (pGameServer != nullptr)
+	if (pGameServers->Reserve(serverName, map, gamerules, server))
 	{
 		CTcpPacket gameServer(EFireNetTcpPacketType::Result);
 		gameServer.WriteResult(EFireNetTcpResult::GetServerComplete);
-		gameServer.WriteString(pGameServer->name.toStdString());
-		gameServer.WriteString(pGameServer->ip.toStdString());
-		gameServer.WriteInt(pGameServer->port);
-		gameServer.WriteString(pGameServer->map.toStdString());
-		gameServer.WriteString(pGameServer->gamerules.toStdString());
-		gameServer.WriteInt(pGameServer->online);
-		gameServer.WriteInt(pGameServer->maxPlayers);
+		gameServer.WriteString(server.name.toStdString());
+		gameServer.WriteString(server.ip.toStdString());
+		gameServer.WriteInt(server.port);
+		gameServer.WriteString(server.map.toStdString());
+		gameServer.WriteString(server.gamerules.toStdString());
+		gameServer.WriteInt(server.online);
+		gameServer.WriteInt(server.maxPlayers);
 
 		m_Connection->SendMessage( gameServer);
 
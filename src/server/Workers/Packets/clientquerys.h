@@ -10,6 +10,8 @@
 
 class CTcpPacket;
 class TcpConnection;
+class QueryDispatcher;
+struct SProfileDelta;
 
 class ClientQuerys : public QObject
 {
@@ -21,6 +23,8 @@ public:
 	void           SetSocket(QSslSocket* socket) { this->m_socket = socket; }
 	void           SetClient(SClient* client);
 	void           SetConnection(TcpConnection* connection) { this->m_Connection = connection; }
+
+	static void    RegisterHandlers(QueryDispatcher &dispatcher);
 	
 	void           onLogin(CTcpPacket &packet);
 	void           onRegister(CTcpPacket &packet);
@@ -28,7 +32,7 @@ public:
 	void           onCreateProfile(CTcpPacket &packet);
 	void           onGetProfile();
 	
-	void           onGetShopItems();
+	void           onGetShopItems(CTcpPacket &packet);
 	void           onBuyItem(CTcpPacket &packet);
 	void           onRemoveItem(CTcpPacket &packet);
 	
@@ -36,15 +40,18 @@ public:
 	void           onRemoveFriend(CTcpPacket &packet);
 
 	void           onChatMessage(CTcpPacket &packet);
+	void           onJoinChatChannel(CTcpPacket &packet);
+	void           onLeaveChatChannel(CTcpPacket &packet);
+
+	void           onSetStatus(CTcpPacket &packet);
 
 	void           onInvite(CTcpPacket &packet);
 	void           onDeclineInvite(CTcpPacket &packet);
 	
 	void           onGetGameServer(CTcpPacket &packet);
 private:
-	bool           UpdateProfile(SProfile* profile);
-	// Depricated. TODO - Remove this
-	SShopItem      GetShopItemByName(const QString &name);
+	bool           UpdateProfile(const SProfilePtr &profile, int fields, const SProfileDelta &delta);
+	static void    WriteProfile(CTcpPacket &packet, const SProfile &profile);
 private:
 	QSslSocket*    m_socket;
 	SClient*       m_Client;
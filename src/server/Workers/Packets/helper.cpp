@@ -3,9 +3,11 @@
 
 #include "global.h"
 #include "clientquerys.h"
+#include "querydispatcher.h"
 
 #include "Core/tcpserver.h"
 #include "Workers/Databases/dbworker.h"
+#include "Workers/Databases/profilecache.h"
 #include "Tools/settings.h"
 #include "Tools/scripts.h"
 
@@ -22,24 +24,48 @@ ClientQuerys::ClientQuerys(QObject *parent) : QObject(parent),
 ClientQuerys::~ClientQuerys()
 {
 	qDebug() << "~ClientQuerys";
-	SAFE_DELETE(m_Client->profile);
+}
+
+void ClientQuerys::RegisterHandlers(QueryDispatcher & dispatcher)
+{
+	// Handlers who read or write database
+	dispatcher.Register(EFireNetTcpQuery::Login, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onLogin(packet); });
+	dispatcher.Register(EFireNetTcpQuery::Register, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onRegister(packet); });
+	dispatcher.Register(EFireNetTcpQuery::CreateProfile, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onCreateProfile(packet); });
+	dispatcher.Register(EFireNetTcpQuery::BuyItem, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onBuyItem(packet); });
+	dispatcher.Register(EFireNetTcpQuery::RemoveItem, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onRemoveItem(packet); });
+	dispatcher.Register(EFireNetTcpQuery::RemoveFriend, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onRemoveFriend(packet); });
+	dispatcher.Register(EFireNetTcpQuery::SendInvite, EQueryHandlerType::Database, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onInvite(packet); });
+
+	// Handlers who work only with memory
+	dispatcher.Register(EFireNetTcpQuery::GetProfile, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &) { pQuery->onGetProfile(); });
+	dispatcher.Register(EFireNetTcpQuery::GetShop, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onGetShopItems(packet); });
+	dispatcher.Register(EFireNetTcpQuery::DeclineInvite, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onDeclineInvite(packet); });
+	dispatcher.Register(EFireNetTcpQuery::SendChatMsg, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onChatMessage(packet); });
+	dispatcher.Register(EFireNetTcpQuery::JoinChatChannel, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onJoinChatChannel(packet); });
+	dispatcher.Register(EFireNetTcpQuery::LeaveChatChannel, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onLeaveChatChannel(packet); });
+	dispatcher.Register(EFireNetTcpQuery::SetStatus, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onSetStatus(packet); });
+	dispatcher.Register(EFireNetTcpQuery::GetServer, EQueryHandlerType::CPU, [](ClientQuerys* pQuery, CTcpPacket &packet) { pQuery->onGetGameServer(packet); });
+
+	// Invite accepted on client side, server have nothing to do
+	dispatcher.Register(EFireNetTcpQuery::AcceptInvite, EQueryHandlerType::CPU, [](ClientQuerys*, CTcpPacket &) {});
 }
 
 void ClientQuerys::SetClient(SClient * client)
 {
 	m_Client = client;
-	m_Client->profile = new SProfile;
+	m_Client->profile = SProfilePtr(new SProfile);
 	m_Client->profile->uid = 0;
 	m_Client->profile->nickname = "";
 	m_Client->profile->fileModel = "";
 	m_Client->profile->lvl = 0;
 	m_Client->profile->xp = 0;
 	m_Client->profile->money = 0;
-	m_Client->profile->items = "";
-	m_Client->profile->friends = "";
+	m_Client->profile->items.clear();
+	m_Client->profile->friends.clear();
 }
 
-bool ClientQuerys::UpdateProfile(SProfile* profile)
+bool ClientQuerys::UpdateProfile(const SProfilePtr &profile, int fields, const SProfileDelta &delta)
 {
 	if (!gEnv->pDBWorker->pRedis && !gEnv->pDBWorker->pMySql)
 	{
@@ -47,44 +73,26 @@ bool ClientQuerys::UpdateProfile(SProfile* profile)
         return false;
     }
 
-	DBWorker* pDataBase = gEnv->pDBWorker;
-
-    if (pDataBase->ProfileExists(profile->uid))
-    {
-		if (pDataBase->UpdateProfile(profile))
-        {
-			gEnv->pServer->UpdateClient(m_Client);
-			return true;
-        }
-        else
-            qCritical() << "Profile can't be updated! Database return error!!!";
-    }
-    else
-        qCritical() << "Profile can't be updated, because profile not found!!!";
+	// Profile loaded from database before, so no need to check it exists
+	if (gEnv->pDBWorker->GetProfileCache()->Update(*profile, fields, delta))
+	{
+		gEnv->pServer->UpdateClient(m_Client);
+		return true;
+	}
+	else
+		qCritical() << "Profile can't be updated! Database return error!!!";
 
     return false;
 }
 
-SShopItem ClientQuerys::GetShopItemByName(const QString &name)
+void ClientQuerys::WriteProfile(CTcpPacket & packet, const SProfile & profile)
 {
-    SShopItem item;
-
-	QVector<SShopItem> m_shop = gEnv->pScripts->GetShop();
-
-	if (m_shop.size() > 0)
-	{
-		for (auto it = m_shop.begin(); it != m_shop.end(); ++it)
-		{
-			if (it->name == name)
-			{
-				item.name = it->name;
-				item.cost = it->cost;
-				item.minLnl = it->minLnl;
-				item.canBuy = it->canBuy;
-
-				return item;
-			}
-		}
-	}
-	return item;
+	packet.WriteInt(profile.uid);
+	packet.WriteString(profile.nickname.toStdString());
+	packet.WriteString(profile.fileModel.toStdString());
+	packet.WriteInt(profile.lvl);
+	packet.WriteInt(profile.xp);
+	packet.WriteInt(profile.money);
+	packet.WriteString(ItemsToString(profile.items).toStdString());
+	packet.WriteString(FriendsToString(profile.friends).toStdString());
 }
\ No newline at end of file
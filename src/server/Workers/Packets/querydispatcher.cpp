@@ -0,0 +1,37 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include "global.h"
+#include "querydispatcher.h"
+
+QueryDispatcher::QueryDispatcher()
+{
+	m_Handlers.resize(static_cast<int>(EFireNetTcpQuery::SetChatMember) + 1);
+}
+
+void QueryDispatcher::Register(EFireNetTcpQuery query, EQueryHandlerType type, const SQueryHandler::THandler &func)
+{
+	int index = static_cast<int>(query);
+
+	if (index < 0 || index >= m_Handlers.size())
+	{
+		qWarning() << "Can't register handler for query" << index << ". Unknown query";
+		return;
+	}
+
+	if (m_Handlers[index].func)
+		qWarning() << "Handler for query" << index << "alredy registered. Handler will be replaced";
+
+	m_Handlers[index].type = type;
+	m_Handlers[index].func = func;
+}
+
+const SQueryHandler * QueryDispatcher::Find(EFireNetTcpQuery query) const
+{
+	int index = static_cast<int>(query);
+
+	if (index < 0 || index >= m_Handlers.size() || !m_Handlers[index].func)
+		return nullptr;
+
+	return &m_Handlers[index];
+}
@@ -0,0 +1,48 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#ifndef QUERYDISPATCHER_H
+#define QUERYDISPATCHER_H
+
+#include <QVector>
+
+#include <functional>
+
+#include <FireNetCore/IFireNetTcpPacket.h>
+
+class CTcpPacket;
+class ClientQuerys;
+
+enum class EQueryHandlerType : int
+{
+	// Run in connection thread
+	CPU,
+	// Need database, run in database task pool
+	Database,
+};
+
+struct SQueryHandler
+{
+	typedef std::function<void(ClientQuerys*, CTcpPacket&)> THandler;
+
+	SQueryHandler() : type(EQueryHandlerType::CPU) {}
+
+	EQueryHandlerType type;
+	THandler          func;
+};
+
+// Client query handlers table. Filled once on server start and only readed after it,
+// so connections from all threads use it without locks
+class QueryDispatcher
+{
+public:
+	QueryDispatcher();
+public:
+	void                   Register(EFireNetTcpQuery query, EQueryHandlerType type, const SQueryHandler::THandler &func);
+	// Return nullptr if query unknown
+	const SQueryHandler*   Find(EFireNetTcpQuery query) const;
+private:
+	QVector<SQueryHandler> m_Handlers;
+};
+
+#endif // QUERYDISPATCHER_H
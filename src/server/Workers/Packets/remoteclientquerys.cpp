@@ -8,8 +8,10 @@
 #include "Core/tcpserver.h"
 #include "Core/remoteserver.h"
 #include "Core/tcppacket.h"
+#include "Core/sslcontext.h"
 
 #include "Workers/Databases/dbworker.h"
+#include "Workers/Databases/profilecache.h"
 
 #include "Tools/settings.h"
 #include "Tools/scripts.h"
@@ -112,8 +114,8 @@ void RemoteClientQuerys::onAdminLogining(CTcpPacket &packet)
 	}
 }
 
-// Error types : 0 - Command not found
-// Complete types : 0 - status, 1 - message, 2 - command, 3 - players, 4 - servers
+// Error types : 0 - Command not found, 1 - Can't reload SSL certificate
+// Complete types : 0 - status, 1 - message, 2 - command, 3 - players, 4 - servers, 5 - SSL certificate reloaded
 void RemoteClientQuerys::onConsoleCommandRecived(CTcpPacket &packet)
 {
 	if (!m_client->isAdmin)
@@ -217,6 +219,25 @@ void RemoteClientQuerys::onConsoleCommandRecived(CTcpPacket &packet)
 
 		return;
 	}
+	else if (command == "reload_ssl")
+	{
+		if (gEnv->pSslContext && gEnv->pSslContext->Reload())
+		{
+			CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+			m_packet.WriteResult(EFireNetTcpResult::AdminCommandComplete);
+			m_packet.WriteInt(5);
+			m_connection->SendMessage(m_packet);
+		}
+		else
+		{
+			CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+			m_packet.WriteError(EFireNetTcpError::AdminCommandFail);
+			m_packet.WriteInt(1);
+			m_connection->SendMessage(m_packet);
+		}
+
+		return;
+	}
 
 	CTcpPacket m_packet(EFireNetTcpPacketType::Error);
 	m_packet.WriteError(EFireNetTcpError::AdminCommandFail);
@@ -253,21 +274,24 @@ void RemoteClientQuerys::onGameServerRegister(CTcpPacket &packet)
 		return;
 	}
 
-	if (!gEnv->pRemoteServer->CheckGameServerExists(serverName, serverIp, serverPort))
+	SGameServer server;
+	server.name = serverName;
+	server.ip = serverIp;
+	server.port = serverPort;
+	server.map = mapName;
+	server.gamerules = gamerules;
+	server.online = online;
+	server.maxPlayers = maxPlayers;
+
+	// One connection can register only one game server
+	if (!m_client->isGameServer && gEnv->pRemoteServer->GetGameServers()->Register(server))
 	{
 		m_client->isGameServer = true;
-		m_client->server->name = serverName;
-		m_client->server->ip = serverIp;
-		m_client->server->port = serverPort;
-		m_client->server->map = mapName;
-		m_client->server->gamerules = gamerules;
-		m_client->server->online = online;
-		m_client->server->maxPlayers = maxPlayers;
+		*m_client->server = server;
 
 		gEnv->pRemoteServer->UpdateClient(m_client);
 
-		int gameServersCount = 0;
-		gEnv->pRemoteServer->IsHaveAdmin() ? gameServersCount = gEnv->pRemoteServer->GetClientCount() - 1 : gameServersCount = gEnv->pRemoteServer->GetClientCount();
+		int gameServersCount = gEnv->pRemoteServer->GetGameServers()->GetCount();
 
 		CTcpPacket m_packet(EFireNetTcpPacketType::Result);
 		m_packet.WriteResult(EFireNetTcpResult::RegisterServerComplete);
@@ -312,15 +336,19 @@ void RemoteClientQuerys::onGameServerUpdateInfo(CTcpPacket &packet)
 		return;
 	}
 
-	if (gEnv->pRemoteServer->CheckGameServerExists(serverName, serverIp, serverPort))
+	SGameServer server;
+	server.name = serverName;
+	server.ip = serverIp;
+	server.port = serverPort;
+	server.map = mapName;
+	server.gamerules = gamerules;
+	server.online = online;
+	server.maxPlayers = maxPlayers;
+
+	// Game server can update only itself
+	if (serverName == m_client->server->name && gEnv->pRemoteServer->GetGameServers()->Update(server))
 	{
-		m_client->server->name = serverName;
-		m_client->server->ip = serverIp;
-		m_client->server->port = serverPort;
-		m_client->server->map = mapName;
-		m_client->server->gamerules = gamerules;
-		m_client->server->online = online;
-		m_client->server->maxPlayers = maxPlayers;
+		*m_client->server = server;
 
 		gEnv->pRemoteServer->UpdateClient(m_client);
 
@@ -353,9 +381,9 @@ void RemoteClientQuerys::onGameServerGetOnlineProfile(CTcpPacket &packet)
 
 	int uid = packet.ReadInt();
 
-	SProfile* pProfile = gEnv->pServer->GetProfileByUid(uid);
+	SProfilePtr pProfile = gEnv->pServer->GetProfileByUid(uid);
 
-	if (pProfile != nullptr)
+	if (pProfile)
 	{
 		CTcpPacket profile(EFireNetTcpPacketType::Result);
 		profile.WriteResult(EFireNetTcpResult::GetProfileComplete);
@@ -365,8 +393,8 @@ void RemoteClientQuerys::onGameServerGetOnlineProfile(CTcpPacket &packet)
 		profile.WriteInt(pProfile->lvl);
 		profile.WriteInt(pProfile->xp);
 		profile.WriteInt(pProfile->money);
-		profile.WriteString(pProfile->items.toStdString());
-		profile.WriteString(pProfile->friends.toStdString());
+		profile.WriteString(ItemsToString(pProfile->items).toStdString());
+		profile.WriteString(FriendsToString(pProfile->friends).toStdString());
 
 		m_connection->SendMessage(profile);
 		return;
@@ -400,22 +428,17 @@ void RemoteClientQuerys::onGameServerUpdateOnlineProfile(CTcpPacket &packet)
 	QString items = packet.ReadString();
 	QString friends = packet.ReadString();
 
-	SProfile* pOldProfile = gEnv->pServer->GetProfileByUid(uid);
+	SProfilePtr pOldProfile = gEnv->pServer->GetProfileByUid(uid);
 
-	if (pOldProfile != nullptr)
+	if (pOldProfile)
 	{
 		// Game server can update only lvl, xp and money!
-		SProfile* pNewProfile = new SProfile;
-		pNewProfile->uid = pOldProfile->uid;
-		pNewProfile->nickname = pOldProfile->nickname;
-		pNewProfile->fileModel = pOldProfile->fileModel;
-		pNewProfile->lvl = lvl;
-		pNewProfile->xp = xp;
-		pNewProfile->money = money;
-		pNewProfile->items = pOldProfile->items;
-		pNewProfile->friends = pOldProfile->friends;
-
-		if (gEnv->pServer->UpdateProfile(pNewProfile))
+		SProfile newProfile = *pOldProfile;
+		newProfile.lvl = lvl;
+		newProfile.xp = xp;
+		newProfile.money = money;
+
+		if (gEnv->pServer->UpdateProfile(newProfile, ProfileLvl | ProfileXp | ProfileMoney))
 		{
 			CTcpPacket m_packet(EFireNetTcpPacketType::Result);
 			m_packet.WriteResult(EFireNetTcpResult::UpdateProfileComplete);
@@ -442,6 +465,40 @@ void RemoteClientQuerys::onGameServerUpdateOnlineProfile(CTcpPacket &packet)
 	}
 }
 
+// Game server or admin add player to clan, party or match chat channel, or remove him
+// Error types : 0 - Wrong channel name or uid
+void RemoteClientQuerys::onSetChatMember(CTcpPacket &packet)
+{
+	if (!m_client->isGameServer && !m_client->isAdmin)
+	{
+		qWarning() << "Only registered game servers or administrator can set chat channel members";
+		return;
+	}
+
+	QString channel = packet.ReadString();
+	int uid = packet.ReadInt();
+	bool bMember = packet.ReadBool();
+
+	if (gEnv->pServer->SetChatMember(channel, uid, bMember))
+	{
+		CTcpPacket m_packet(EFireNetTcpPacketType::Result);
+		m_packet.WriteResult(EFireNetTcpResult::SetChatMemberComplete);
+		m_packet.WriteString(channel.toStdString());
+		m_packet.WriteInt(uid);
+		m_packet.WriteBool(bMember);
+		m_connection->SendMessage(m_packet);
+	}
+	else
+	{
+		qDebug() << "Failed set member" << uid << "of chat channel" << channel;
+
+		CTcpPacket m_packet(EFireNetTcpPacketType::Error);
+		m_packet.WriteError(EFireNetTcpError::SetChatMemberFail);
+		m_packet.WriteInt(0);
+		m_connection->SendMessage(m_packet);
+	}
+}
+
 bool RemoteClientQuerys::CheckInTrustedList(const QString &name, const QString &ip, int port)
 {
 	QVector<STrustedServer> m_server = gEnv->pScripts->GetTrustedList();
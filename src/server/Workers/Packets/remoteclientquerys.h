@@ -31,6 +31,7 @@ public:
 	void              onGameServerUpdateInfo(CTcpPacket &packet);
 	void              onGameServerGetOnlineProfile(CTcpPacket &packet);
 	void              onGameServerUpdateOnlineProfile(CTcpPacket &packet);
+	void              onSetChatMember(CTcpPacket &packet);
 private:
 	bool              CheckInTrustedList(const QString &name, const QString &ip, int port);
 private:
@@ -8,13 +8,20 @@ class TcpServer;
 class DBWorker;
 class QTimer;
 class RemoteServer;
+class SslContext;
 class SettingsManager;
 class Scripts;
 class MainWindow;
 
 #include <QSslSocket>
+#include <QSharedPointer>
+#include <QSet>
+#include <QStringList>
+#include <QAtomicInteger>
 #include <QDebug>
 
+#include <algorithm>
+
 // Safe deleting
 #define SAFE_DELETE(p) {if(p){delete p; p = nullptr;}}
 #define SAFE_RELEASE(p) {if(p){p->deleteLater(); p = nullptr;}}
@@ -38,16 +45,75 @@ struct SProfile
 	int lvl;
 	int xp;
 	int money;
-	QString items;
-	QString friends;
+	// Names of purchased items
+	QSet<QString> items;
+	// Uids of friends
+	QSet<int> friends;
+};
+
+// Items and friends go to client as sorted comma separated lists
+inline QString ItemsToString(const QSet<QString> &items)
+{
+	QStringList list = items.toList();
+	list.sort();
+	return list.join(",");
+}
+
+inline QString FriendsToString(const QSet<int> &friends)
+{
+	QList<int> uids = friends.toList();
+	std::sort(uids.begin(), uids.end());
+
+	QStringList list;
+	for (auto it = uids.begin(); it != uids.end(); ++it)
+		list.push_back(QString::number(*it));
+
+	return list.join(",");
+}
+
+inline QSet<QString> ItemsFromString(const QString &items)
+{
+	return items.split(",", QString::SkipEmptyParts).toSet();
+}
+
+inline QSet<int> FriendsFromString(const QString &friends)
+{
+	QSet<int> uids;
+	QStringList list = friends.split(",", QString::SkipEmptyParts);
+
+	for (auto it = list.begin(); it != list.end(); ++it)
+	{
+		const int uid = it->toInt();
+		if (uid > 0)
+			uids.insert(uid);
+	}
+
+	return uids;
+}
+
+// Shared profile handle
+typedef QSharedPointer<SProfile> SProfilePtr;
+
+// Address of connection : server thread index and slot in connection table of this thread.
+// Slot can be used by other connection later, generation tell them apart
+struct SConnectionRoute
+{
+	SConnectionRoute() : thread(-1), slot(-1), generation(0) {}
+
+	bool IsValid() const { return thread >= 0 && slot >= 0; }
+
+	int thread;
+	int slot;
+	quint32 generation;
 };
 
 // Client structure
 struct SClient
 {
 	QSslSocket* socket;
-	SProfile* profile;
+	SProfilePtr profile;
 	int status;
+	SConnectionRoute route;
 };
 
 // Shop item structure
@@ -107,6 +173,7 @@ struct SGlobalEnvironment
 		pDBWorker = nullptr;
 		pTimer = nullptr;
 		pRemoteServer = nullptr;
+		pSslContext = nullptr;
 		pSettings = nullptr;
 		pScripts = nullptr;
 		pUI = nullptr;		
@@ -122,6 +189,12 @@ struct SGlobalEnvironment
 		m_OutputPacketsCount = 0;
 		m_OutputSpeed = 0;
 		m_OutputMaxSpeed = 0;
+		m_InputBytes = 0;
+		m_InputBytesSpeed = 0;
+		m_OutputBytes = 0;
+		m_OutputBytesSpeed = 0;
+		m_BadPacketsCount = 0;
+		m_RateLimitedCount = 0;
 
 		m_DebugsCount = 0;
 		m_WarningsCount = 0;
@@ -129,6 +202,12 @@ struct SGlobalEnvironment
 
 		m_MaxClientCount = 0;
 
+		m_HandshakesCount = 0;
+		m_HandshakesFailed = 0;
+		m_HandshakesRejected = 0;
+		m_HandshakesTotalTime = 0;
+		m_HandshakesMaxTime = 0;
+
 		m_serverFullName = "FireNET";
 
 		m_FileLogLevel = 0;
@@ -141,26 +220,40 @@ struct SGlobalEnvironment
 	// Pointers to main server systems
 	TcpServer*           pServer;
 	RemoteServer*        pRemoteServer;
+	SslContext*          pSslContext;
 	DBWorker*            pDBWorker;
 	QTimer*              pTimer;
 	SettingsManager*     pSettings;
 	Scripts*             pScripts;
 	MainWindow*          pUI;
 
-	// Server statistic
+	// Server statistic (updated by server thread once a second, read by UI)
 	SServerStatus        m_ServerStatus;	
-	int                  m_InputPacketsCount;
-	int                  m_InputSpeed;
-	int                  m_InputMaxSpeed;
-	int                  m_OutputPacketsCount;
-	int                  m_OutputSpeed;
-	int                  m_OutputMaxSpeed;
-
-	int                  m_DebugsCount;
-	int                  m_WarningsCount;
-	int                  m_ErrorsCount;
-
-	int                  m_MaxClientCount;
+	QAtomicInteger<qint64> m_InputPacketsCount;
+	QAtomicInt           m_InputSpeed;
+	QAtomicInt           m_InputMaxSpeed;
+	QAtomicInteger<qint64> m_OutputPacketsCount;
+	QAtomicInt           m_OutputSpeed;
+	QAtomicInt           m_OutputMaxSpeed;
+	QAtomicInteger<qint64> m_InputBytes;
+	QAtomicInteger<qint64> m_InputBytesSpeed;
+	QAtomicInteger<qint64> m_OutputBytes;
+	QAtomicInteger<qint64> m_OutputBytesSpeed;
+	QAtomicInt           m_BadPacketsCount;
+	QAtomicInt           m_RateLimitedCount;
+
+	QAtomicInt           m_DebugsCount;
+	QAtomicInt           m_WarningsCount;
+	QAtomicInt           m_ErrorsCount;
+
+	QAtomicInt           m_MaxClientCount;
+
+	// TLS handshakes statistic (time in ms)
+	QAtomicInt           m_HandshakesCount;
+	QAtomicInt           m_HandshakesFailed;
+	QAtomicInt           m_HandshakesRejected;
+	QAtomicInteger<qint64> m_HandshakesTotalTime;
+	QAtomicInteger<qint64> m_HandshakesMaxTime;
 
 	// Log level for file and UI
 	int                  m_FileLogLevel;
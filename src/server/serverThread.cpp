@@ -15,9 +15,11 @@
 
 #include "Core/tcpserver.h"
 #include "Core/remoteserver.h"
+#include "Core/sslcontext.h"
 
 #include "Workers/Databases/dbworker.h"
 #include "Workers/Databases/mysqlconnector.h"
+#include "Workers/Databases/dbtaskpool.h"
 
 #include "Tools/settings.h"
 #include "Tools/scripts.h"
@@ -124,6 +126,15 @@ bool CServerThread::Init()
 		return false;
 	}
 
+	// Key material loaded once and shared by all connections
+	gEnv->pSslContext = new SslContext;
+
+	if (!gEnv->pSslContext->Load("key.pem", "key.key"))
+	{
+		qCritical() << "Server can't start - SSL key files can't be loaded!";
+		return false;
+	}
+
 	if (!QFile::exists("FireNET.cfg"))
 	{
 		qWarning() << "Not found FireNET.cfg! Using default settings...";
@@ -184,18 +195,34 @@ void CServerThread::RegisterVariables()
 	gEnv->pSettings->RegisterVariable("sv_ui_log_level", 2, "Log level for control debugging messages in UI [0-2]", true, &UpdateUILogLevel);
 #endif
 	gEnv->pSettings->RegisterVariable("sv_thread_count", 1, "Main server thread count for thread pooling", false);
+	gEnv->pSettings->RegisterVariable("sv_thread_affinity", false, "Pin every server thread to own CPU core (Linux only)", false);
 	gEnv->pSettings->RegisterVariable("sv_max_players", 1000, "Maximum players count for connection", true, &UpdateMaxClientCount);
 	gEnv->pSettings->RegisterVariable("sv_max_servers", 10, "Maximum game servers count for connection", true, &UpdateMaxRemoteClienCount);
 	gEnv->pSettings->RegisterVariable("sv_tickrate", 30, "Main server tick rate speed (30 by Default)", false);
+	gEnv->pSettings->RegisterVariable("sv_thread_lag_weight", 1, "How many connections cost one millisecond of thread event loop lag", true);
+	gEnv->pSettings->RegisterVariable("sv_rebalance_threshold", 50, "Connections difference between threads for moving idle connections (0 - disabled)", true);
+	gEnv->pSettings->RegisterVariable("sv_rebalance_max_connections", 50, "Maximum connections moved between threads by one rebalance", true);
+	gEnv->pSettings->RegisterVariable("sv_rebalance_idle_time", 5, "Time in seconds without traffic before connection can be moved to other thread", true);
 	// Remote server vars
 	gEnv->pSettings->RegisterVariable("remote_root_user", "administrator", "Remote admin login", true);
 	gEnv->pSettings->RegisterVariable("remote_root_password", "qwerty", "Remote admin password", true);
 	gEnv->pSettings->RegisterVariable("remote_server_port", 64000, "Remote server port", false);
+	gEnv->pSettings->RegisterVariable("remote_reservation_time", 10, "Seconds while slot on game server reserved for player after search", true);
+	gEnv->pSettings->RegisterVariable("remote_server_timeout", 60, "Seconds without updates before game server removed from matchmaking (0 - disabled)", true);
+	gEnv->pSettings->RegisterVariable("remote_fill_servers", false, "Matchmaking send players to most loaded game server with free slot instead of least loaded", true);
 	// Database vars
 	gEnv->pSettings->RegisterVariable("db_mode", "Redis", "Database mode [Redis, MySql, Redis+MySql]", false);
+	gEnv->pSettings->RegisterVariable("db_worker_threads", 4, "Threads count for database work of client queries", false);
+	gEnv->pSettings->RegisterVariable("db_uid_block_size", 100, "Count of uids reserved by one database request", false);
+	gEnv->pSettings->RegisterVariable("db_nickname_filter_bits", 1 << 20, "Minimal size of nickname filter in bits", false);
+	gEnv->pSettings->RegisterVariable("db_write_behind", true, "Write profile changes by batches instead of on every change", false);
+	gEnv->pSettings->RegisterVariable("db_flush_interval", 1000, "Interval for writing profile changes to database (ms)", false);
+	gEnv->pSettings->RegisterVariable("db_journal", "profiles.journal", "Journal file for profile changes not written yet. Empty for disable", false);
+	gEnv->pSettings->RegisterVariable("db_journal_sync", false, "Sync journal to disk on every profile change", false);
 	// Redis vars
 	gEnv->pSettings->RegisterVariable("redis_ip", "127.0.0.1", "Redis database ip address", false);
 	gEnv->pSettings->RegisterVariable("redis_port", 6379, "Redis database port", false);
+	gEnv->pSettings->RegisterVariable("redis_timeout", 3000, "Redis connection and reply timeout in milliseconds", false);
 	gEnv->pSettings->RegisterVariable("redis_bg_saving", false, "Use redis background saving", true);
 	// MySQL vars
 	gEnv->pSettings->RegisterVariable("mysql_host", "127.0.0.1", "MySql database ip address", false);
@@ -203,16 +230,33 @@ void CServerThread::RegisterVariables()
 	gEnv->pSettings->RegisterVariable("mysql_db_name", "FireNET", "MySql database name", false);
 	gEnv->pSettings->RegisterVariable("mysql_username", "admin", "MySql username", false);
 	gEnv->pSettings->RegisterVariable("mysql_password", "password", "MySql password", false);
+	gEnv->pSettings->RegisterVariable("mysql_max_connections", 8, "Maximum MySql connections, every database thread use own connection", false);
+	gEnv->pSettings->RegisterVariable("mysql_wait_timeout", 3000, "Time in milliseconds for waiting free MySql connection", false);
+	gEnv->pSettings->RegisterVariable("mysql_check_interval", 30, "Seconds without queries before MySql connection checked by ping", false);
+	gEnv->pSettings->RegisterVariable("mysql_drop_old_profile_columns", false, "Remove old items and friends columns from profiles table after they moved to own tables", false);
 	// Network vars
 	gEnv->pSettings->RegisterVariable("net_encryption_timeout", 3, "Network timeout for new connection", true);
+	gEnv->pSettings->RegisterVariable("net_reuseport", false, "Every server thread accept clients on own SO_REUSEPORT socket (Linux only)", false);
+	gEnv->pSettings->RegisterVariable("net_max_handshakes_per_thread", 64, "Maximum TLS handshakes in progress on one server thread (0 - unlimited)", true);
 	gEnv->pSettings->RegisterVariable("net_magic_key", 2016207, "Network magic key for check packets for validations", true);
 	gEnv->pSettings->RegisterVariable("net_max_packet_read_size", 512 , "Maximum packet size for reading", true);
 	gEnv->pSettings->RegisterVariable("net_max_bad_packets_count", 10, "Maximum bad packets count from client", true);
-	gEnv->pSettings->RegisterVariable("net_max_packets_speed", 4, "Maximum packets per second count by client", true);
+	gEnv->pSettings->RegisterVariable("net_rate_limit_mode", 1, "Packets rate limit mode (0 - disabled, 1 - delay packets, 2 - disconnect client)", true);
+	gEnv->pSettings->RegisterVariable("net_rate_limit_rate", 10, "Packet tokens per second refilled for one client", true);
+	gEnv->pSettings->RegisterVariable("net_rate_limit_burst", 30, "Maximum packet tokens of one client", true);
+	gEnv->pSettings->RegisterVariable("net_rate_limit_ip_rate", 100, "Packet tokens per second refilled for all clients from one IP (0 - disabled)", false);
+	gEnv->pSettings->RegisterVariable("net_rate_limit_ip_burst", 300, "Maximum packet tokens of all clients from one IP", false);
 	gEnv->pSettings->RegisterVariable("net_packet_debug", false, "Enable/Disable packet debugging", true);
 	// Utils
 	gEnv->pSettings->RegisterVariable("stress_mode", false, "Changes server settings to work with stress test", false);
 	gEnv->pSettings->RegisterVariable("bUseGlobalChat", false, "Enable/Disable global chat", true);
+	gEnv->pSettings->RegisterVariable("chat_channel_rate", 5, "Messages per second allowed in one chat channel (0 - unlimited)", false);
+	gEnv->pSettings->RegisterVariable("chat_channel_burst", 20, "Maximum messages burst in one chat channel", false);
+	gEnv->pSettings->RegisterVariable("chat_history_size", 20, "Last messages of chat channel sent to client after join", false);
+	gEnv->pSettings->RegisterVariable("chat_max_channels", 8, "Maximum chat channels joined by one client (0 - unlimited)", true);
+	gEnv->pSettings->RegisterVariable("chat_channel_ttl", 600, "Seconds without messages before chat channel history removed", true);
+	gEnv->pSettings->RegisterVariable("chat_open_group_channels", false, "Allow join clan, party and match chat channels without membership set by game server", false);
+	gEnv->pSettings->RegisterVariable("presence_update_interval", 200, "Milliseconds while friend status changes collected before sending", true);
 	// Gloval vars (This variables not need read from server.cfg)
 	gEnv->pSettings->RegisterVariable("bUseRedis", true, "Enable/Disable using Redis database", false);
 	gEnv->pSettings->RegisterVariable("bUseMySQL", false, "Enable/Disable using MySql database", false);
@@ -274,7 +318,8 @@ void CServerThread::EnableStressTest()
 	gEnv->pSettings->SetVariable("sv_file_log_level", 0);
 	gEnv->pSettings->SetVariable("sv_max_players", 1000);
 	gEnv->pSettings->SetVariable("net_max_bad_packets_count", 1000);
-	gEnv->pSettings->SetVariable("net_max_packets_speed", 100);
+	gEnv->pSettings->SetVariable("net_rate_limit_mode", 0);
+	gEnv->pSettings->SetVariable("net_rate_limit_ip_rate", 0);
 	gEnv->pSettings->SetVariable("net_packet_debug", false);
 
 	emit EnableStressMode();
@@ -372,6 +417,10 @@ void CServerThread::stop()
 	if (gEnv->pTimer)
 		gEnv->pTimer->stop();
 
+	// Database tasks use client connections, wait them before connections closed
+	if (gEnv->pDBWorker)
+		gEnv->pDBWorker->GetTaskPool()->Clear();
+
 	SAFE_CLEAR(gEnv->pServer);
 	SAFE_CLEAR(gEnv->pRemoteServer);
 	SAFE_CLEAR(gEnv->pSettings);
@@ -391,6 +440,7 @@ void CServerThread::stop()
 	SAFE_RELEASE(gEnv->pSettings);
 	SAFE_RELEASE(gEnv->pScripts);
 	SAFE_RELEASE(gEnv->pDBWorker);
+	SAFE_RELEASE(gEnv->pSslContext);
 
 	QThreadPool::globalInstance()->waitForDone(1000);	
 
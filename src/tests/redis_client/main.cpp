@@ -0,0 +1,321 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <gtest/gtest.h>
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "Workers/Databases/redisclient.h"
+
+// Scripted Redis : wait commands and send canned replies byte by byte,
+// so client get every reply split on all possible places
+class FakeRedisThread : public QThread
+{
+public:
+	explicit FakeRedisThread(const QByteArray &replies) : m_Replies(replies), m_Port(0) {}
+public:
+	quint16               WaitListening()
+	{
+		m_Ready.acquire();
+		return m_Port;
+	}
+protected:
+	virtual void          run() override
+	{
+		QTcpServer server;
+
+		if (server.listen(QHostAddress::LocalHost, 0))
+			m_Port = server.serverPort();
+
+		m_Ready.release();
+
+		if (m_Port == 0 || !server.waitForNewConnection(5000))
+			return;
+
+		QTcpSocket* pSocket = server.nextPendingConnection();
+		pSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+		// Client drop replies without commands, so wait them first
+		if (!pSocket->waitForReadyRead(5000))
+			return;
+
+		for (int i = 0; i < m_Replies.size(); ++i)
+		{
+			pSocket->write(m_Replies.constData() + i, 1);
+			pSocket->waitForBytesWritten(1000);
+			msleep(1);
+		}
+
+		if (pSocket->state() == QAbstractSocket::ConnectedState)
+			pSocket->waitForDisconnected(5000);
+	}
+private:
+	QByteArray            m_Replies;
+	quint16               m_Port;
+	QSemaphore            m_Ready;
+};
+
+static QVector<SRedisReply> RunFakeRedis(const QByteArray &replies, int commands)
+{
+	QVector<SRedisReply> results;
+
+	FakeRedisThread server(replies);
+	server.start();
+
+	quint16 port = server.WaitListening();
+	if (port == 0)
+	{
+		server.wait();
+		return results;
+	}
+
+	RedisClient client;
+	if (client.Connect("127.0.0.1", port, 1000))
+	{
+		for (int i = 0; i < commands; ++i)
+		{
+			client.Command({ "PING" }, [&results](const SRedisReply &reply)
+			{
+				results.push_back(reply);
+			});
+		}
+
+		client.Commit(10000);
+		client.Disconnect();
+	}
+
+	server.wait();
+	return results;
+}
+
+TEST(RedisClientParser, PartialReplies)
+{
+	const QByteArray replies =
+		"+OK\r\n"
+		"$5\r\nhello\r\n"
+		"$0\r\n\r\n"
+		"$-1\r\n"
+		"-ERR wrong\r\n"
+		":-42\r\n"
+		"*3\r\n$1\r\na\r\n$-1\r\n:7\r\n"
+		"*-1\r\n"
+		"*0\r\n"
+		"*2\r\n*1\r\n+QUEUED\r\n$4\r\na\r\nb\r\n";
+
+	QVector<SRedisReply> results = RunFakeRedis(replies, 10);
+	ASSERT_EQ(results.size(), 10);
+
+	EXPECT_TRUE(results[0].IsOk());
+
+	EXPECT_EQ(results[1].type, SRedisReply::Bulk);
+	EXPECT_EQ(results[1].string, QByteArray("hello"));
+
+	EXPECT_EQ(results[2].type, SRedisReply::Bulk);
+	EXPECT_TRUE(results[2].string.isEmpty());
+
+	EXPECT_TRUE(results[3].IsNull());
+
+	EXPECT_TRUE(results[4].IsError());
+	EXPECT_EQ(results[4].string, QByteArray("ERR wrong"));
+
+	EXPECT_EQ(results[5].type, SRedisReply::Integer);
+	EXPECT_EQ(results[5].integer, -42);
+
+	ASSERT_EQ(results[6].type, SRedisReply::Array);
+	ASSERT_EQ(results[6].elements.size(), 3);
+	EXPECT_EQ(results[6].elements[0].string, QByteArray("a"));
+	EXPECT_TRUE(results[6].elements[1].IsNull());
+	EXPECT_EQ(results[6].elements[2].integer, 7);
+
+	EXPECT_TRUE(results[7].IsNull());
+
+	EXPECT_EQ(results[8].type, SRedisReply::Array);
+	EXPECT_TRUE(results[8].elements.isEmpty());
+
+	ASSERT_EQ(results[9].type, SRedisReply::Array);
+	ASSERT_EQ(results[9].elements.size(), 2);
+	ASSERT_EQ(results[9].elements[0].type, SRedisReply::Array);
+	ASSERT_EQ(results[9].elements[0].elements.size(), 1);
+	EXPECT_EQ(results[9].elements[0].elements[0].string, QByteArray("QUEUED"));
+	// Bulk string can contain CRLF inside
+	EXPECT_EQ(results[9].elements[1].string, QByteArray("a\r\nb"));
+}
+
+TEST(RedisClientParser, CorruptedStreamFailsPending)
+{
+	QVector<SRedisReply> results = RunFakeRedis("+OK\r\n?bad\r\n", 2);
+	ASSERT_EQ(results.size(), 2);
+
+	EXPECT_TRUE(results[0].IsOk());
+	EXPECT_TRUE(results[1].IsError());
+	EXPECT_EQ(results[1].string, QByteArray("ERR protocol error"));
+}
+
+// Tests below need redis-server on 127.0.0.1 (port from FIRENET_TEST_REDIS_PORT, default 6379)
+class RedisServerTest : public ::testing::Test
+{
+protected:
+	virtual void          SetUp() override
+	{
+		quint16 port = 6379;
+
+		QByteArray envPort = qgetenv("FIRENET_TEST_REDIS_PORT");
+		if (!envPort.isEmpty())
+			port = envPort.toUShort();
+
+		if (!m_Client.Connect("127.0.0.1", port, 1000))
+			GTEST_SKIP() << "redis-server not running on port " << port;
+
+		m_Prefix = "firenet_test:" + QByteArray::number(QCoreApplication::applicationPid()) + ":";
+	}
+	virtual void          TearDown() override
+	{
+		if (m_Keys.isEmpty() || !m_Client.IsConnected())
+			return;
+
+		QList<QByteArray> args;
+		args.append("DEL");
+		args.append(m_Keys);
+
+		m_Client.Execute(args, 1000);
+	}
+protected:
+	QByteArray            Key(const char* name)
+	{
+		QByteArray key = m_Prefix + name;
+		m_Keys.append(key);
+		return key;
+	}
+protected:
+	RedisClient           m_Client;
+	QByteArray            m_Prefix;
+	QList<QByteArray>     m_Keys;
+};
+
+TEST_F(RedisServerTest, StatusAndBulk)
+{
+	const QByteArray key = Key("string");
+
+	EXPECT_TRUE(m_Client.Execute({ "SET", key, "value" }, 1000).IsOk());
+
+	SRedisReply reply = m_Client.Execute({ "GET", key }, 1000);
+	EXPECT_EQ(reply.type, SRedisReply::Bulk);
+	EXPECT_EQ(reply.string, QByteArray("value"));
+}
+
+TEST_F(RedisServerTest, NullBulk)
+{
+	EXPECT_TRUE(m_Client.Execute({ "GET", Key("missing") }, 1000).IsNull());
+}
+
+TEST_F(RedisServerTest, ErrorReplyKeepConnection)
+{
+	const QByteArray key = Key("not_number");
+
+	EXPECT_TRUE(m_Client.Execute({ "SET", key, "abc" }, 1000).IsOk());
+
+	SRedisReply reply = m_Client.Execute({ "INCR", key }, 1000);
+	EXPECT_TRUE(reply.IsError());
+	EXPECT_TRUE(reply.string.startsWith("ERR"));
+
+	EXPECT_TRUE(m_Client.Execute({ "FIRENET_NO_SUCH_COMMAND" }, 1000).IsError());
+
+	reply = m_Client.Execute({ "PING" }, 1000);
+	EXPECT_EQ(reply.type, SRedisReply::Status);
+	EXPECT_EQ(reply.string, QByteArray("PONG"));
+}
+
+TEST_F(RedisServerTest, ArrayWithNullAndEmptyArray)
+{
+	const QByteArray first = Key("first");
+	const QByteArray second = Key("second");
+
+	EXPECT_TRUE(m_Client.Execute({ "SET", first, "1" }, 1000).IsOk());
+	EXPECT_TRUE(m_Client.Execute({ "SET", second, "2" }, 1000).IsOk());
+
+	SRedisReply reply = m_Client.Execute({ "MGET", first, Key("missing"), second }, 1000);
+	ASSERT_EQ(reply.type, SRedisReply::Array);
+	ASSERT_EQ(reply.elements.size(), 3);
+	EXPECT_EQ(reply.elements[0].string, QByteArray("1"));
+	EXPECT_TRUE(reply.elements[1].IsNull());
+	EXPECT_EQ(reply.elements[2].string, QByteArray("2"));
+
+	reply = m_Client.Execute({ "LRANGE", Key("missing_list"), "0", "-1" }, 1000);
+	EXPECT_EQ(reply.type, SRedisReply::Array);
+	EXPECT_TRUE(reply.elements.isEmpty());
+}
+
+TEST_F(RedisServerTest, TransactionReplyWithError)
+{
+	const QByteArray key = Key("transaction");
+
+	QVector<SRedisReply> results;
+	auto collect = [&results](const SRedisReply &reply) { results.push_back(reply); };
+
+	m_Client.Command({ "MULTI" }, collect);
+	m_Client.Command({ "SET", key, "abc" }, collect);
+	m_Client.Command({ "INCR", key }, collect);
+	m_Client.Command({ "EXEC" }, collect);
+
+	ASSERT_TRUE(m_Client.Commit(1000));
+	ASSERT_EQ(results.size(), 4);
+
+	EXPECT_TRUE(results[0].IsOk());
+	EXPECT_EQ(results[1].string, QByteArray("QUEUED"));
+	EXPECT_EQ(results[2].string, QByteArray("QUEUED"));
+
+	ASSERT_EQ(results[3].type, SRedisReply::Array);
+	ASSERT_EQ(results[3].elements.size(), 2);
+	EXPECT_TRUE(results[3].elements[0].IsOk());
+	EXPECT_TRUE(results[3].elements[1].IsError());
+}
+
+TEST_F(RedisServerTest, LargeBulkComeInParts)
+{
+	const QByteArray key = Key("large");
+	const QByteArray value(4 * 1024 * 1024, 'x');
+
+	EXPECT_TRUE(m_Client.Execute({ "SET", key, value }, 10000).IsOk());
+
+	SRedisReply reply = m_Client.Execute({ "GET", key }, 10000);
+	EXPECT_EQ(reply.type, SRedisReply::Bulk);
+	EXPECT_EQ(reply.string.size(), value.size());
+	EXPECT_TRUE(reply.string == value);
+}
+
+TEST_F(RedisServerTest, PipelinedRepliesKeepOrder)
+{
+	const QByteArray key = Key("counter");
+	const int count = 10000;
+
+	int expected = 1;
+	bool bInOrder = true;
+
+	for (int i = 0; i < count; ++i)
+	{
+		m_Client.Command({ "INCR", key }, [&expected, &bInOrder](const SRedisReply &reply)
+		{
+			if (reply.type != SRedisReply::Integer || reply.integer != expected)
+				bInOrder = false;
+
+			expected++;
+		});
+	}
+
+	EXPECT_TRUE(m_Client.Commit(10000));
+	EXPECT_EQ(m_Client.GetPendingCount(), 0);
+	EXPECT_EQ(expected, count + 1);
+	EXPECT_TRUE(bInOrder);
+}
+
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+// Copyright (C) 2014-2017 Ilya Chernetsov. All rights reserved. Contacts: <chernecoff@gmail.com>
+// License: https://github.com/afrostalin/FireNET/blob/master/LICENSE
+
+#include <benchmark/benchmark.h>
+
+#include <FireNetCore/IFireNetTcpPacketWriter.h>
+#include <FireNetCore/IFireNetTcpFrame.h>
+
+// Server CTcpPacket log through Qt, so here same shared writer used without reading part
+class CBenchTcpPacket : public CFireNetTcpPacketWriter
+{
+public:
+	explicit CBenchTcpPacket(EFireNetTcpPacketType type) : CFireNetTcpPacketWriter(type) {}
+public:
+	// Reading is not measured here
+	virtual const char*        ReadString() override { return nullptr; }
+	virtual int                ReadInt() override { return 0; }
+	virtual bool               ReadBool() override { return false; }
+	virtual float              ReadFloat() override { return 0.0f; }
+	virtual double             ReadDouble() override { return 0.0; }
+public:
+	virtual const char*        toString() override { return FinishWriting(); }
+private:
+	virtual void               ReadPacket() override {}
+};
+
+// Old packet writing : whole packet copied for every field
+class CConcatTcpPacket
+{
+public:
+	explicit CConcatTcpPacket(EFireNetTcpPacketType type) : m_Separator('|')
+	{
+		WriteString("!0x0");
+		WriteInt(static_cast<int>(type));
+	}
+public:
+	void                       WriteString(const std::string &value) { m_Data = m_Data + value + m_Separator; }
+	void                       WriteInt(int value) { m_Data = m_Data + std::to_string(value) + m_Separator; }
+	void                       WriteFloat(float value) { m_Data = m_Data + std::to_string(value) + m_Separator; }
+	const char*                toString() { m_Data = m_Data + "0x0!"; return m_Data.c_str(); }
+private:
+	std::string                m_Data;
+	char                       m_Separator;
+};
+
+// Same fields as LoginCompleteWithProfile answer
+template<typename TPacket>
+static void WriteProfile(TPacket &packet)
+{
+	packet.WriteInt(static_cast<int>(EFireNetTcpResult::LoginCompleteWithProfile));
+	packet.WriteInt(100042);
+	packet.WriteString("PlayerNickname");
+	packet.WriteString("objects/characters/human/sdk_player/sdk_player.cdf");
+	packet.WriteInt(27);
+	packet.WriteInt(154320);
+	packet.WriteInt(98765);
+	packet.WriteString("rifle,pistol,shotgun,booster_xp,booster_money");
+	packet.WriteString("100001,100007,100013,100029");
+	packet.WriteInt(1234);
+	packet.WriteInt(567);
+	packet.WriteFloat(2.176f);
+}
+
+static void BM_WriteProfilePacket_Concat(benchmark::State &state)
+{
+	for (auto _ : state)
+	{
+		CConcatTcpPacket packet(EFireNetTcpPacketType::Result);
+		WriteProfile(packet);
+		benchmark::DoNotOptimize(packet.toString());
+	}
+}
+BENCHMARK(BM_WriteProfilePacket_Concat);
+
+static void BM_WriteProfilePacket_InPlace(benchmark::State &state)
+{
+	for (auto _ : state)
+	{
+		CBenchTcpPacket packet(EFireNetTcpPacketType::Result);
+		WriteProfile(packet);
+		benchmark::DoNotOptimize(packet.toString());
+	}
+}
+BENCHMARK(BM_WriteProfilePacket_InPlace);
+
+static void BM_EncodeProfileFrame(benchmark::State &state)
+{
+	for (auto _ : state)
+	{
+		CBenchTcpPacket packet(EFireNetTcpPacketType::Result);
+		WriteProfile(packet);
+
+		std::string frame = FireNetEncodeTcpFrame(packet);
+		benchmark::DoNotOptimize(frame.data());
+	}
+}
+BENCHMARK(BM_EncodeProfileFrame);
+
+static void BM_AppendInt(benchmark::State &state)
+{
+	std::string data;
+	data.reserve(64);
+
+	for (auto _ : state)
+	{
+		data.clear();
+		CFireNetPacketWriter::AppendInt(data, -2147483647);
+		benchmark::DoNotOptimize(data.data());
+	}
+}
+BENCHMARK(BM_AppendInt);
+
+BENCHMARK_MAIN();